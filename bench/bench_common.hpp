@@ -0,0 +1,102 @@
+#pragma once
+
+// Helpers shared by the benchmark executables: timing, synthetic systems of
+// arbitrary size and a small JSON report writer.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "molecule.hpp"
+
+struct BenchTiming {
+  double best = 0.0;
+  double median = 0.0;
+};
+
+// Runs `fn` once to warm up, then `reps` more times; seconds per run.
+inline BenchTiming benchMeasure(int reps, const std::function<void()>& fn) {
+  fn();
+  std::vector<double> runs;
+  for (int r = 0; r < reps; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    runs.push_back(std::chrono::duration<double>(t1 - t0).count());
+  }
+  std::sort(runs.begin(), runs.end());
+  return {runs.front(), runs[runs.size() / 2]};
+}
+
+// Water on a cubic grid at liquid density (one molecule per 30 A^3), cut
+// off at exactly `atoms` atoms. Deterministic, so runs are comparable.
+inline Molecule syntheticWater(size_t atoms) {
+  const float spacing = 3.1f;
+  size_t molecules = (atoms + 2) / 3;
+  size_t side = (size_t)std::ceil(std::cbrt((double)molecules));
+
+  Molecule mol;
+  for (size_t m = 0; m < molecules && mol.size() < atoms; m++) {
+    float ox = spacing * (float)(m % side);
+    float oy = spacing * (float)(m / side % side);
+    float oz = spacing * (float)(m / (side * side));
+    mol.addAtom(8, ox, oy, oz);
+    if (mol.size() < atoms) {
+      mol.addAtom(1, ox + 0.96f, oy, oz);
+    }
+    if (mol.size() < atoms) {
+      mol.addAtom(1, ox - 0.24f, oy + 0.93f, oz);
+    }
+  }
+  return mol;
+}
+
+// 1k, 10k, ... up to and including `maxAtoms`.
+inline std::vector<size_t> benchSizes(size_t maxAtoms) {
+  std::vector<size_t> sizes;
+  for (size_t n = 1000; n <= maxAtoms; n *= 10) {
+    sizes.push_back(n);
+  }
+  return sizes;
+}
+
+// One measured case: a name plus numeric fields, in insertion order.
+struct BenchRecord {
+  explicit BenchRecord(std::string name) : name(std::move(name)) {}
+
+  std::string name;
+  std::vector<std::pair<std::string, double>> fields;
+
+  BenchRecord& set(const std::string& key, double value) {
+    fields.emplace_back(key, value);
+    return *this;
+  }
+};
+
+// {"suite": ..., "results": [{"name": ..., <fields>}, ...]}
+inline void writeBenchJson(const std::string& path, const std::string& suite,
+                           const std::vector<BenchRecord>& records) {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    throw std::runtime_error("Failed to open file: " + path + "\n");
+  }
+  out << "{\n  \"suite\": \"" << suite << "\",\n  \"results\": [";
+  char number[64];
+  for (size_t i = 0; i < records.size(); i++) {
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << records[i].name << "\"";
+    for (const auto& [key, value] : records[i].fields) {
+      std::snprintf(number, sizeof(number), "%.9g", std::isfinite(value) ? value : 0.0);
+      out << ", \"" << key << "\": " << number;
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
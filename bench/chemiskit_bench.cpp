@@ -0,0 +1,238 @@
+// CPU-side micro benchmarks of ChemisKit_lib over synthetic water boxes of
+// 1k atoms up to --max-atoms (default 1M):
+//
+//   chemiskit_bench [--json out.json] [--max-atoms N] [--reps N]
+//
+// Cases: read_xyz, createSphere (each LOD level), toDraw, random-walk
+// trajectory generation (single- and multi-threaded), bond perception, BVH
+// build/refit/pick, octree build/refit/select, one RDF frame, hydrogen-bond
+// detection with and without a neighbor-list rebuild, periodic imaging of a
+// frame with torn molecules, frustum culling and LOD sorting.
+// A table goes to stdout; --json writes the same numbers for tracking runs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench_common.hpp"
+#include "bonds.hpp"
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "culling.hpp"
+#include "hbonds.hpp"
+#include "mesh.hpp"
+#include "molecule.hpp"
+#include "octree.hpp"
+#include "periodic.hpp"
+#include "random_walk.hpp"
+#include "rdf.hpp"
+#include "sphere_lod.hpp"
+#include "trajectory.hpp"
+
+static void writeXyz(const std::string& path, const Molecule& mol) {
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (f == nullptr) {
+    throw std::runtime_error("Failed to open file: " + path + "\n");
+  }
+  std::fprintf(f, "%zu\nchemiskit_bench\n", mol.size());
+  for (size_t i = 0; i < mol.size(); i++) {
+    std::fprintf(f, "%s %.5f %.5f %.5f\n", elementSymbol(mol.atomicNumbers[i]),
+                 mol.x[i], mol.y[i], mol.z[i]);
+  }
+  std::fclose(f);
+}
+
+// Camera looking at the centre of the box from outside, so culling and LOD
+// see a realistic mix of near, far and off-screen atoms.
+static OrbitCamera frameCamera(const Molecule& mol) {
+  glm::vec3 lo(1e30f), hi(-1e30f);
+  for (size_t i = 0; i < mol.size(); i++) {
+    glm::vec3 p(mol.x[i], mol.y[i], mol.z[i]);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  OrbitCamera cam;
+  cam.target = 0.5f * (lo + hi);
+  cam.distance = 0.6f * glm::length(hi - lo);
+  cam.yaw = 0.4f;
+  cam.farPlane = 10.0f * cam.distance + 100.0f;
+  return cam;
+}
+
+static void report(std::vector<BenchRecord>& records, const std::string& name, size_t atoms,
+                   const BenchTiming& t, double items) {
+  std::printf("%-22s %9zu atoms  %10.3f ms  (median %10.3f ms)  %8.2f M/s\n",
+              name.c_str(), atoms, t.best * 1e3, t.median * 1e3, items / t.best * 1e-6);
+  records.push_back(BenchRecord(name)
+                      .set("atoms", (double)atoms)
+                      .set("best_ms", t.best * 1e3)
+                      .set("median_ms", t.median * 1e3)
+                      .set("items_per_s", items / t.best));
+}
+
+auto main(int argc, char** argv) -> int {
+  std::string jsonPath;
+  size_t maxAtoms = 1000000;
+  int reps = 5;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string opt = argv[i];
+    if (opt == "--json") {
+      jsonPath = argv[i + 1];
+    } else if (opt == "--max-atoms") {
+      maxAtoms = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (opt == "--reps") {
+      reps = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      std::cerr << "Unknown option: " << opt << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<BenchRecord> records;
+
+  for (size_t l = 0; l < kSphereLodCount; l++) {
+    const SphereLodLevel& lod = kSphereLods[l];
+    size_t triangles = 0;
+    BenchTiming t = benchMeasure(reps * 20, [&] {
+      triangles = createSphere(1.0f, lod.sectors, lod.stacks).indices.size() / 3;
+    });
+    std::printf("createSphere %2dx%-2d     %9zu tris   %10.4f ms\n",
+                lod.sectors, lod.stacks, triangles, t.best * 1e3);
+    records.push_back(BenchRecord("createSphere")
+                        .set("sectors", lod.sectors)
+                        .set("stacks", lod.stacks)
+                        .set("triangles", (double)triangles)
+                        .set("best_ms", t.best * 1e3)
+                        .set("median_ms", t.median * 1e3));
+  }
+
+  const std::string scratch = "chemiskit_bench.tmp.xyz";
+  for (size_t n : benchSizes(maxAtoms)) {
+    Molecule mol = syntheticWater(n);
+
+    writeXyz(scratch, mol);
+    report(records, "read_xyz", n, benchMeasure(reps, [&] { read_xyz(scratch); }), (double)n);
+    std::remove(scratch.c_str());
+
+    std::vector<Instance> instances(n);
+    report(records, "toDraw", n, benchMeasure(reps, [&] { toDraw(mol, instances); }), (double)n);
+
+    const size_t frames = 10;
+    report(records, "trajectory_generation", n, benchMeasure(reps, [&] {
+      RandomWalkSource walk(mol, frames);
+      for (size_t f = 0; f < frames; f++) {
+        walk.readFrame(f, instances);
+      }
+    }), (double)(n * frames));
+    toDraw(mol, instances);
+
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+      threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+      RandomWalkGenerator walk(mol, 123456789, 0.05f, threads);
+      report(records, "walk_generate_x" + std::to_string(threads), n, benchMeasure(reps, [&] {
+        walk.generate(0, frames);
+      }), (double)(n * frames));
+    }
+
+    report(records, "bonds", n, benchMeasure(reps, [&] {
+      BondPerception perception;
+      perception.update(mol);
+    }), (double)n);
+
+    OrbitCamera cam = frameCamera(mol);
+    glm::mat4 view = cam.view();
+    glm::mat4 proj = cam.projection(1.5f);
+    Frustum frustum = frustumFromMatrix(proj * view);
+    std::vector<Instance> visible;
+    report(records, "cullSpheres", n, benchMeasure(reps, [&] {
+      cullSpheres(instances, frustum, visible);
+    }), (double)n);
+
+    SphereBvh bvh;
+    report(records, "bvh_build", n, benchMeasure(reps, [&] { bvh.build(instances); }), (double)n);
+    report(records, "bvh_refit", n, benchMeasure(reps, [&] { bvh.refit(instances); }), (double)n);
+    const int rays = 1000;
+    report(records, "bvh_pick", n, benchMeasure(reps, [&] {
+      // a fan of rays from the camera through the middle of the view
+      for (int r = 0; r < rays; r++) {
+        glm::vec3 dir = cam.target - cam.position();
+        dir.x += 0.002f * cam.distance * (float)(r % 32 - 16);
+        dir.y += 0.002f * cam.distance * (float)(r / 32 - 16);
+        bvh.pick(cam.position(), dir);
+      }
+    }), (double)rays);
+
+    AtomOctree octree;
+    report(records, "octree_build", n, benchMeasure(reps, [&] { octree.build(instances); }), (double)n);
+    report(records, "octree_refit", n, benchMeasure(reps, [&] { octree.refit(instances); }), (double)n);
+    {
+      OctreeQuery query;
+      query.frustum = frustum;
+      query.eye = cam.position();
+      query.pixelScale = proj[1][1] * 0.5f * 1080.0f;
+      OctreeSelection selection;
+      report(records, "octree_select", n, benchMeasure(reps, [&] {
+        octree.select(instances, query, selection);
+      }), (double)n);
+    }
+
+    {
+      float side = 3.1f * std::ceil(std::cbrt((float)((n + 2) / 3)));
+      RdfAccumulator rdf(std::min(8.0f, 0.5f * side), 160);
+      rdf.setBox(side, side, side);
+      report(records, "rdf_frame", n, benchMeasure(reps, [&] { rdf.accumulate(mol); }), (double)n);
+
+      HBondDetector hbonds;
+      hbonds.setBox(side, side, side);
+      report(records, "hbonds_rebuild", n, benchMeasure(reps, [&] {
+        hbonds.reset();
+        hbonds.update(mol, 0);
+      }), (double)n);
+      size_t frame = 1;
+      report(records, "hbonds_frame", n, benchMeasure(reps, [&] { hbonds.update(mol, frame++); }),
+             (double)n);
+
+      // every third oxygen moved a box length away from its hydrogens
+      BondPerception perception;
+      perception.setBox(side, side, side);
+      const float box[3] = {side, side, side};
+      float center[3];
+      boundsCenter(mol, center);
+      PeriodicImager imager;
+      imager.setBox(box);
+      imager.setCenter(center);
+      imager.setMolecules(n, perception.update(mol));
+      Molecule torn = mol;
+      for (size_t i = 0; i < n; i += 9) {
+        torn.x[i] += side;
+      }
+      // the kernel is branch-free, so later repetitions on the already
+      // imaged frame cost the same as the first
+      report(records, "periodic_image", n, benchMeasure(reps, [&] {
+        imager.apply(torn, instances);
+      }), (double)n);
+    }
+
+    SphereLodSorter sorter;
+    std::vector<Instance> sorted;
+    float pixelScale = proj[1][1] * 800.0f * 0.5f;
+    report(records, "lod_sort", n, benchMeasure(reps, [&] {
+      sorter.sort(instances, view, pixelScale, 1.0f, sorted);
+    }), (double)n);
+  }
+
+  if (!jsonPath.empty()) {
+    writeBenchJson(jsonPath, "chemiskit_bench", records);
+    std::cout << "Wrote " << jsonPath << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+// GPU draw throughput of SphereRenderer into an offscreen target, sweeping the
+// atom count from 1k to --max-atoms (default 1M) in every sphere mode:
+//
+//   chemviz_draw_bench [--json out.json] [--max-atoms N] [--frames N] [--size WxH]
+//
+// Every frame orbits the camera a little so culling, LOD sorting and the
+// instance upload run as they do while the user drags. Frame time is measured
+// with glFinish, so it covers CPU preparation plus GPU execution. Without a
+// display server the context comes from GLFW's null platform (OSMesa).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "bench_common.hpp"
+#include "camera.hpp"
+#include "frame_capture.hpp"
+#include "molecule.hpp"
+#include "render_state.hpp"
+#include "sphere_renderer.hpp"
+
+auto main(int argc, char** argv) -> int {
+  std::string jsonPath;
+  size_t maxAtoms = 1000000;
+  int frames = 60;
+  int width = 1280, height = 720;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string opt = argv[i];
+    if (opt == "--json") {
+      jsonPath = argv[i + 1];
+    } else if (opt == "--max-atoms") {
+      maxAtoms = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (opt == "--frames") {
+      frames = std::max(1, std::atoi(argv[i + 1]));
+    } else if (opt == "--size") {
+      if (std::sscanf(argv[i + 1], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        std::cerr << "Invalid --size: " << argv[i + 1] << "\n";
+        return 1;
+      }
+    } else {
+      std::cerr << "Unknown option: " << opt << "\n";
+      return 1;
+    }
+  }
+
+  if (std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+  if (!glfwInit()) {
+    std::cerr << "Failed to initialize GLFW\n";
+    return 1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  if (glfwGetPlatform() == GLFW_PLATFORM_NULL) {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+  }
+  GLFWwindow* window = glfwCreateWindow(width, height, "chemviz_draw_bench", NULL, NULL);
+  if (window == nullptr) {
+    std::cerr << "Failed to create GLFW window\n";
+    glfwTerminate();
+    return 1;
+  }
+  glfwMakeContextCurrent(window);
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "Failed to initialize GLAD\n";
+    glfwTerminate();
+    return 1;
+  }
+  std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+  std::vector<BenchRecord> records;
+  {
+    OffscreenTarget target(width, height);
+    target.bind();
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    CameraUniforms camera;
+
+    const char* modeNames[] = {"mesh_lod", "impostor", "octree"};
+    for (size_t n : benchSizes(maxAtoms)) {
+      Molecule mol = syntheticWater(n);
+      std::vector<Instance> instances(n);
+      toDraw(mol, instances);
+
+      glm::vec3 lo(1e30f), hi(-1e30f);
+      for (const Instance& s : instances) {
+        lo = glm::min(lo, glm::vec3(s.x, s.y, s.z));
+        hi = glm::max(hi, glm::vec3(s.x, s.y, s.z));
+      }
+      OrbitCamera cam;
+      cam.target = 0.5f * (lo + hi);
+      cam.distance = 0.6f * glm::length(hi - lo) + 5.0f;
+      cam.farPlane = 10.0f * cam.distance;
+      glm::mat4 proj = cam.projection((float)width / (float)height);
+
+      for (int mode : {SphereMeshLod, SphereImpostor, SphereOctree}) {
+        SphereRenderer spheres(n);
+        spheres.mode = mode;
+        spheres.setInstances(instances);
+
+        std::vector<double> times;
+        for (int f = -3; f < frames; f++) {
+          cam.yaw = 0.01f * (float)f;
+          auto t0 = std::chrono::steady_clock::now();
+          glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          camera.update(cam.view(), proj, height);
+          spheres.setView(cam.view(), proj, height, cam.distance);
+          spheres.prepare();
+          spheres.draw();
+          glFinish();
+          auto t1 = std::chrono::steady_clock::now();
+          // the first frames compile shaders and fill the stream buffer
+          if (f >= 0) {
+            times.push_back(std::chrono::duration<double>(t1 - t0).count());
+          }
+        }
+        spheres.release();
+
+        std::sort(times.begin(), times.end());
+        double best = times.front() * 1e3;
+        double median = times[times.size() / 2] * 1e3;
+        std::printf("%-9s %9zu atoms  drawn %9zu  %9.3f ms  (median %9.3f ms)  %7.1f fps\n",
+                    modeNames[mode], n, spheres.drawnCount(), best, median, 1e3 / median);
+        records.push_back(BenchRecord(std::string("draw_") + modeNames[mode])
+                            .set("atoms", (double)n)
+                            .set("drawn", (double)spheres.drawnCount())
+                            .set("width", width)
+                            .set("height", height)
+                            .set("best_ms", best)
+                            .set("median_ms", median)
+                            .set("fps", 1e3 / median));
+      }
+    }
+  }
+
+  if (!jsonPath.empty()) {
+    writeBenchJson(jsonPath, "chemviz_draw_bench", records);
+    std::cout << "Wrote " << jsonPath << "\n";
+  }
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,136 @@
+// XYZ parsing throughput: the original ifstream/operator>> reader against the
+// mmap + std::from_chars parser, single-threaded and across all cores.
+//
+//   chemviz_xyz_bench [file.xyz] [frames]
+//
+// A single-frame input is replicated `frames` times into a temporary file so
+// the numbers are not dominated by a few hundred kilobytes.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "molecule.hpp"
+#include "xyz_parser.hpp"
+
+// Array-of-structs atom as stored before the SoA Molecule.
+struct LegacyAtom {
+  std::string sym;
+  int atomicNumber;
+  float x, y, z;
+};
+
+// The pre-mmap implementation of read_xyz, extended to consume every frame.
+static std::vector<std::vector<LegacyAtom>> legacyReadFrames(const std::string& filename) {
+  std::ifstream xyz_file(filename);
+  if (!xyz_file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename + "\n");
+  }
+
+  std::vector<std::vector<LegacyAtom>> frames;
+  int natoms;
+  std::string comment;
+  while (xyz_file >> natoms) {
+    xyz_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::getline(xyz_file, comment);
+
+    std::vector<LegacyAtom> atoms;
+    std::string element;
+    float x, y, z;
+    while ((int)atoms.size() < natoms && xyz_file >> element >> x >> y >> z) {
+      int atomicNum = 0;
+      if (element == "H") {
+        atomicNum = 1;
+      } else if (element == "O") {
+        atomicNum = 8;
+      } else {
+        throw std::runtime_error("Unknown atom: " + element + "\n");
+      }
+      atoms.push_back({element, atomicNum, x, y, z});
+    }
+    if ((int)atoms.size() != natoms) {
+      throw std::runtime_error("Number of atoms not equal to mol.atoms");
+    }
+    frames.push_back(std::move(atoms));
+  }
+  return frames;
+}
+
+static double bestSeconds(int reps, const std::function<size_t()>& run, size_t& atoms) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < reps; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    atoms = run();
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+  }
+  return best;
+}
+
+template <class Frames>
+static size_t countAtoms(const Frames& frames) {
+  size_t n = 0;
+  for (const auto& f : frames) {
+    n += f.size();
+  }
+  return n;
+}
+
+auto main(int argc, char** argv) -> int {
+  std::string path = argc > 1 ? argv[1] : "./waterbox-1195.xyz";
+  size_t frames = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+  std::string input = path;
+  std::string scratch;
+  if (read_xyz_frames(path, 1).size() == 1) {
+    scratch = "chemviz_xyz_bench.tmp.xyz";
+    std::ifstream in(path, std::ios::binary);
+    std::string frame((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!frame.empty() && frame.back() != '\n') {
+      frame.push_back('\n');
+    }
+    std::ofstream out(scratch, std::ios::binary);
+    for (size_t f = 0; f < frames; f++) {
+      out << frame;
+    }
+    input = scratch;
+  }
+
+  std::ifstream probe(input, std::ios::binary | std::ios::ate);
+  double megabytes = (double)probe.tellg() / (1024.0 * 1024.0);
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+  struct Case {
+    std::string name;
+    std::function<size_t()> run;
+  };
+  std::vector<Case> cases = {
+    {"ifstream (legacy)", [&] { return countAtoms(legacyReadFrames(input)); }},
+    {"from_chars x1", [&] { return countAtoms(read_xyz_frames(input, 1)); }},
+    {"from_chars x" + std::to_string(cores), [&] { return countAtoms(read_xyz_frames(input, cores)); }},
+  };
+
+  std::cout << input << ": " << megabytes << " MB\n";
+  double baseline = 0.0;
+  for (const Case& c : cases) {
+    size_t atoms = 0;
+    double s = bestSeconds(3, c.run, atoms);
+    if (&c == &cases.front()) {
+      baseline = s;
+    }
+    std::printf("%-22s %9.1f MB/s  %7.3f s  %zu atoms  x%.1f\n",
+                c.name.c_str(), megabytes / s, s, atoms, baseline / s);
+  }
+
+  if (!scratch.empty()) {
+    std::remove(scratch.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+#include "molecule.hpp"
+
+// Hover and selection for the shown frame. The BVH is only refit when a
+// query needs it after the frame has moved, so frames nobody points at cost
+// nothing.
+class AtomPicker {
+public:
+  static constexpr uint32_t kNone = SphereBvh::kNone;
+
+  uint32_t hovered = kNone;
+  uint32_t selected = kNone;
+
+  // A BVH built for a new scene; clears hover and selection.
+  void reset(SphereBvh&& built);
+  // The shown atoms have new positions.
+  void moved() { stale = true; }
+
+  // Atom under normalized device coordinates (ndcX, ndcY), or kNone.
+  uint32_t pick(std::span<const Instance> atoms, const glm::mat4& viewProj, float ndcX,
+                float ndcY);
+
+  // Atoms whose centres lie within `radius` of `atom`, nearest first,
+  // without `atom` itself.
+  void neighbors(std::span<const Instance> atoms, uint32_t atom, float radius,
+                 std::vector<uint32_t>& out);
+
+private:
+  void refit(std::span<const Instance> atoms);
+
+  SphereBvh bvh;
+  bool stale = false;
+};
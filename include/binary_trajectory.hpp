@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "molecule.hpp"
+#include "trajectory.hpp"
+
+// On-disk layout (native byte order, every section 8-byte aligned):
+//
+//   BinaryTrajectoryHeader
+//   uint8_t  atomicNumbers[natoms]
+//   frames, each either
+//     float    xyz[natoms][3]                          (plain), or
+//     float    origin[3], step[3]; uint16_t q[natoms][3]  (quantized,
+//              x = origin + q * step, per-frame bounding box)
+//   uint64_t frameOffsets[nframes]                     (seek index)
+struct BinaryTrajectoryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t natoms;
+  uint64_t nframes;
+  uint64_t atomTableOffset;
+  uint64_t frameTableOffset;
+  uint64_t reserved[2];
+};
+
+static_assert(sizeof(BinaryTrajectoryHeader) == 64);
+
+constexpr char kBinaryTrajectoryMagic[8] = {'C', 'K', 'T', 'R', 'A', 'J', '\0', '\0'};
+constexpr uint32_t kBinaryTrajectoryVersion = 1;
+constexpr uint32_t kBinaryTrajectoryQuantized = 1u << 0;
+
+// Converts a (multi-frame) XYZ file one frame at a time, so memory use does
+// not depend on the trajectory length.
+void convertXyzToBinary(const std::string& xyzPath, const std::string& outPath, bool quantize);
+
+bool isBinaryTrajectory(const std::string& filename);
+
+// Memory-mapped binary trajectory. Frames are decoded straight from the
+// mapping; per-atom radius and color are resolved once on open.
+class BinaryTrajectory : public FrameSource {
+public:
+  explicit BinaryTrajectory(const std::string& filename);
+
+  size_t frameCount() const override { return header.nframes; }
+  size_t atomCount() const override { return header.natoms; }
+  bool quantized() const { return (header.flags & kBinaryTrajectoryQuantized) != 0; }
+
+  void readFrame(size_t index, std::vector<Instance>& out) override;
+  Molecule molecule(size_t index) const;
+
+private:
+  const char* frameData(size_t index) const;
+  void decode(size_t index, std::vector<Instance>& out) const;
+
+  MappedFile file;
+  BinaryTrajectoryHeader header;
+  const uint8_t* atomicNumbers = nullptr;
+  const uint64_t* frameOffsets = nullptr;
+  std::vector<Instance> style;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include <glad/glad.h>
+
+#include "bonds.hpp"
+#include "hbonds.hpp"
+
+// Covalent bonds as instanced cylinders and hydrogen bonds as instanced
+// dashed lines. The frame pipeline builds the instances; this uploads them
+// once per frame, after which every view showing that frame can draw them.
+// Both programs read the Camera block (see render_state.hpp).
+class BondRenderer {
+public:
+  BondRenderer();
+
+  BondRenderer(const BondRenderer&) = delete;
+  BondRenderer& operator=(const BondRenderer&) = delete;
+
+  float radius = 0.06f;
+
+  // Replace the drawn bonds; buffers grow by half again when they overflow.
+  void uploadBonds(std::span<const BondInstance> bonds);
+  void uploadHBonds(std::span<const HBondSegment> segments);
+
+  void drawBonds() const;
+  void drawHBonds() const;
+
+  // Deletes the GL objects; must run while the context is still current.
+  void release();
+
+private:
+  GLuint bondProgram = 0;
+  GLint radiusLoc = -1;
+  GLuint bondVAO = 0, bondVBO = 0, bondEBO = 0, bondInstanceVBO = 0;
+  GLsizei cylinderIndices = 0;
+  size_t bondCount = 0;
+  size_t bondCapacity = 0;
+
+  GLuint hbondProgram = 0;
+  GLuint hbondVAO = 0, hbondInstanceVBO = 0;
+  size_t hbondCount = 0;
+  size_t hbondCapacity = 0;
+};
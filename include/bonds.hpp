@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "molecule.hpp"
+
+struct Bond {
+  uint32_t a, b;
+};
+
+// One instanced cylinder; each half takes the color of its atom.
+struct BondInstance {
+  float ax, ay, az;
+  float bx, by, bz;
+  float ar, ag, ab;
+  float br, bg, bb;
+};
+
+// Covalent bond perception on a uniform grid (cell list). Cells are at least
+// as wide as the longest possible bond, so each atom is only tested against
+// the 27 surrounding cells and the cost is linear in the atom count.
+//
+// Bonds are stored grouped by owning cell. On later frames only cells that
+// contain a moved atom, or neighbor one, are re-evaluated; the rest are copied.
+class BondPerception {
+public:
+  // Added to the sum of covalent radii (angstrom).
+  float tolerance = 0.4f;
+
+  // Orthorhombic periodic box lengths; zero disables periodic boundaries.
+  void setBox(float lx, float ly, float lz);
+  void reset();
+
+  const std::vector<Bond>& update(const Molecule& mol);
+  const std::vector<Bond>& bonds() const { return all; }
+
+  size_t cellCount() const { return bondStart.size() - 1; }
+  size_t cellsRecomputed() const { return recomputed; }
+
+private:
+  void rebuildGrid(const Molecule& mol);
+  uint32_t cellOf(float x, float y, float z) const;
+  int neighborCells(uint32_t cell, uint32_t out[27]) const;
+  void perceiveCell(uint32_t cell, std::vector<Bond>& out);
+
+  float box[3] = {0.0f, 0.0f, 0.0f};
+  bool periodic = false;
+  bool stale = true;
+
+  float cellSize = 0.0f;
+  float origin[3] = {};
+  float extent[3] = {};
+  int dims[3] = {1, 1, 1};
+
+  std::vector<float> radius;
+  AlignedVector<float> px, py, pz;
+  std::vector<uint32_t> atomCell;
+  std::vector<uint32_t> cellStart;
+  std::vector<uint32_t> cellAtoms;
+  AlignedVector<float> sx, sy, sz, sr;
+  std::vector<uint8_t> dirty;
+  std::vector<uint8_t> recompute;
+  std::vector<uint32_t> bondStart = {0};
+  std::vector<Bond> all;
+  std::vector<Bond> next;
+  size_t recomputed = 0;
+};
+
+// Builds cylinder instances for `bonds` at the molecule's current positions.
+// Bonds crossing a periodic boundary are drawn as two stubs, one from each atom.
+void buildBondInstances(const Molecule& mol, std::span<const Bond> bonds,
+                        const float box[3], std::vector<BondInstance>& out);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "molecule.hpp"
+
+// Bounding volume hierarchy over atom spheres, for ray picking and radius
+// queries. The tree is built once by median splits; later trajectory frames
+// only refit the bounds over the same topology, which is a linear pass with
+// no allocation.
+class SphereBvh {
+public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  void build(std::span<const Instance> atoms);
+
+  // New positions for the same atoms; rebuilds if the atom count changed.
+  void refit(std::span<const Instance> atoms);
+
+  // Index of the nearest sphere hit by the ray, or kNone. `distance` receives
+  // the ray parameter of the hit in units of `dir`.
+  uint32_t pick(const glm::vec3& origin, const glm::vec3& dir, float* distance = nullptr) const;
+
+  // Appends the atoms whose centres lie within `radius` of `center`.
+  void gather(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+
+  size_t size() const { return order.size(); }
+  size_t nodeCount() const { return nodes.size(); }
+
+private:
+  // Leaves have count > 0 and cover order[first, first + count); inner nodes
+  // have count == 0 and their children at first and first + 1, which are
+  // always stored after the parent.
+  struct Node {
+    float lo[3];
+    uint32_t first;
+    float hi[3];
+    uint32_t count;
+  };
+
+  void refitNodes();
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> order;
+  std::vector<glm::vec4> spheres; // centre and radius, in leaf order
+};
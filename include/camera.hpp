@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Camera orbiting `target` at `distance`; yaw and pitch in radians.
+struct OrbitCamera {
+  glm::vec3 target = glm::vec3(0.0f);
+  float distance = 10.0f;
+  float yaw = 0.0f;
+  float pitch = 0.3f;
+
+  float fov = 45.0f;
+  float nearPlane = 0.01f;
+  float farPlane = 1000.0f;
+
+  glm::vec3 position() const {
+    glm::vec3 dir;
+    dir.x = cos(pitch) * sin(yaw);
+    dir.y = sin(pitch);
+    dir.z = cos(pitch) * cos(yaw);
+    return target + dir * distance;
+  }
+
+  glm::mat4 view() const {
+    return glm::lookAt(position(), target, glm::vec3(0,1,0));
+  }
+
+  glm::mat4 projection(float aspect) const {
+    return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
+  }
+};
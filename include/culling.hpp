@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "molecule.hpp"
+
+// The six clip planes of a view-projection matrix, normalized so that
+// a*x + b*y + c*z + d is the signed distance (positive inside).
+struct Frustum {
+  float a[6], b[6], c[6], d[6];
+};
+
+Frustum frustumFromMatrix(const glm::mat4& viewProj);
+
+// Copies the instances whose bounding sphere touches the frustum to the front
+// of `out`, preserving order, and returns how many were kept. `out` is resized
+// to in.size() so the copy is branch-free.
+size_t cullSpheres(std::span<const Instance> in, const Frustum& frustum,
+                   std::vector<Instance>& out);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "molecule.hpp"
+#include "trajectory.hpp"
+
+bool isDcdFile(const std::string& filename);
+
+// CHARMM / NAMD / X-PLOR DCD trajectory, memory-mapped. Every frame is the
+// same Fortran record sequence (optional unit cell, then X, Y and Z), so
+// frame i sits at a fixed stride and seeking is arithmetic. Either byte
+// order is accepted; files with fixed atoms are rejected. DCD carries no
+// elements, so they come from `topology` (e.g. read_pdb()), which must have
+// the same atom count.
+class DcdTrajectory : public FrameSource {
+public:
+  DcdTrajectory(const std::string& filename, const Molecule& topology);
+
+  size_t frameCount() const override { return nframes; }
+  size_t atomCount() const override { return natoms; }
+  bool hasUnitCell() const { return cellBytes > 0; }
+  // From the CHARMM unit cell record of the first frame.
+  bool unitCell(float cell[9]) const override;
+
+  void readFrame(size_t index, std::vector<Instance>& out) override;
+
+private:
+  MappedFile file;
+  bool swapped = false;
+  size_t natoms = 0;
+  size_t nframes = 0;
+  size_t firstFrame = 0;
+  size_t cellBytes = 0;
+  size_t frameStride = 0;
+  std::vector<Instance> style;
+};
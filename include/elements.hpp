@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Periodic table, resolved entirely at compile time.
+
+struct Element {
+  const char* symbol;
+  int atomicRadius;    // pm, empirical (Slater); covalent where not measured
+  int covalentRadius;  // pm, single-bond (Pyykko & Atsumi)
+  uint32_t color;      // 0xRRGGBB, Jmol CPK; H and O keep the viewer's shades
+};
+
+constexpr int kMaxAtomicNumber = 118;
+
+// Index 0 is the placeholder for unknown atoms.
+inline constexpr std::array<Element, kMaxAtomicNumber + 1> kElements = {{
+    {"X",   53,  53, 0xFF1493},  // 0
+    {"H",   25,  32, 0xCCCCCC},  // 1
+    {"He", 120,  46, 0xD9FFFF},  // 2
+    {"Li", 145, 133, 0xCC80FF},  // 3
+    {"Be", 105, 102, 0xC2FF00},  // 4
+    {"B",   85,  85, 0xFFB5B5},  // 5
+    {"C",   70,  75, 0x909090},  // 6
+    {"N",   65,  71, 0x3050F8},  // 7
+    {"O",   60,  63, 0xFF0000},  // 8
+    {"F",   50,  64, 0x90E050},  // 9
+    {"Ne", 160,  67, 0xB3E3F5},  // 10
+    {"Na", 180, 155, 0xAB5CF2},  // 11
+    {"Mg", 150, 139, 0x8AFF00},  // 12
+    {"Al", 125, 126, 0xBFA6A6},  // 13
+    {"Si", 110, 116, 0xF0C8A0},  // 14
+    {"P",  100, 111, 0xFF8000},  // 15
+    {"S",  100, 103, 0xFFFF30},  // 16
+    {"Cl", 100,  99, 0x1FF01F},  // 17
+    {"Ar",  71,  96, 0x80D1E3},  // 18
+    {"K",  220, 196, 0x8F40D4},  // 19
+    {"Ca", 180, 171, 0x3DFF00},  // 20
+    {"Sc", 160, 148, 0xE6E6E6},  // 21
+    {"Ti", 140, 136, 0xBFC2C7},  // 22
+    {"V",  135, 134, 0xA6A6AB},  // 23
+    {"Cr", 140, 122, 0x8A99C7},  // 24
+    {"Mn", 140, 119, 0x9C7AC7},  // 25
+    {"Fe", 140, 116, 0xE06633},  // 26
+    {"Co", 135, 111, 0xF090A0},  // 27
+    {"Ni", 135, 110, 0x50D050},  // 28
+    {"Cu", 135, 112, 0xC88033},  // 29
+    {"Zn", 135, 118, 0x7D80B0},  // 30
+    {"Ga", 130, 124, 0xC28F8F},  // 31
+    {"Ge", 125, 121, 0x668F8F},  // 32
+    {"As", 115, 121, 0xBD80E3},  // 33
+    {"Se", 115, 116, 0xFFA100},  // 34
+    {"Br", 115, 114, 0xA62929},  // 35
+    {"Kr", 117, 117, 0x5CB8D1},  // 36
+    {"Rb", 235, 210, 0x702EB0},  // 37
+    {"Sr", 200, 185, 0x00FF00},  // 38
+    {"Y",  180, 163, 0x94FFFF},  // 39
+    {"Zr", 155, 154, 0x94E0E0},  // 40
+    {"Nb", 145, 147, 0x73C2C9},  // 41
+    {"Mo", 145, 138, 0x54B5B5},  // 42
+    {"Tc", 135, 128, 0x3B9E9E},  // 43
+    {"Ru", 130, 125, 0x248F8F},  // 44
+    {"Rh", 135, 125, 0x0A7D8C},  // 45
+    {"Pd", 140, 120, 0x006985},  // 46
+    {"Ag", 160, 128, 0xC0C0C0},  // 47
+    {"Cd", 155, 136, 0xFFD98F},  // 48
+    {"In", 155, 142, 0xA67573},  // 49
+    {"Sn", 145, 140, 0x668080},  // 50
+    {"Sb", 145, 140, 0x9E63B5},  // 51
+    {"Te", 140, 136, 0xD47A00},  // 52
+    {"I",  140, 133, 0x940094},  // 53
+    {"Xe", 131, 131, 0x429EB0},  // 54
+    {"Cs", 260, 232, 0x57178F},  // 55
+    {"Ba", 215, 196, 0x00C900},  // 56
+    {"La", 195, 180, 0x70D4FF},  // 57
+    {"Ce", 185, 163, 0xFFFFC7},  // 58
+    {"Pr", 185, 176, 0xD9FFC7},  // 59
+    {"Nd", 185, 174, 0xC7FFC7},  // 60
+    {"Pm", 185, 173, 0xA3FFC7},  // 61
+    {"Sm", 185, 172, 0x8FFFC7},  // 62
+    {"Eu", 185, 168, 0x61FFC7},  // 63
+    {"Gd", 180, 169, 0x45FFC7},  // 64
+    {"Tb", 175, 168, 0x30FFC7},  // 65
+    {"Dy", 175, 167, 0x1FFFC7},  // 66
+    {"Ho", 175, 166, 0x00FF9C},  // 67
+    {"Er", 175, 165, 0x00E675},  // 68
+    {"Tm", 175, 164, 0x00D452},  // 69
+    {"Yb", 175, 170, 0x00BF38},  // 70
+    {"Lu", 175, 162, 0x00AB24},  // 71
+    {"Hf", 155, 152, 0x4DC2FF},  // 72
+    {"Ta", 145, 146, 0x4DA6FF},  // 73
+    {"W",  135, 137, 0x2194D6},  // 74
+    {"Re", 135, 131, 0x267DAB},  // 75
+    {"Os", 130, 129, 0x266696},  // 76
+    {"Ir", 135, 122, 0x175487},  // 77
+    {"Pt", 135, 123, 0xD0D0E0},  // 78
+    {"Au", 135, 124, 0xFFD123},  // 79
+    {"Hg", 150, 133, 0xB8B8D0},  // 80
+    {"Tl", 190, 144, 0xA6544D},  // 81
+    {"Pb", 180, 144, 0x575961},  // 82
+    {"Bi", 160, 151, 0x9E4FB5},  // 83
+    {"Po", 190, 145, 0xAB5C00},  // 84
+    {"At", 147, 147, 0x754F45},  // 85
+    {"Rn", 142, 142, 0x428296},  // 86
+    {"Fr", 223, 223, 0x420066},  // 87
+    {"Ra", 215, 201, 0x007D00},  // 88
+    {"Ac", 195, 186, 0x70ABFA},  // 89
+    {"Th", 180, 175, 0x00BAFF},  // 90
+    {"Pa", 180, 169, 0x00A1FF},  // 91
+    {"U",  175, 170, 0x008FFF},  // 92
+    {"Np", 175, 171, 0x0080FF},  // 93
+    {"Pu", 175, 172, 0x006BFF},  // 94
+    {"Am", 175, 166, 0x545CF2},  // 95
+    {"Cm", 166, 166, 0x785CE3},  // 96
+    {"Bk", 168, 168, 0x8A4FE3},  // 97
+    {"Cf", 168, 168, 0xA136D4},  // 98
+    {"Es", 165, 165, 0xB31FD4},  // 99
+    {"Fm", 167, 167, 0xB31FBA},  // 100
+    {"Md", 173, 173, 0xB30DA6},  // 101
+    {"No", 176, 176, 0xBD0D87},  // 102
+    {"Lr", 161, 161, 0xC70066},  // 103
+    {"Rf", 157, 157, 0xCC0059},  // 104
+    {"Db", 149, 149, 0xD1004F},  // 105
+    {"Sg", 143, 143, 0xD90045},  // 106
+    {"Bh", 141, 141, 0xE00038},  // 107
+    {"Hs", 134, 134, 0xE6002E},  // 108
+    {"Mt", 129, 129, 0xEB0026},  // 109
+    {"Ds", 128, 128, 0xEB0026},  // 110
+    {"Rg", 121, 121, 0xEB0026},  // 111
+    {"Cn", 122, 122, 0xEB0026},  // 112
+    {"Nh", 136, 136, 0xEB0026},  // 113
+    {"Fl", 143, 143, 0xEB0026},  // 114
+    {"Mc", 162, 162, 0xEB0026},  // 115
+    {"Lv", 175, 175, 0xEB0026},  // 116
+    {"Ts", 165, 165, 0xEB0026},  // 117
+    {"Og", 157, 157, 0xEB0026},  // 118
+}};
+
+// Per-element draw data derived from kElements, so building an instance is a
+// single indexed load.
+struct ElementStyle {
+  float radius;
+  float r, g, b;
+};
+
+inline constexpr std::array<ElementStyle, kMaxAtomicNumber + 1> kElementStyles = [] {
+  std::array<ElementStyle, kMaxAtomicNumber + 1> out{};
+  for (size_t z = 0; z < out.size(); z++) {
+    const Element& e = kElements[z];
+    out[z] = {
+      (float)((e.atomicRadius / 53.0) * 0.2),
+      (float)((e.color >> 16) & 0xFF) / 255.0f,
+      (float)((e.color >> 8) & 0xFF) / 255.0f,
+      (float)(e.color & 0xFF) / 255.0f,
+    };
+  }
+  return out;
+}();
+
+// Symbols are one or two letters, so (first, second) packs into a dense key
+// and the lookup is a perfect hash: one table load, no string comparison.
+constexpr int kSymbolKeys = 26 * 27;
+
+constexpr int symbolKey(char first, char second) {
+  int a = (first >= 'a' ? first - 'a' : first - 'A');
+  int b = second == '\0' ? 0 : (second >= 'a' ? second - 'a' : second - 'A') + 1;
+  return a * 27 + b;
+}
+
+inline constexpr std::array<uint8_t, kSymbolKeys> kSymbolTable = [] {
+  std::array<uint8_t, kSymbolKeys> out{};
+  for (size_t z = 1; z < kElements.size(); z++) {
+    const char* s = kElements[z].symbol;
+    out[(size_t)symbolKey(s[0], s[1])] = (uint8_t)z;
+  }
+  return out;
+}();
+
+constexpr bool isLetter(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// Case-insensitive ("CL", "cl" and "Cl" all resolve). Returns 0 if unknown.
+constexpr int elementFromSymbol(std::string_view sym) {
+  if (sym.empty() || sym.size() > 2 || !isLetter(sym[0])) {
+    return 0;
+  }
+  char second = '\0';
+  if (sym.size() == 2) {
+    if (!isLetter(sym[1])) {
+      return 0;
+    }
+    second = sym[1];
+  }
+  return kSymbolTable[(size_t)symbolKey(sym[0], second)];
+}
+
+static_assert([] {
+  for (size_t z = 1; z < kElements.size(); z++) {
+    if (elementFromSymbol(kElements[z].symbol) != (int)z) {
+      return false;
+    }
+  }
+  return true;
+}(), "symbol keys must not collide");
+static_assert(elementFromSymbol("Cl") == 17 && elementFromSymbol("CL") == 17);
+static_assert(elementFromSymbol("Og") == 118);
+static_assert(elementFromSymbol("Xx") == 0 && elementFromSymbol("") == 0);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Color + depth framebuffer object for rendering without a visible window.
+// A `sampled` target keeps its color in a texture, e.g. to show it in the UI.
+class OffscreenTarget {
+public:
+  OffscreenTarget(int width, int height, bool sampled = false);
+  ~OffscreenTarget();
+
+  OffscreenTarget(const OffscreenTarget&) = delete;
+  OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+  // Binds for drawing and reading and sets the viewport.
+  void bind() const;
+
+  int width() const { return w; }
+  int height() const { return h; }
+  // 0 unless sampled.
+  GLuint colorTexture() const { return sampled ? color : 0; }
+
+private:
+  GLuint fbo = 0;
+  GLuint color = 0;
+  GLuint depth = 0;
+  int w, h;
+  bool sampled;
+};
+
+// Saves rendered frames without stalling the render loop. glReadPixels goes
+// into a ring of pixel-pack buffers; a buffer is only mapped once its fence
+// has signalled (normally a couple of frames later), and the copied pixels
+// are encoded to PNG or PPM (by file extension) on a pool of worker threads.
+// GPU rendering, readback and compression of different frames overlap.
+class FrameCapture {
+public:
+  static constexpr int kSlots = 3;
+
+  explicit FrameCapture(unsigned threads = 0);
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  // Queues a read of the bound read framebuffer. Blocks only when every slot
+  // is still in flight.
+  void capture(int width, int height, const std::string& path);
+
+  // Hands finished readbacks to the encoders; call once per rendered frame.
+  void poll();
+
+  // Waits until every queued frame is written to disk.
+  void finish();
+
+  // Finishes, stops the encoders and deletes the pixel buffers; must run
+  // while the context is still current.
+  void release();
+
+  size_t written() const;
+  std::string error() const;
+
+private:
+  struct Slot {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    size_t capacity = 0;
+    int width = 0;
+    int height = 0;
+    std::string path;
+  };
+
+  struct Job {
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+    std::string path;
+  };
+
+  void collect(Slot& slot, bool wait);
+  void submit(Job job);
+  void work();
+
+  Slot slots[kSlots];
+  int nextSlot = 0;
+  int oldestSlot = 0;
+  int inFlight = 0;
+
+  std::vector<std::thread> workers;
+  mutable std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable jobDone;
+  std::deque<Job> jobs;
+  size_t maxQueued;
+  size_t busy = 0;
+  size_t done = 0;
+  bool stopping = false;
+  std::string firstError;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bonds.hpp"
+#include "hbonds.hpp"
+#include "molecule.hpp"
+#include "periodic.hpp"
+#include "trajectory.hpp"
+
+// What the preparer computes for each frame besides the sphere instances.
+struct FrameAnalysis {
+  bool bonds = true;
+  bool hbonds = false;
+  // Orthorhombic periodic box lengths; zero disables periodic boundaries.
+  float box[3] = {0.0f, 0.0f, 0.0f};
+  // With a box: make molecules whole and wrap them into the box around
+  // `center`, before anything else sees the frame.
+  bool image = false;
+  float center[3] = {0.0f, 0.0f, 0.0f};
+  // Keeps the molecule of this atom at `center`; kNone for none.
+  uint32_t recenterAtom = PeriodicImager::kNone;
+  float hbondDistance = 3.5f;
+  float hbondAngle = 30.0f;
+  float hbondSkin = 0.6f;
+};
+
+struct BondStats {
+  size_t bonds = 0;
+  size_t cellsRecomputed = 0;
+  size_t cells = 0;
+};
+
+struct HBondStats {
+  size_t bonds = 0;
+  size_t acceptors = 0;
+  size_t formed = 0;
+  size_t broken = 0;
+  double meanLifetime = 0.0;
+  size_t lifetimesRecorded = 0;
+  size_t lifetimeResolution = 0;
+  size_t trackingRestarts = 0;
+  size_t listRebuilds = 0;
+  size_t framesProcessed = 0;
+};
+
+// One frame, ready to upload: nothing in it needs more than a copy or a swap
+// on the render thread.
+struct FramePacket {
+  size_t frame = 0;
+  std::vector<Instance> instances;
+  Molecule mol;
+  // Only filled when the analysis asked for them.
+  bool hasBonds = false;
+  std::vector<BondInstance> bonds;
+  BondStats bondStats;
+  bool hasHBonds = false;
+  std::vector<HBondSegment> hbonds;
+  HBondStats hbondStats;
+  double prepareMs = 0.0;
+};
+
+// Prepares frames for the render thread on a worker: it takes decoded frames
+// from a TrajectoryStreamer, images them into the periodic box and runs bond
+// perception and hydrogen-bond detection on them, so the render thread only
+// uploads finished packets.
+//
+// The analysis is incremental (bond cells, H-bond lifetimes), so frames are
+// prepared one at a time, always the most recently requested one. If the
+// render thread asks for frames faster than they can be prepared, the ones
+// in between are never prepared.
+class FramePipeline {
+public:
+  // `topology` gives the elements; its positions are replaced frame by frame.
+  FramePipeline(std::unique_ptr<FrameSource> source, const Molecule& topology);
+  ~FramePipeline();
+
+  FramePipeline(const FramePipeline&) = delete;
+  FramePipeline& operator=(const FramePipeline&) = delete;
+
+  size_t frameCount() const { return streamer.frameCount(); }
+  size_t atomCount() const { return streamer.atomCount(); }
+
+  // The frame to prepare next; never blocks.
+  void request(size_t frame);
+  // Applies from the next prepared frame on, and prepares the requested
+  // frame again. A new box or new H-bond criteria restart the analysis.
+  void configure(const FrameAnalysis& analysis);
+
+  // The newest finished packet, once, or nullptr if none has finished since
+  // the last call. It may be for an older frame than the last request.
+  std::unique_ptr<FramePacket> take();
+  // Hands a shown packet back so its buffers are reused.
+  void recycle(std::unique_ptr<FramePacket> packet);
+
+  // Instances of any frame, as stored, without moving the playhead or
+  // touching the analysis; see TrajectoryStreamer::fetch(). Blocks, so call
+  // it from a worker.
+  void fetch(size_t frame, std::vector<Instance>& out) { streamer.fetch(frame, out); }
+
+  // Non-empty once decoding or preparing has failed; no more packets follow.
+  std::string error() const;
+
+private:
+  void run();
+  void prepare(FramePacket& packet, const std::vector<Instance>& instances,
+               const FrameAnalysis& analysis);
+
+  TrajectoryStreamer streamer;
+  Molecule topology;
+  BondPerception bondPerception;
+  HBondDetector hbondDetector;
+  PeriodicImager imager;
+  // Molecules come from the bonds of the first frame imaged in a new box.
+  bool moleculesStale = true;
+  uint32_t recenterAtom = PeriodicImager::kNone;
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  size_t requested = 0;
+  // Version of the analysis settings; bumped by configure().
+  uint64_t version = 1;
+  FrameAnalysis settings;
+  std::unique_ptr<FramePacket> ready;
+  std::unique_ptr<FramePacket> spare;
+  bool stopping = false;
+  std::string failure;
+  std::thread worker;
+};
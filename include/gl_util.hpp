@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <glad/glad.h>
+
+// Compile and link errors are logged to stderr; the object is still returned.
+// Programs using the Camera block (see render_state.hpp) get it bound to
+// kCameraBinding.
+GLuint compileShader(GLenum type, const char* src);
+GLuint createProgram(const char* vsSrc, const char* fsSrc);
+
+// Linked programs are kept on disk as driver binaries (glGetProgramBinary,
+// GL 4.1) under `dir`, one file per hash of the two sources and the GL
+// vendor, renderer and version strings. createProgram() then loads instead
+// of compiling; a binary the driver rejects is rebuilt and overwritten. An
+// empty `dir` (the default) disables the cache, as does a driver without
+// binary formats.
+void setProgramCacheDir(const std::string& dir);
+// $XDG_CACHE_HOME/chemviz/shaders, else ~/.cache/chemviz/shaders, else "".
+std::string defaultProgramCacheDir();
+
+struct ProgramCacheStats {
+  size_t loaded = 0;
+  size_t compiled = 0;
+};
+const ProgramCacheStats& programCacheStats();
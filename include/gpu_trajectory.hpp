@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "frame_pipeline.hpp"
+
+// A window of trajectory frames quantized to 16 bits per coordinate against
+// the window's bounding box. Texel (frame * atoms + atom) holds one atom as
+// RGBA16; alpha is padding, since GL 3.3 texture buffers have no RGB16.
+struct QuantizedFrames {
+  size_t first = 0;
+  size_t frames = 0;
+  size_t atoms = 0;
+  float origin[3] = {};
+  float extent[3] = {};
+  std::vector<uint16_t> texels;
+};
+
+// Fetches frames [first, first + count) from the pipeline's streamer, clamped
+// to its length. Frames are read in turn with the decoder, so playback goes
+// on while a window is prepared.
+QuantizedFrames quantizeFrames(FramePipeline& frames, size_t first, size_t count);
+
+// Quantized frames resident in a texture buffer, sampled by the vertex shaders
+// so playback only costs a time uniform per frame.
+class GpuTrajectory {
+public:
+  GpuTrajectory() = default;
+  ~GpuTrajectory();
+
+  GpuTrajectory(const GpuTrajectory&) = delete;
+  GpuTrajectory& operator=(const GpuTrajectory&) = delete;
+
+  void upload(const QuantizedFrames& frames);
+  void release();
+  void bind(GLenum unit) const;
+
+  bool loaded() const { return texture != 0; }
+  size_t first() const { return firstFrame; }
+  size_t frameCount() const { return frames; }
+  size_t atomCount() const { return atoms; }
+  size_t bytes() const { return frames * atoms * 4 * sizeof(uint16_t); }
+  const float* origin() const { return box; }
+  const float* extent() const { return box + 3; }
+
+private:
+  GLuint buffer = 0;
+  GLuint texture = 0;
+  size_t firstFrame = 0;
+  size_t frames = 0;
+  size_t atoms = 0;
+  float box[6] = {};
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "molecule.hpp"
+
+// D-H...A with D and A among N, O and F.
+struct HBond {
+  uint32_t donor, hydrogen, acceptor;
+};
+
+// One dashed line from the hydrogen to the acceptor.
+struct HBondSegment {
+  float ax, ay, az;
+  float bx, by, bz;
+};
+
+// Geometric hydrogen-bond detection: donor-acceptor distance below
+// `maxDistance` and hydrogen-donor-acceptor angle below `maxAngle`.
+//
+// Candidate acceptors come from a Verlet neighbor list: every N/O/F atom
+// within maxDistance + skin, found on a uniform grid so the build is
+// linear. Hydrogens are attached to their nearest donor at the same time.
+// The list is reused until some atom has moved more than half the skin since
+// it was built, so most frames only test the listed pairs.
+//
+// Bonds are tracked by frame index to measure lifetimes. Forward steps of up
+// to `maxGap` frames, as playback at speed or on a slow machine skips frames,
+// continue the tracking: a bond present at both ends is taken to have lasted
+// through the gap, so lifetimes are only resolved to the largest step taken.
+// Jumping backwards or further ahead restarts the tracking.
+class HBondDetector {
+public:
+  float maxDistance = 3.5f; // angstrom
+  float maxAngle = 30.0f;   // degrees
+  float skin = 0.6f;        // angstrom
+  size_t maxGap = 8;        // frames
+
+  // Orthorhombic periodic box lengths; zero disables periodic boundaries.
+  void setBox(float lx, float ly, float lz);
+  void reset();
+
+  const std::vector<HBond>& update(const Molecule& mol, size_t frame);
+  const std::vector<HBond>& bonds() const { return current; }
+
+  size_t framesProcessed() const { return frames; }
+  size_t listRebuilds() const { return rebuilds; }
+  size_t acceptorCount() const { return heavy.size(); }
+  size_t formed() const { return formedLast; }
+  size_t broken() const { return brokenLast; }
+  // Mean lifetime in frames of the bonds that have broken so far.
+  double meanLifetime() const { return ended ? lifetimeSum / (double)ended : 0.0; }
+  size_t lifetimesRecorded() const { return ended; }
+  // Largest frame step tracked across, i.e. the lifetime resolution.
+  size_t lifetimeResolution() const { return largestStep; }
+  size_t trackingRestarts() const { return restarts; }
+
+private:
+  bool listStale(const Molecule& mol) const;
+  void rebuild(const Molecule& mol);
+  void track(size_t frame);
+
+  float box[3] = {0.0f, 0.0f, 0.0f};
+  float invBox[3] = {0.0f, 0.0f, 0.0f};
+  bool periodic = false;
+
+  // heavy atoms (N/O/F) in grid cell order and, per heavy atom, attached
+  // hydrogens (atom indices) and listed neighbors (heavy indices), both as
+  // offsets into flat arrays
+  std::vector<uint32_t> heavy;
+  std::vector<uint32_t> hydrogenStart, hydrogens;
+  std::vector<uint32_t> neighborStart, neighbors;
+  AlignedVector<float> refX, refY, refZ;
+  AlignedVector<float> px, py, pz; // per-frame scratch, in heavy order
+  float listCutoff = 0.0f;
+  bool stale = true;
+
+  std::vector<HBond> current;
+
+  // (hydrogen << 32 | acceptor) of the bonds in the previous frame, sorted,
+  // with the frame each was first seen
+  std::vector<uint64_t> trackedKeys, nextKeys;
+  std::vector<size_t> trackedSince, nextSince;
+  size_t lastFrame = SIZE_MAX;
+
+  size_t frames = 0;
+  size_t rebuilds = 0;
+  size_t formedLast = 0;
+  size_t brokenLast = 0;
+  double lifetimeSum = 0.0;
+  size_t ended = 0;
+  size_t largestStep = 0;
+  size_t restarts = 0;
+};
+
+// Builds hydrogen-to-acceptor segments at the molecule's current positions,
+// taking the acceptor image nearest the hydrogen in a periodic box.
+void buildHBondSegments(const Molecule& mol, std::span<const HBond> hbonds,
+                        const float box[3], std::vector<HBondSegment>& out);
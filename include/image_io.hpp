@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encoders for 8-bit RGBA pixel rows as read back by glReadPixels (bottom row
+// first); alpha is dropped. Both throw std::runtime_error on I/O failure.
+
+// PNG (RGB, 8 bit) compressed with a single fixed-Huffman deflate block.
+void writePng(const std::string& path, const uint8_t* rgba, int width, int height);
+
+// Binary PPM (P6), uncompressed.
+void writePpm(const std::string& path, const uint8_t* rgba, int width, int height);
+
+// zlib stream (RFC 1950) of `data`, used by writePng.
+std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size);
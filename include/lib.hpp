@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+// Identifies the ChemisKit_lib target: the window-system independent core
+// (parsers, trajectories, bonds, culling, LOD, meshes, image encoding) shared
+// by chemviz, the benchmarks and the tests.
+struct library {
+  library();
+
+  std::string name;
+};
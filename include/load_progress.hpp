@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+// Progress of a long load, written by the loading thread and polled by the UI.
+// Setting `cancel` makes the loader throw at its next progress report.
+struct LoadProgress {
+  std::atomic<const char*> stage{""};
+  std::atomic<size_t> done{0};
+  std::atomic<size_t> total{0};
+  std::atomic<bool> cancel{false};
+
+  void begin(const char* name, size_t work) {
+    stage.store(name, std::memory_order_relaxed);
+    done.store(0, std::memory_order_relaxed);
+    total.store(work, std::memory_order_relaxed);
+  }
+
+  void advance(size_t value) {
+    done.store(value, std::memory_order_relaxed);
+    if (cancel.load(std::memory_order_relaxed)) {
+      throw std::runtime_error("Loading cancelled\n");
+    }
+  }
+
+  float fraction() const {
+    size_t t = total.load(std::memory_order_relaxed);
+    return t > 0 ? (float)((double)done.load(std::memory_order_relaxed) / (double)t) : 0.0f;
+  }
+};
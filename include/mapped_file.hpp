@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const char* bytes = nullptr;
+  size_t length = 0;
+};
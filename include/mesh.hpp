@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+// Interleaved position/normal vertices (6 floats each) and triangle indices.
+struct Mesh {
+  std::vector<float> vertices;
+  std::vector<unsigned int> indices;
+};
+
+// UV sphere centred on the origin.
+Mesh createSphere(float radius, int sectorCount, int stackCount);
+
+// Open unit cylinder along +Y (y in [0, 1], radius 1), oriented per instance
+// in the bond vertex shader. Caps are hidden inside the atom spheres.
+Mesh createCylinder(int sectorCount);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Instance {
+  float x, y ,z;
+  float radius;
+  float r, g, b;
+};
+
+// Cache-line aligned storage so coordinate loops vectorize without peeling.
+template <class T, size_t Align = 64>
+struct AlignedAllocator {
+  using value_type = T;
+
+  template <class U>
+  struct rebind {
+    using other = AlignedAllocator<U, Align>;
+  };
+
+  AlignedAllocator() = default;
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+  }
+
+  void deallocate(T* p, size_t) {
+    ::operator delete(p, std::align_val_t(Align));
+  }
+
+  template <class U>
+  bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+};
+
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Structure-of-arrays atom storage: 13 bytes per atom. Symbols are interned
+// by atomic number in the periodic table rather than stored per atom.
+struct Molecule {
+  AlignedVector<float> x, y, z;
+  std::vector<uint8_t> atomicNumbers;
+
+  size_t size() const {
+    return atomicNumbers.size();
+  }
+
+  void resize(size_t n);
+  void addAtom(int atomicNumber, float ax, float ay, float az);
+
+  std::string_view symbol(size_t i) const;
+
+  // Copies the positions of a decoded trajectory frame.
+  void setPositions(std::span<const Instance> frame);
+
+  std::span<float> xs() { return x; }
+  std::span<float> ys() { return y; }
+  std::span<float> zs() { return z; }
+  std::span<const float> xs() const { return x; }
+  std::span<const float> ys() const { return y; }
+  std::span<const float> zs() const { return z; }
+  std::span<const uint8_t> elements() const { return atomicNumbers; }
+};
+
+int atomicNumber(std::string_view element);
+const char* elementSymbol(int atomicNumber);
+
+Molecule read_xyz(std::string filename);
+
+// Fills `out` (one instance per atom) with positions and per-element style.
+void toDraw(const Molecule& mol, std::span<Instance> out);
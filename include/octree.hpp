@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "culling.hpp"
+#include "molecule.hpp"
+
+// 12-byte atom for the point pass: position normalized to 16 bits over the
+// octree bounds, radius as an IEEE half float and an 8-bit color.
+struct PackedInstance {
+  uint16_t x, y, z;
+  uint16_t radius;
+  uint8_t r, g, b, a;
+};
+static_assert(sizeof(PackedInstance) == 12);
+
+// What to draw for one view. Point ranges index packed() and are already
+// merged where adjacent. Each far node contributes one aggregate sprite.
+// Near leaves come back as full-precision instances.
+struct OctreeSelection {
+  std::vector<int32_t> pointFirst;
+  std::vector<int32_t> pointCount;
+  std::vector<PackedInstance> aggregates;
+  std::vector<Instance> spheres;
+  size_t points = 0;
+  size_t nodesVisited = 0;
+
+  void clear();
+};
+
+struct OctreeQuery {
+  Frustum frustum;
+  bool cull = true;
+  glm::vec3 eye{0.0f};
+  // proj[1][1] * framebufferHeight / 2, as for SphereLodSorter
+  float pixelScale = 1.0f;
+  // nodes whose projected radius is below this many pixels draw as one sprite
+  float aggregatePixels = 2.0f;
+  // leaves whose largest atom projects to at least this many pixels draw
+  // their atoms as spheres, other leaves as points
+  float spherePixels = 4.0f;
+};
+
+// Octree over the atoms for very large systems. Atoms are ordered along a
+// Morton curve of their quantized centres; every node covers one contiguous
+// range of that order, so the packed copy can sit in a static GL buffer and a
+// view only selects ranges of it. Distant nodes collapse to a single sprite
+// with their mean color, and only leaves near the camera go back to full
+// spheres.
+//
+// Later trajectory frames refit the bounds and repack over the same order.
+// The tree is rebuilt when the atom count changes or an atom leaves the
+// quantization bounds, which keep a margin for drift.
+class AtomOctree {
+public:
+  static constexpr uint32_t kLeafSize = 64;
+  static constexpr int kMaxDepth = 10;
+
+  void build(std::span<const Instance> atoms);
+  void refit(std::span<const Instance> atoms);
+
+  // `atoms` must be the span the tree was last built or refit from.
+  void select(std::span<const Instance> atoms, const OctreeQuery& query,
+              OctreeSelection& out) const;
+
+  std::span<const PackedInstance> packed() const { return packedAtoms; }
+  // Packed positions map to origin + p / 65535 * extent.
+  const float* origin() const { return lo; }
+  const float* extent() const { return size; }
+
+  size_t atomCount() const { return order.size(); }
+  size_t nodeCount() const { return nodes.size(); }
+  size_t rebuildCount() const { return rebuilds; }
+
+private:
+  // Children of inner nodes are stored consecutively after their parent.
+  struct Node {
+    float lo[3];
+    uint32_t first;
+    float hi[3];
+    uint32_t count;
+    uint32_t firstChild;
+    uint32_t childCount;
+    float maxRadius;
+    PackedInstance aggregate;
+  };
+
+  // Returns false if an atom left the quantization bounds.
+  bool repack(std::span<const Instance> atoms);
+  PackedInstance pack(const Instance& a) const;
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> order;
+  std::vector<PackedInstance> packedAtoms;
+  float lo[3] = {0.0f, 0.0f, 0.0f};
+  float size[3] = {1.0f, 1.0f, 1.0f};
+  float scale[3] = {0.0f, 0.0f, 0.0f};
+  size_t rebuilds = 0;
+};
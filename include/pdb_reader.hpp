@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "molecule.hpp"
+
+// True for the .pdb / .ent extensions (any case).
+bool isPdbFile(const std::string& filename);
+
+// Reads the ATOM and HETATM records of the first model of a PDB file. The
+// element comes from columns 77-78, or from the atom name when those are
+// blank, as in files written by older tools.
+Molecule read_pdb(const std::string& filename);
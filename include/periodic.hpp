@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bonds.hpp"
+#include "molecule.hpp"
+#include "worker_pool.hpp"
+
+// Midpoint of the bounding box of the atoms (zero if there are none): the
+// box centre for a periodic system, and the middle of the structure for a
+// single molecule however unevenly its atoms are spread.
+void boundsCenter(const Molecule& mol, float center[3]);
+
+// Box lengths of a unit cell given as box vectors a, b, c (cell[0..2] is a),
+// or false if the cell is not orthorhombic (off-diagonal terms above rounding)
+// or is degenerate.
+bool orthorhombicLengths(const float cell[9], float box[3]);
+
+// Periodic imaging of trajectory frames in an orthorhombic box, as done before
+// analysis in MD tools: every molecule is made whole across the boundaries
+// (unwrap), then wrapped as a unit into the box around `center` (wrap).
+// Optionally the whole frame is first shifted so the centroid of one
+// molecule stays at `center` (recentering).
+//
+// Molecules are the connected components of the bond graph. A first pass
+// places each molecule's first atom inside the box; a second, branch-free
+// pass over the SoA coordinates moves every atom to the image nearest that
+// atom. It reads the per-molecule values through an index, which compilers
+// vectorize with gathers (AVX2) and otherwise leave a tight scalar loop. Both
+// passes are split across a persistent worker pool for large frames.
+// Molecules must span less than half the box.
+class PeriodicImager {
+public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // `threads` = 0 uses one per hardware thread.
+  explicit PeriodicImager(unsigned threads = 0);
+
+  // Orthorhombic periodic box lengths; zero disables imaging.
+  void setBox(const float box[3]);
+  bool periodic() const { return enabled; }
+
+  // Groups atoms into molecules by `bonds`; unbonded atoms stand alone.
+  void setMolecules(size_t atomCount, std::span<const Bond> bonds);
+  size_t atomCount() const { return moleculeOf.size(); }
+  size_t moleculeCount() const { return firstAtom.size(); }
+
+  void setCenter(const float center[3]);
+  // Keeps the molecule containing `atom` at the centre; kNone stops.
+  void recenterOn(uint32_t atom);
+
+  // Images `mol` in place and copies the positions into `out`, which may be
+  // empty. Does nothing without a box or if the atom counts differ.
+  void apply(Molecule& mol, std::span<Instance> out);
+
+private:
+  void selectionCentroid(const Molecule& mol, float out[3]) const;
+
+  WorkerPool pool;
+  bool enabled = false;
+  float box[3] = {0.0f, 0.0f, 0.0f};
+  float inverse[3] = {0.0f, 0.0f, 0.0f};
+  float center[3] = {0.0f, 0.0f, 0.0f};
+
+  std::vector<uint32_t> moleculeOf; // per atom
+  std::vector<uint32_t> firstAtom;  // per molecule
+  std::vector<uint32_t> selection;
+  // per molecule: first atom before imaging, and where the wrap puts it
+  AlignedVector<float> anchorX, anchorY, anchorZ;
+  AlignedVector<float> placedX, placedY, placedZ;
+};
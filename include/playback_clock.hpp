@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Playback timeline driven by wall-clock time rather than by rendered frames,
+// so the trajectory plays at `rate` frames per second whatever the display
+// rate is. When frames take longer to prepare than the rate allows, the
+// timeline keeps going and the frames in between are skipped.
+//
+// Positions are in trajectory frames and loop over the range
+// [first, first + count). Times are in seconds, on any monotonic clock.
+class PlaybackClock {
+public:
+  static constexpr size_t kHistory = 240;
+
+  // Frames per second of trajectory time.
+  float rate = 30.0f;
+
+  void setRange(size_t first, size_t count);
+  size_t first() const { return rangeFirst; }
+  size_t count() const { return rangeCount; }
+
+  void play(double now);
+  void pause();
+  bool playing() const { return running; }
+
+  // Jumps to `frame`, clamped to the range.
+  void seek(size_t frame);
+
+  // Advances the position by the time since the last tick.
+  void tick(double now);
+  // Fractional frame, for interpolating playback.
+  double position() const { return pos; }
+  // Frame that should be on screen.
+  size_t frame() const { return (size_t)pos; }
+
+  // Records that `shown` reached the screen at `now`: how long since the
+  // previous one, how many frames were passed over on the way, and whether
+  // it was behind the timeline.
+  void present(size_t shown, double now);
+
+  struct Pacing {
+    size_t presented = 0;
+    size_t skipped = 0;  // frames the timeline passed that were never shown
+    size_t late = 0;     // presents of a frame over one behind the timeline
+    double meanMs = 0.0; // intervals between presents, over the history
+    double p95Ms = 0.0;
+    double maxMs = 0.0;
+    double jitterMs = 0.0; // standard deviation
+  };
+  Pacing pacing() const;
+  // Intervals between the recent presents in ms, oldest first.
+  const std::vector<float>& intervals() const { return history; }
+  void resetPacing();
+
+private:
+  size_t rangeFirst = 0;
+  size_t rangeCount = 1;
+  double pos = 0.0;
+  double lastTick = 0.0;
+  bool running = false;
+
+  size_t presented = 0;
+  size_t skipped = 0;
+  size_t late = 0;
+  size_t lastShown = 0;
+  double lastPresent = -1.0;
+  std::vector<float> history;
+};
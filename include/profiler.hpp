@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Per-phase CPU and GPU timings for the last kHistory frames.
+//
+// CPU scopes nest and use steady_clock. GPU scopes wrap GL_TIME_ELAPSED
+// queries, which cannot overlap, so they must not nest; results are read
+// kLatency frames later so the CPU never waits on the GPU.
+class FrameProfiler {
+public:
+  static constexpr size_t kHistory = 240;
+  static constexpr size_t kLatency = 4;
+
+  FrameProfiler();
+  ~FrameProfiler();
+
+  FrameProfiler(const FrameProfiler&) = delete;
+  FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+  void beginFrame();
+  void endFrame();
+
+  void beginCpu(const char* name);
+  void endCpu();
+
+  void beginGpu(const char* name);
+  void endGpu();
+
+  // Rolling graphs and a percentile table in an ImGui window.
+  void drawWindow(bool* open);
+
+  // Chrome trace (chrome://tracing, Perfetto) of the recorded history; GPU
+  // phases go on their own track, placed at the time they were issued.
+  void writeChromeTrace(const std::string& path) const;
+
+  // Deletes the GL queries; must run while the context is still current.
+  void release();
+
+private:
+  struct Section {
+    std::string name;
+    float cpuMs[kHistory] = {};
+    float gpuMs[kHistory] = {};
+  };
+
+  struct Event {
+    uint32_t section;
+    bool gpu;
+    uint64_t frame;
+    double startUs;
+    double durationUs;
+  };
+
+  struct PendingQuery {
+    GLuint query;
+    uint32_t section;
+    uint64_t frame;
+    double startUs;
+  };
+
+  uint32_t sectionIndex(const char* name);
+  double nowUs() const;
+  void collectQueries(std::vector<PendingQuery>& slot);
+
+  std::chrono::steady_clock::time_point epoch;
+  std::vector<Section> sections;
+  std::vector<Event> events;
+  std::vector<std::pair<uint32_t, double>> cpuStack;
+
+  uint64_t frame = 0;
+  double frameStartUs = 0.0;
+  float frameMs[kHistory] = {};
+  size_t recorded = 0;
+
+  std::vector<GLuint> freeQueries;
+  std::vector<PendingQuery> pending[kLatency];
+  bool gpuActive = false;
+  PendingQuery activeQuery{};
+};
+
+// Times the enclosing block on the CPU.
+class CpuScope {
+public:
+  CpuScope(FrameProfiler& profiler, const char* name) : profiler(profiler) {
+    profiler.beginCpu(name);
+  }
+  ~CpuScope() { profiler.endCpu(); }
+
+private:
+  FrameProfiler& profiler;
+};
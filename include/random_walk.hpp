@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "molecule.hpp"
+#include "worker_pool.hpp"
+
+// Counter-based random numbers: every value is a pure function of a key and a
+// counter, so any thread can produce any part of the stream without shared
+// state. mixBits is the "lowbias32" integer hash.
+inline uint32_t mixBits(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+// Per-step key derived from the 64-bit seed (splitmix64 finalizer).
+inline uint32_t walkStepKey(uint64_t seed, uint64_t step) {
+  uint64_t z = seed + (step + 1) * 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return (uint32_t)(z ^ (z >> 31));
+}
+
+// Synthetic random walk of every atom around a starting structure, used for
+// load-testing the renderer. Each step moves every coordinate by a uniform
+// amount in [-stepSize, stepSize) drawn from the counter (step, atom, axis),
+// so a frame is bit-identical for a given seed whatever the thread count.
+// Atoms are split across a persistent worker pool in cache-line sized blocks
+// and the inner loop is plain integer hashing over SoA arrays, which the
+// compiler vectorizes.
+//
+// A frame is the sum of every step before it, so positions are checkpointed
+// every `interval` frames as the walk passes them: seeking, backwards or far
+// ahead, resumes from the nearest checkpoint at or before the target. The
+// interval doubles whenever the checkpoints would exceed `checkpointBytes`,
+// which keeps memory bounded however long the walk gets.
+class RandomWalkGenerator {
+public:
+  // `threads` = 0 uses one per hardware thread.
+  RandomWalkGenerator(const Molecule& start, uint64_t seed, float stepSize = 0.05f,
+                      unsigned threads = 0, size_t checkpointBytes = size_t(64) << 20);
+
+  // Positions after `frame` steps (frame 0 is the start).
+  const Molecule& seek(size_t frame);
+
+  // Positions of frames [first, first + count), generated in one pass with
+  // each thread walking its atoms through all of them.
+  std::vector<Molecule> generate(size_t first, size_t count);
+
+  size_t frame() const { return current; }
+  size_t atomCount() const { return start.size(); }
+
+  size_t checkpointInterval() const { return interval; }
+  size_t checkpointCount() const { return checkpoints.size(); }
+  // Steps computed since construction, including replays after seeks.
+  size_t stepsComputed() const { return stepped; }
+
+private:
+  struct Checkpoint {
+    size_t frame;
+    AlignedVector<float> x, y, z;
+  };
+
+  // Runs `steps` steps from `current`, copying the positions into
+  // frames[0..steps) if given, and checkpoints the frames it passes.
+  void advance(size_t steps, Molecule* frames);
+  void walk(size_t steps, Molecule* frames);
+  void checkpoint();
+
+  Molecule start;
+  Molecule positions;
+  uint64_t seed;
+  float stepSize;
+  WorkerPool pool;
+  size_t current = 0;
+  size_t stepped = 0;
+
+  size_t checkpointBytes;
+  size_t interval = 16;
+  std::vector<Checkpoint> checkpoints; // ascending frames
+};
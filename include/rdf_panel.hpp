@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "molecule.hpp"
+#include "rdf.hpp"
+
+// The "Radial distribution" window. While it is open, each trajectory frame
+// the playhead reaches is accumulated once, on a worker so playback never
+// waits for it.
+class RdfPanel {
+public:
+  explicit RdfPanel(size_t frameCount);
+
+  RdfPanel(const RdfPanel&) = delete;
+  RdfPanel& operator=(const RdfPanel&) = delete;
+
+  bool open = false;
+
+  // A new trajectory: clears the histograms, keeping the box and range.
+  void reset(size_t frameCount);
+  // Orthorhombic periodic box lengths; zero disables periodic boundaries.
+  void setBox(float lx, float ly, float lz);
+
+  // Starts accumulating the shown frame unless it was counted already or
+  // another frame is still running.
+  void offer(size_t frame, const Molecule& mol);
+  // Picks up a finished frame; call once per render loop iteration.
+  void poll();
+
+  void draw();
+
+private:
+  // Settings changes must wait for the running frame.
+  void restart();
+
+  RdfAccumulator rdf;
+  float cutoff;
+  int bins;
+  float box[3] = {0.0f, 0.0f, 0.0f};
+  std::vector<uint8_t> counted;
+  std::vector<std::vector<float>> curves;
+  size_t frames = 0;
+  // Copy of the frame being accumulated; declared before the job it outlives.
+  Molecule frame;
+  std::future<void> job;
+};
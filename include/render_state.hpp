@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform buffer binding point of the Camera block in every program.
+constexpr GLuint kCameraBinding = 0;
+
+// Inserts the Camera block (view, projection, light) and the shade() helper
+// after the #version line of `src`. GLSL 3.30 has no binding qualifier, so
+// createProgram() attaches the block to kCameraBinding by name.
+std::string withCameraBlock(const char* src);
+
+// Camera and light shared by every program through one uniform buffer, so a
+// view is uploaded once rather than set on each program before each draw.
+// Shaders read it whenever they run: update() before drawing a view.
+class CameraUniforms {
+public:
+  CameraUniforms();
+  ~CameraUniforms();
+
+  CameraUniforms(const CameraUniforms&) = delete;
+  CameraUniforms& operator=(const CameraUniforms&) = delete;
+
+  // View-space direction toward the light; the default is a headlight.
+  glm::vec3 lightDir{0.0f, 0.0f, 1.0f};
+  float ambient = 0.2f;
+
+  // Uploads the view and binds the buffer to kCameraBinding. `height` is the
+  // viewport height in pixels, for point sprite sizes.
+  void update(const glm::mat4& view, const glm::mat4& proj, int height);
+
+  // Deletes the buffer; must run while the context is still current.
+  void release();
+
+private:
+  GLuint ubo = 0;
+};
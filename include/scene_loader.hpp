@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+#include "load_progress.hpp"
+#include "molecule.hpp"
+#include "octree.hpp"
+#include "trajectory.hpp"
+
+// Everything the viewer needs to show frame 0 of a file, computed off the
+// render thread so swapping it in is just moves.
+struct LoadedScene {
+  std::string path;
+  Molecule mol;
+  std::vector<Instance> instances;
+  std::unique_ptr<FrameSource> source;
+  SphereBvh bvh;
+  // Only built for systems above the octree threshold given to loadScene().
+  AtomOctree octree;
+  // Middle of frame 0's bounding box: the camera target, and the centre
+  // periodic imaging wraps around.
+  glm::vec3 center{0.0f};
+  // Periodic box from the file, if it has one.
+  bool periodic = false;
+  float box[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Multi-frame XYZ files, binary trajectories, DCD and XTC (with a PDB of the
+// same name for elements) are played back as-is; a single structure (XYZ or
+// PDB) gets the synthetic random walk used for load testing. `mol` receives
+// frame 0.
+std::unique_ptr<FrameSource> openFrameSource(const std::string& path, Molecule& mol,
+                                             LoadProgress* progress = nullptr);
+
+LoadedScene loadScene(const std::string& path, size_t octreeAtoms,
+                      LoadProgress* progress = nullptr);
+
+// Runs loadScene() on a background thread. The render loop polls once per
+// frame and gets the finished scene exactly once. Starting another load
+// cancels the running one; its thread is joined once it has noticed, so
+// neither start() nor poll() waits on a parse in progress.
+class SceneLoader {
+public:
+  SceneLoader() = default;
+  ~SceneLoader();
+
+  SceneLoader(const SceneLoader&) = delete;
+  SceneLoader& operator=(const SceneLoader&) = delete;
+
+  void start(const std::string& path, size_t octreeAtoms);
+  void cancel();
+
+  // The finished scene, or nullptr while loading, after a failure or when
+  // idle. Also reaps cancelled loads that have stopped.
+  std::unique_ptr<LoadedScene> poll();
+
+  bool busy() const { return current != nullptr; }
+  // Valid while busy().
+  const std::string& path() const { return current->path; }
+  const LoadProgress& progress() const { return current->progress; }
+
+  // Message of the last failed load; cleared by start().
+  const std::string& error() const { return failure; }
+
+private:
+  struct Job {
+    std::string path;
+    LoadProgress progress;
+    std::unique_ptr<LoadedScene> scene;
+    std::string failure;
+    std::atomic<bool> finished{false};
+    std::thread thread;
+  };
+
+  void reap(bool wait);
+
+  std::unique_ptr<Job> current;
+  std::vector<std::unique_ptr<Job>> cancelled;
+  std::string failure;
+};
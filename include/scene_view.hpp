@@ -0,0 +1,83 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bond_renderer.hpp"
+#include "camera.hpp"
+#include "frame_capture.hpp"
+#include "frame_pipeline.hpp"
+#include "gpu_trajectory.hpp"
+#include "render_state.hpp"
+#include "sphere_renderer.hpp"
+
+// A further 3D view in its own ImGui window, so it can be docked beside the
+// main view or dragged out into a separate OS window. It draws the shared
+// SphereRenderer through its own SphereView into a sampled offscreen target.
+struct SceneView {
+  int id = 0;
+  bool open = true;
+  bool visible = false;
+  OrbitCamera cam;
+  SphereView spheres;
+  std::unique_ptr<OffscreenTarget> target;
+  // Frame shown instead of the playhead. CPU playback fetches it from the
+  // pipeline's streamer on a worker and shows it once read; GPU playback
+  // just draws another time of the window.
+  bool follow = true;
+  int frame = 0;
+  std::future<std::vector<Instance>> pinJob;
+  // `frame` changed while pinJob was running
+  bool repin = false;
+};
+
+// The extra views. They share the sphere renderer, the GPU trajectory and
+// the bond buffers with the main view; each only owns its camera-dependent
+// uploads.
+class SceneViews {
+public:
+  SceneViews() = default;
+
+  SceneViews(const SceneViews&) = delete;
+  SceneViews& operator=(const SceneViews&) = delete;
+
+  bool empty() const { return views.empty(); }
+
+  // Opens a view with the main camera, pinned to `frame` once unfollowed.
+  void add(const OrbitCamera& cam, int frame);
+  // A new trajectory: every view follows the playhead, aimed at `target`.
+  // Pinned frames come from `frames`, which pin jobs keep alive.
+  void reset(std::shared_ptr<FramePipeline> frames, const glm::vec3& target);
+  // GPU playback ended: reads the frames of pinned views again.
+  void repin();
+
+  // Drops closed views and shows the pinned frames read since the last call.
+  // Closed views go here rather than at their window's End(), since the
+  // previous frame's draw data may still show their texture.
+  void update(bool gpuPlayback);
+  // Each view's window; pinned frames are limited to [first, last].
+  void drawWindows(bool gpuPlayback, int first, int last);
+  // Renders every visible view into its target, after the main view, whose
+  // upload views that don't depend on the camera draw from. Leaves the last
+  // target bound.
+  void render(SphereRenderer& spheres, CameraUniforms& camera, const BondRenderer& bonds,
+              bool showBonds, bool showHBonds, const GpuTrajectory* gpu, double playTime);
+
+  // Deletes the GL objects; must run while the context is still current.
+  void release();
+
+private:
+  // Starts reading the frame a view is pinned to (CPU playback).
+  void pin(SceneView& sv);
+  // Dropping a std::async future blocks until it finishes, so jobs nobody
+  // wants any more are polled here instead.
+  void abandon(std::future<std::vector<Instance>>& job);
+
+  std::vector<std::unique_ptr<SceneView>> views;
+  std::vector<std::future<std::vector<Instance>>> abandoned;
+  std::shared_ptr<FramePipeline> pipeline;
+  int nextId = 2;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "molecule.hpp"
+
+// Sphere tessellations from finest to coarsest. A sphere uses the first level
+// whose minimum projected radius (in pixels) it reaches.
+struct SphereLodLevel {
+  int sectors;
+  int stacks;
+  float minPixels;
+};
+
+constexpr size_t kSphereLodCount = 4;
+constexpr SphereLodLevel kSphereLods[kSphereLodCount] = {
+  {64, 32, 48.0f},
+  {32, 16, 16.0f},
+  {16, 8, 5.0f},
+  {8, 4, 0.0f},
+};
+
+// Contiguous run of instances per level in the sorted instance array.
+struct LodBuckets {
+  std::array<size_t, kSphereLodCount> first{};
+  std::array<size_t, kSphereLodCount> count{};
+};
+
+// Orders instances by level of detail so each level is one instanced draw.
+class SphereLodSorter {
+public:
+  // `pixelScale` is proj[1][1] * framebufferHeight / 2: the projected size in
+  // pixels of one unit at unit view depth. `bias` scales the projected radius.
+  LodBuckets sort(std::span<const Instance> in, const glm::mat4& view,
+                  float pixelScale, float bias, std::vector<Instance>& out);
+
+private:
+  std::vector<uint8_t> level;
+};
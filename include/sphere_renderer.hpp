@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "molecule.hpp"
+#include "octree.hpp"
+#include "sphere_lod.hpp"
+#include "stream_buffer.hpp"
+
+class FrameProfiler;
+class GpuTrajectory;
+
+enum SphereMode { SphereMeshLod = 0, SphereImpostor = 1, SphereOctree = 2 };
+
+class SphereRenderer;
+
+// Everything about drawing spheres that depends on one camera: the culled and
+// LOD-sorted instances or the octree selection, and the stream they are
+// uploaded through. A SphereRenderer draws any number of views; its mesh,
+// programs, current frame, octree and GPU trajectory exist once. A view only
+// uploads when its own camera, the frame or the settings changed, and views
+// whose instances don't depend on the camera (GPU playback, impostors without
+// culling) all draw from the renderer's primary upload.
+class SphereView {
+public:
+  // Streams sized for `atomCapacity` instances; 0 grows on first use.
+  explicit SphereView(size_t atomCapacity = 0);
+
+  SphereView(const SphereView&) = delete;
+  SphereView& operator=(const SphereView&) = delete;
+
+  // `focusDistance` picks the single LOD level used with a GPU trajectory.
+  void setView(const glm::mat4& view, const glm::mat4& proj, int height, float focusDistance);
+
+  // Draws `instances` (atom order, e.g. another trajectory frame to compare)
+  // instead of the renderer's frame, until followFrame(). Octree mode draws
+  // a pinned frame as culled impostors, since the octree is the renderer's.
+  void pinFrame(std::vector<Instance>&& instances);
+  void followFrame();
+  bool pinned() const { return isPinned; }
+
+  // Time (frames into the window) while the renderer has a GPU trajectory.
+  void setGpuTime(double time) { gpuTime = time; }
+
+  void setUploadMode(StreamBuffer::Mode mode);
+  StreamBuffer::Mode uploadMode() const { return stream.mode(); }
+
+  size_t drawnCount() const { return drawn; }
+  const LodBuckets& buckets() const { return lodBuckets; }
+  const OctreeSelection& octreeSelection() const { return selection; }
+  size_t uploadBytes() const { return lastUploadBytes; }
+  double uploadMs() const { return lastUploadMs; }
+
+  // Deletes the GL objects; must run while the context is still current.
+  void release();
+
+private:
+  friend class SphereRenderer;
+
+  StreamBuffer stream;
+  size_t instanceOffset = 0;
+  // Drawing from the renderer's primary upload instead of `stream`.
+  bool shared = false;
+  GLuint aggregateVBO = 0;
+
+  bool isPinned = false;
+  std::vector<Instance> frame;
+  std::vector<Instance> visible;
+  std::vector<Instance> lodInstances;
+  SphereLodSorter lodSorter;
+  LodBuckets lodBuckets;
+  size_t drawn = 0;
+  OctreeSelection selection;
+  double gpuTime = 0.0;
+
+  glm::mat4 view{1.0f};
+  glm::mat4 proj{1.0f};
+  int height = 1;
+  float focusDistance = 1.0f;
+
+  // State the current upload was built from.
+  bool instancesChanged = true;
+  uint64_t lastFrameVersion = 0;
+  glm::mat4 lastViewProj{0.0f};
+  int lastHeight = 0;
+  int lastMode = -1;
+  bool lastCulling = false;
+  bool lastGpu = false;
+  float lastLodBias = 0.0f;
+  float lastAggregatePixels = 0.0f;
+  float lastSpherePixels = 0.0f;
+
+  size_t lastUploadBytes = 0;
+  double lastUploadMs = 0.0;
+};
+
+// Draws one sphere per atom, either as LOD meshes bucketed by projected size
+// or as ray-cast impostors, after optional frustum culling. Instances go
+// through a StreamBuffer and are only rebuilt when the frame, the settings or
+// (for view-dependent passes) the camera changed.
+//
+// SphereOctree is for systems too large for either: atoms are kept quantized
+// in an AtomOctree whose packed copy lives in a static buffer, drawn as point
+// sprites by node ranges. Distant nodes collapse to one sprite and only near
+// leaves stream full impostor spheres. It needs CPU positions, so GPU
+// trajectory playback draws impostors instead.
+//
+// The renderer owns a primary SphereView, which setView(), prepare(), draw()
+// and the statistics refer to. Further views are drawn with prepare(view)
+// and draw(view) after the primary one has been prepared for the frame.
+class SphereRenderer {
+public:
+  explicit SphereRenderer(size_t atomCapacity);
+
+  SphereRenderer(const SphereRenderer&) = delete;
+  SphereRenderer& operator=(const SphereRenderer&) = delete;
+
+  int mode = SphereMeshLod;
+  float lodBias = 1.0f;
+  bool frustumCulling = true;
+  // SphereOctree thresholds in projected pixels (see OctreeQuery), both
+  // scaled by lodBias.
+  float aggregatePixels = 2.0f;
+  float spherePixels = 4.0f;
+
+  static constexpr size_t kNoHighlight = SIZE_MAX;
+
+  // Instances of the current frame, in atom order.
+  void setInstances(std::span<const Instance> instances);
+  // Same without the copy: exchanges buffers, so `instances` gets the
+  // previous frame back for reuse.
+  void swapInstances(std::vector<Instance>& instances);
+
+  // Switches to a different system: takes over its frame-0 instances and, if
+  // already built, their octree, clears the highlight and resizes the primary
+  // stream to `atomCapacity` atoms (as in the constructor).
+  void replaceInstances(std::vector<Instance>&& instances, AtomOctree&& built,
+                        size_t atomCapacity);
+
+  // Draws atom `index` in the highlight color (kNoHighlight for none). Kept
+  // across setInstances().
+  void setHighlight(size_t index);
+
+  // Positions come from `trajectory` instead of the instances, at `time`
+  // (frames into its window) for the primary view; nullptr returns to CPU
+  // positions.
+  void setGpuTrajectory(const GpuTrajectory* trajectory, double time);
+
+  void setView(const glm::mat4& view, const glm::mat4& proj, int height, float focusDistance) {
+    primary.setView(view, proj, height, focusDistance);
+  }
+
+  // Culls, sorts and uploads if anything changed since the last call.
+  void prepare(FrameProfiler* profiler = nullptr) { prepare(primary, profiler); }
+  void prepare(SphereView& view, FrameProfiler* profiler = nullptr);
+  // Reads the camera from the Camera block, so CameraUniforms must hold the
+  // view given to setView().
+  void draw() { draw(primary); }
+  void draw(SphereView& view);
+
+  void setUploadMode(StreamBuffer::Mode mode) { primary.setUploadMode(mode); }
+  StreamBuffer::Mode uploadMode() const { return primary.uploadMode(); }
+
+  // Current instances in atom order, including the highlight color.
+  std::span<const Instance> instances() const { return shown; }
+  size_t atomCount() const { return shown.size(); }
+  size_t drawnCount() const { return primary.drawnCount(); }
+  const LodBuckets& buckets() const { return primary.buckets(); }
+  const OctreeSelection& octreeSelection() const { return primary.octreeSelection(); }
+  const AtomOctree& atomOctree() const { return octree; }
+  size_t uploadBytes() const { return primary.uploadBytes(); }
+  double uploadMs() const { return primary.uploadMs(); }
+
+  // Deletes the GL objects; must run while the context is still current.
+  void release();
+
+private:
+  void bindInstanceAttribs(size_t base) const;
+  void applyHighlight();
+  // Locations of the trajectory fetch uniforms, resolved once per program.
+  struct TrajectoryUniforms {
+    GLint gpu = -1;
+    GLint time = -1;
+    GLint frameCount = -1;
+    GLint atomCount = -1;
+    GLint origin = -1;
+    GLint extent = -1;
+  };
+  static TrajectoryUniforms resolveTrajectoryUniforms(GLuint program);
+  void setTrajectoryUniforms(const TrajectoryUniforms& u, double time) const;
+  void uploadFrame(SphereView& view);
+  void prepareOctree(SphereView& view, const glm::mat4& viewProj, FrameProfiler* profiler);
+  void drawOctree(SphereView& view);
+
+  GLuint meshProgram = 0;
+  GLuint impostorProgram = 0;
+  GLuint meshVAO = 0, meshVBO = 0, meshEBO = 0;
+  GLuint impostorVAO = 0, quadVBO = 0;
+  GLuint pointProgram = 0;
+  TrajectoryUniforms meshUniforms;
+  TrajectoryUniforms impostorUniforms;
+  GLint pointOrigin = -1;
+  GLint pointExtent = -1;
+  GLuint packedVAO = 0, packedVBO = 0;
+  GLuint aggregateVAO = 0;
+  size_t lodIndexFirst[kSphereLodCount] = {};
+  size_t lodIndexCount[kSphereLodCount] = {};
+
+  SphereView primary;
+  // frameVersion of the atom-order frame in the primary stream, 0 if that
+  // holds a view-dependent upload.
+  uint64_t sharedVersion = 0;
+
+  std::vector<Instance> shown;
+  // Bumped whenever `shown` changes.
+  uint64_t frameVersion = 1;
+  AtomOctree octree;
+  bool octreeStale = true;
+  bool packedStale = true;
+  size_t highlight = kNoHighlight;
+  float highlightSaved[3] = {};
+
+  const GpuTrajectory* gpuTrajectory = nullptr;
+};
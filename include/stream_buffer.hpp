@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Streams per-frame vertex data into a GL buffer without stalling on draws
+// that still read the previous contents.
+//
+//   Orphan      one region, re-specified with glBufferData before each write
+//   FencedRing  kRegions regions written with unsynchronized maps, each
+//               guarded by a fence placed after the draws that read it
+//   Persistent  like FencedRing, but the buffer is created with
+//               glBufferStorage and stays mapped (GL 4.4 / ARB_buffer_storage)
+class StreamBuffer {
+public:
+  enum Mode { Orphan = 0, FencedRing = 1, Persistent = 2 };
+  static constexpr int kRegions = 3;
+
+  StreamBuffer(size_t capacity, Mode mode);
+  ~StreamBuffer();
+
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+  static bool persistentSupported();
+
+  // Switches strategy; Persistent falls back to FencedRing when unsupported.
+  void setMode(Mode mode);
+  Mode mode() const { return current; }
+
+  // Copies `bytes` into the next free region, growing the buffer if needed,
+  // and returns the byte offset of the copy within buffer(). Leaves buffer()
+  // bound to GL_ARRAY_BUFFER.
+  size_t upload(const void* data, size_t bytes);
+
+  // Reallocates regions of `capacity` bytes, shrinking as well as growing.
+  // The previous contents are lost unless the size is unchanged.
+  void resize(size_t capacity);
+
+  // Call after the draws that read the last upload have been issued.
+  void fence();
+
+  GLuint buffer() const { return vbo; }
+
+  // Deletes the GL objects; must run while the context is still current.
+  void release();
+
+  // Totals since the last resetStats(); time includes waits on fences.
+  size_t bytesUploaded() const { return bytes; }
+  double uploadSeconds() const { return seconds; }
+  void resetStats();
+
+private:
+  void create();
+
+  Mode current;
+  size_t regionSize = 0;
+  int region = 0;
+  GLuint vbo = 0;
+  GLsync fences[kRegions] = {};
+  char* mapped = nullptr;
+
+  size_t bytes = 0;
+  double seconds = 0.0;
+};
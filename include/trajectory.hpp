@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "molecule.hpp"
+#include "random_walk.hpp"
+
+// A random-access sequence of frames, decoded straight into draw instances.
+struct FrameSource {
+  virtual ~FrameSource() = default;
+
+  virtual size_t frameCount() const = 0;
+  virtual size_t atomCount() const = 0;
+  virtual void readFrame(size_t index, std::vector<Instance>& out) = 0;
+  // Unit cell of the first frame as box vectors a, b, c (cell[0..2] is a), in
+  // Angstrom, if the file gives one.
+  virtual bool unitCell(float /*cell*/[9]) const { return false; }
+  // Lengths of that cell for PeriodicImager; false without a cell or if it
+  // is not orthorhombic.
+  bool periodicBox(float box[3]) const;
+};
+
+// Multi-frame XYZ file (frames concatenated back to back), memory-mapped.
+// Frame offsets are indexed once on open; frames are parsed on demand.
+class XyzTrajectory : public FrameSource {
+public:
+  explicit XyzTrajectory(const std::string& filename, LoadProgress* progress = nullptr);
+
+  size_t frameCount() const override { return offsets.size(); }
+  size_t atomCount() const override { return natoms; }
+  void readFrame(size_t index, std::vector<Instance>& out) override;
+  void readMolecule(size_t index, Molecule& out, LoadProgress* progress = nullptr);
+  // From the extended XYZ Lattice= of the first frame.
+  bool unitCell(float cell[9]) const override;
+
+private:
+  MappedFile file;
+  Molecule frame;
+  std::vector<size_t> offsets;
+  size_t natoms = 0;
+  float lattice[9] = {};
+  bool hasLattice = false;
+};
+
+// Synthetic random walk around a starting molecule, used for load-testing the
+// renderer. Frames come from a RandomWalkGenerator, so they are reproducible
+// for a seed and computed in parallel for large systems.
+class RandomWalkSource : public FrameSource {
+public:
+  RandomWalkSource(const Molecule& mol, size_t frames, uint64_t seed = 123456789,
+                   unsigned threads = 0);
+
+  size_t frameCount() const override { return frames; }
+  size_t atomCount() const override { return walk.atomCount(); }
+  void readFrame(size_t index, std::vector<Instance>& out) override;
+  // The walk stays in the cell of the structure it starts from.
+  void setUnitCell(const float cell[9]);
+  bool unitCell(float cell[9]) const override;
+
+private:
+  RandomWalkGenerator walk;
+  size_t frames;
+  float lattice[9] = {};
+  bool hasLattice = false;
+};
+
+// Decodes frames on a background thread into `capacity` slots ahead of the
+// playhead. Frames that fall behind the playhead stay in a least-recently-used
+// cache of up to `cacheBytes` (and at most kMaxCachedFrames frames), so
+// scrubbing backwards does not re-decode (or, for generated sources, replay)
+// them. Resident memory is bounded regardless of the trajectory length, and
+// lookups go through a frame -> slot map rather than scanning the slots.
+class TrajectoryStreamer {
+public:
+  TrajectoryStreamer(std::unique_ptr<FrameSource> source, size_t capacity = 8,
+                     size_t cacheBytes = size_t(64) << 20);
+  ~TrajectoryStreamer();
+
+  TrajectoryStreamer(const TrajectoryStreamer&) = delete;
+  TrajectoryStreamer& operator=(const TrajectoryStreamer&) = delete;
+
+  size_t frameCount() const { return count; }
+  size_t atomCount() const { return source->atomCount(); }
+
+  // Moves the playhead to `frame` and returns its instances if they have
+  // already been decoded, or nullptr if not (never blocks). The returned
+  // pointer stays valid until the next call to acquire().
+  const std::vector<Instance>* acquire(size_t frame);
+  // Like acquire(), but waits up to `timeout` for the frame to be decoded.
+  const std::vector<Instance>* acquire(size_t frame, std::chrono::milliseconds timeout);
+
+  // Copies `frame` into `out` without moving the playhead, for readers other
+  // than the player (e.g. views pinned to another frame): from the cache if
+  // it holds the frame, else read from the source on the calling thread, in
+  // turn with the decoder. Blocks, and throws if the read fails.
+  void fetch(size_t frame, std::vector<Instance>& out);
+
+  // Non-empty once the decoder thread has failed; it stops producing frames.
+  std::string error() const;
+
+  static constexpr size_t kMaxCachedFrames = 4096;
+
+private:
+  enum class SlotState { Empty, Filling, Ready };
+
+  struct Slot {
+    size_t frame = 0;
+    SlotState state = SlotState::Empty;
+    std::list<size_t>::iterator use; // position in `recent` once Ready
+    std::vector<Instance> instances;
+  };
+
+  bool inWindow(size_t frame) const;
+  const std::vector<Instance>* find(size_t frame);
+  void run();
+
+  std::unique_ptr<FrameSource> source;
+  // Held around every read of `source`; never while waiting for `mutex`.
+  std::mutex sourceMutex;
+  size_t count;
+  size_t ahead;
+  std::vector<Slot> slots;
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable decoded;
+  size_t playhead = 0;
+  std::unordered_map<size_t, size_t> resident; // frame -> Filling or Ready slot
+  std::list<size_t> recent;                    // Ready slots, most recent first
+  std::vector<size_t> empty;
+  bool stopping = false;
+  std::string failure;
+  std::thread worker;
+};
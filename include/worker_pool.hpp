@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join threads for per-frame parallel passes. The threads are started on
+// the first parallel run and then wait for the next one, so a pass run every
+// frame does not pay for creating and joining threads each time.
+class WorkerPool {
+public:
+  // `threads` counts the calling thread; 0 uses one per hardware thread.
+  explicit WorkerPool(unsigned threads = 0);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  unsigned size() const { return threads; }
+
+  // Runs task(t) for every t in [0, count), count clamped to size(), with
+  // task(0) on the calling thread, and returns once all have finished. Not
+  // reentrant: one run at a time.
+  void run(unsigned count, const std::function<void(unsigned)>& task);
+
+private:
+  void work(unsigned index);
+
+  unsigned threads;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  const std::function<void(unsigned)>* current = nullptr;
+  unsigned active = 0;
+  unsigned pending = 0;
+  uint64_t generation = 0;
+  bool stopping = false;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "molecule.hpp"
+#include "trajectory.hpp"
+
+bool isXtcFile(const std::string& filename);
+
+// GROMACS XTC trajectory, memory-mapped. Frames are compressed to different
+// sizes, so the first open walks the frame headers (skipping the compressed
+// data) and caches the offsets next to the file as <file>.ckidx. Later opens
+// read that index, and seeking is a lookup. The cache is tied to the file's
+// size and modification time and simply rebuilt if either changed or it
+// cannot be written.
+//
+// Coordinates are converted from nm to Angstrom. Elements come from
+// `topology`, which must have the same atom count.
+class XtcTrajectory : public FrameSource {
+public:
+  XtcTrajectory(const std::string& filename, const Molecule& topology,
+                LoadProgress* progress = nullptr);
+
+  size_t frameCount() const override { return offsets.size(); }
+  size_t atomCount() const override { return natoms; }
+  // True if the frame index came from the cache file.
+  bool indexCached() const { return cached; }
+  // The box of the first frame; a zero box means none.
+  bool unitCell(float cell[9]) const override;
+
+  void readFrame(size_t index, std::vector<Instance>& out) override;
+
+private:
+  bool loadIndex(const std::string& indexPath, int64_t mtime);
+  void saveIndex(const std::string& indexPath, int64_t mtime) const;
+  void buildIndex(LoadProgress* progress);
+
+  MappedFile file;
+  std::string name;
+  std::vector<uint64_t> offsets;
+  size_t natoms = 0;
+  bool cached = false;
+  std::vector<Instance> style;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "load_progress.hpp"
+#include "molecule.hpp"
+
+// Scans an in-memory XYZ file for frame boundaries and returns the byte offset
+// of each frame's atom-count line. Every frame must have the same atom count,
+// which is returned through `natoms`. Stops after `maxFrames` frames.
+// `progress`, if given, counts bytes scanned.
+std::vector<size_t> indexXyzFrames(const char* data, size_t size, size_t& natoms,
+                                   size_t maxFrames = SIZE_MAX,
+                                   LoadProgress* progress = nullptr);
+
+// Parses the frame starting at `offset` (as returned by indexXyzFrames) with
+// std::from_chars; independent of the global locale. `progress`, if given,
+// counts atoms parsed.
+void parseXyzFrame(const char* data, size_t size, size_t offset, size_t natoms,
+                   Molecule& out, LoadProgress* progress = nullptr);
+
+// Box vectors from the comment line of the frame at `offset`, in extended XYZ
+// form: Lattice="ax ay az bx by bz cx cy cz", stored in that order. False if
+// there is no complete lattice (the cell is left untouched).
+bool parseXyzLattice(const char* data, size_t size, size_t offset, float cell[9]);
+
+// Maps the file and parses all frames, split across `threads` workers
+// (0 = one per hardware thread).
+std::vector<Molecule> read_xyz_frames(const std::string& filename, unsigned threads = 0);
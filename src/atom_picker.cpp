@@ -0,0 +1,43 @@
+#include "atom_picker.hpp"
+
+#include <algorithm>
+
+void AtomPicker::reset(SphereBvh&& built) {
+  bvh = std::move(built);
+  stale = false;
+  hovered = kNone;
+  selected = kNone;
+}
+
+void AtomPicker::refit(std::span<const Instance> atoms) {
+  if (stale) {
+    bvh.refit(atoms);
+    stale = false;
+  }
+}
+
+uint32_t AtomPicker::pick(std::span<const Instance> atoms, const glm::mat4& viewProj, float ndcX,
+                          float ndcY) {
+  refit(atoms);
+  glm::mat4 invViewProj = glm::inverse(viewProj);
+  glm::vec4 nearPoint = invViewProj * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+  glm::vec4 farPoint = invViewProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+  glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+  return bvh.pick(origin, glm::vec3(farPoint) / farPoint.w - origin);
+}
+
+void AtomPicker::neighbors(std::span<const Instance> atoms, uint32_t atom, float radius,
+                           std::vector<uint32_t>& out) {
+  out.clear();
+  if (atom >= atoms.size()) {
+    return;
+  }
+  refit(atoms);
+  const glm::vec3 p(atoms[atom].x, atoms[atom].y, atoms[atom].z);
+  auto dist = [&](uint32_t i) {
+    return glm::length(glm::vec3(atoms[i].x, atoms[i].y, atoms[i].z) - p);
+  };
+  bvh.gather(p, radius, out);
+  std::erase(out, atom);
+  std::sort(out.begin(), out.end(), [&](uint32_t a, uint32_t b) { return dist(a) < dist(b); });
+}
@@ -0,0 +1,201 @@
+#include "binary_trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "elements.hpp"
+
+static size_t alignUp(size_t n) {
+  return (n + 7) & ~size_t(7);
+}
+
+static size_t frameBytes(size_t natoms, bool quantize) {
+  return quantize
+    ? alignUp(6 * sizeof(float) + natoms * 3 * sizeof(uint16_t))
+    : alignUp(natoms * 3 * sizeof(float));
+}
+
+static void pad(std::ofstream& out) {
+  static const char zeros[8] = {};
+  std::streamoff pos = out.tellp();
+  out.write(zeros, (std::streamsize)(alignUp((size_t)pos) - (size_t)pos));
+}
+
+void convertXyzToBinary(const std::string& xyzPath, const std::string& outPath, bool quantize) {
+  XyzTrajectory xyz(xyzPath);
+
+  std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    throw std::runtime_error("Failed to open file: " + outPath + "\n");
+  }
+
+  BinaryTrajectoryHeader header{};
+  std::memcpy(header.magic, kBinaryTrajectoryMagic, sizeof(header.magic));
+  header.version = kBinaryTrajectoryVersion;
+  header.flags = quantize ? kBinaryTrajectoryQuantized : 0;
+  header.natoms = xyz.atomCount();
+  header.nframes = xyz.frameCount();
+  header.atomTableOffset = sizeof(BinaryTrajectoryHeader);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  Molecule mol;
+  xyz.readMolecule(0, mol);
+  out.write(reinterpret_cast<const char*>(mol.atomicNumbers.data()), (std::streamsize)mol.size());
+  pad(out);
+
+  std::vector<uint64_t> offsets;
+  offsets.reserve(header.nframes);
+  std::vector<float> positions(mol.size() * 3);
+  std::vector<uint16_t> packed(mol.size() * 3);
+
+  for (size_t f = 0; f < header.nframes; f++) {
+    xyz.readMolecule(f, mol);
+    offsets.push_back((uint64_t)out.tellp());
+
+    if (!quantize) {
+      for (size_t i = 0; i < mol.size(); i++) {
+        positions[3 * i + 0] = mol.x[i];
+        positions[3 * i + 1] = mol.y[i];
+        positions[3 * i + 2] = mol.z[i];
+      }
+      out.write(reinterpret_cast<const char*>(positions.data()),
+                (std::streamsize)(positions.size() * sizeof(float)));
+    } else {
+      float lo[3] = {INFINITY, INFINITY, INFINITY};
+      float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+      for (size_t i = 0; i < mol.size(); i++) {
+        const float p[3] = {mol.x[i], mol.y[i], mol.z[i]};
+        for (int k = 0; k < 3; k++) {
+          lo[k] = std::min(lo[k], p[k]);
+          hi[k] = std::max(hi[k], p[k]);
+        }
+      }
+
+      float box[6];
+      for (int k = 0; k < 3; k++) {
+        box[k] = lo[k];
+        box[3 + k] = hi[k] > lo[k] ? (hi[k] - lo[k]) / 65535.0f : 1.0f;
+      }
+      for (size_t i = 0; i < mol.size(); i++) {
+        const float p[3] = {mol.x[i], mol.y[i], mol.z[i]};
+        for (int k = 0; k < 3; k++) {
+          float q = std::round((p[k] - box[k]) / box[3 + k]);
+          packed[3 * i + k] = (uint16_t)std::clamp(q, 0.0f, 65535.0f);
+        }
+      }
+      out.write(reinterpret_cast<const char*>(box), sizeof(box));
+      out.write(reinterpret_cast<const char*>(packed.data()),
+                (std::streamsize)(packed.size() * sizeof(uint16_t)));
+    }
+    pad(out);
+  }
+
+  header.frameTableOffset = (uint64_t)out.tellp();
+  out.write(reinterpret_cast<const char*>(offsets.data()),
+            (std::streamsize)(offsets.size() * sizeof(uint64_t)));
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!out) {
+    throw std::runtime_error("Failed to write file: " + outPath + "\n");
+  }
+}
+
+bool isBinaryTrajectory(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  char magic[8] = {};
+  in.read(magic, sizeof(magic));
+  return in && std::memcmp(magic, kBinaryTrajectoryMagic, sizeof(magic)) == 0;
+}
+
+BinaryTrajectory::BinaryTrajectory(const std::string& filename)
+  : file(filename) {
+  if (file.size() < sizeof(header)) {
+    throw std::runtime_error("Truncated binary trajectory: " + filename + "\n");
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, kBinaryTrajectoryMagic, sizeof(header.magic)) != 0
+      || header.version != kBinaryTrajectoryVersion) {
+    throw std::runtime_error("Not a binary trajectory: " + filename + "\n");
+  }
+  // Each length is checked against what is left after its offset, so a
+  // crafted header cannot wrap the sums around.
+  const size_t size = file.size();
+  if (header.natoms == 0 || header.nframes == 0
+      || header.atomTableOffset > size || header.natoms > size - header.atomTableOffset
+      || header.frameTableOffset > size || header.frameTableOffset % 8 != 0
+      || header.nframes > (size - header.frameTableOffset) / sizeof(uint64_t)) {
+    throw std::runtime_error("Truncated binary trajectory: " + filename + "\n");
+  }
+
+  atomicNumbers = reinterpret_cast<const uint8_t*>(file.data() + header.atomTableOffset);
+  frameOffsets = reinterpret_cast<const uint64_t*>(file.data() + header.frameTableOffset);
+
+  size_t bytes = frameBytes(header.natoms, quantized());
+  for (size_t f = 0; f < header.nframes; f++) {
+    if (frameOffsets[f] % 8 != 0 || frameOffsets[f] > size || bytes > size - frameOffsets[f]) {
+      throw std::runtime_error(
+        "Frame " + std::to_string(f) + " out of range in binary trajectory: " + filename + "\n"
+      );
+    }
+  }
+
+  style.resize(header.natoms);
+  for (size_t i = 0; i < header.natoms; i++) {
+    if (atomicNumbers[i] > kMaxAtomicNumber) {
+      throw std::runtime_error("Unknown atom: Z=" + std::to_string(atomicNumbers[i]) + "\n");
+    }
+    const ElementStyle& s = kElementStyles[atomicNumbers[i]];
+    style[i] = {0.0f, 0.0f, 0.0f, s.radius, s.r, s.g, s.b};
+  }
+}
+
+const char* BinaryTrajectory::frameData(size_t index) const {
+  return file.data() + frameOffsets[index];
+}
+
+void BinaryTrajectory::readFrame(size_t index, std::vector<Instance>& out) {
+  decode(index, out);
+}
+
+void BinaryTrajectory::decode(size_t index, std::vector<Instance>& out) const {
+  if (out.size() != header.natoms) {
+    out = style;
+  }
+
+  const char* frame = frameData(index);
+  if (!quantized()) {
+    const float* p = reinterpret_cast<const float*>(frame);
+    for (size_t i = 0; i < header.natoms; i++) {
+      out[i].x = p[3 * i + 0];
+      out[i].y = p[3 * i + 1];
+      out[i].z = p[3 * i + 2];
+    }
+  } else {
+    const float* box = reinterpret_cast<const float*>(frame);
+    const uint16_t* q = reinterpret_cast<const uint16_t*>(frame + 6 * sizeof(float));
+    for (size_t i = 0; i < header.natoms; i++) {
+      out[i].x = box[0] + q[3 * i + 0] * box[3];
+      out[i].y = box[1] + q[3 * i + 1] * box[4];
+      out[i].z = box[2] + q[3 * i + 2] * box[5];
+    }
+  }
+}
+
+Molecule BinaryTrajectory::molecule(size_t index) const {
+  std::vector<Instance> frame;
+  decode(index, frame);
+
+  Molecule mol;
+  mol.resize(header.natoms);
+  for (size_t i = 0; i < header.natoms; i++) {
+    mol.atomicNumbers[i] = atomicNumbers[i];
+    mol.x[i] = frame[i].x;
+    mol.y[i] = frame[i].y;
+    mol.z[i] = frame[i].z;
+  }
+  return mol;
+}
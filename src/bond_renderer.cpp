@@ -0,0 +1,183 @@
+#include "bond_renderer.hpp"
+
+#include <cstddef>
+
+#include "gl_util.hpp"
+#include "mesh.hpp"
+#include "render_state.hpp"
+
+static const char* bondVsSrc = R"(#version 330 core
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aNrm;
+
+layout(location=2) in vec3 iA;
+layout(location=3) in vec3 iB;
+layout(location=4) in vec3 iColorA;
+layout(location=5) in vec3 iColorB;
+
+out vec3 vNrmVS;
+out float vT;
+flat out vec3 vColorA;
+flat out vec3 vColorB;
+
+uniform float uRadius;
+
+void main() {
+  vec3 axis = iB - iA;
+  vec3 w = normalize(axis);
+  vec3 helper = abs(w.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+  vec3 u = normalize(cross(helper, w));
+  vec3 v = cross(w, u);
+
+  vec3 worldPos = iA + axis * aPos.y + (u * aPos.x + v * aPos.z) * uRadius;
+
+  vNrmVS = mat3(uView) * (u * aNrm.x + v * aNrm.z);
+  vT = aPos.y;
+  vColorA = iColorA;
+  vColorB = iColorB;
+
+  gl_Position = uProj * uView * vec4(worldPos, 1.0);
+}
+)";
+
+static const char* bondFsSrc = R"(#version 330 core
+in vec3 vNrmVS;
+in float vT;
+flat in vec3 vColorA;
+flat in vec3 vColorB;
+out vec4 FragColor;
+
+void main() {
+  vec3 base = vT < 0.5 ? vColorA : vColorB;
+  FragColor = vec4(shade(base, normalize(vNrmVS)), 1.0);
+}
+)";
+
+static const char* hbondVsSrc = R"(#version 330 core
+layout(location=0) in vec3 iA;
+layout(location=1) in vec3 iB;
+
+out float vDist;
+
+void main() {
+  vec3 p = gl_VertexID == 0 ? iA : iB;
+  vDist = float(gl_VertexID) * length(iB - iA);
+  gl_Position = uProj * uView * vec4(p, 1.0);
+}
+)";
+
+static const char* hbondFsSrc = R"(#version 330 core
+in float vDist;
+out vec4 FragColor;
+
+uniform float uDash;
+
+void main() {
+  if (fract(vDist / uDash) > 0.5) discard;
+  FragColor = vec4(0.4, 0.8, 1.0, 1.0);
+}
+)";
+
+// Uploads `bytes` to `vbo`, growing it by half again when it is too small.
+static void upload(GLuint vbo, const void* data, size_t count, size_t stride, size_t& capacity) {
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  if (count > capacity) {
+    capacity = count * 3 / 2;
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(capacity * stride), nullptr, GL_STREAM_DRAW);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * stride), data);
+}
+
+BondRenderer::BondRenderer() {
+  // ---------- Bonds: one instanced cylinder per bond ----------
+  bondProgram = createProgram(withCameraBlock(bondVsSrc).c_str(), withCameraBlock(bondFsSrc).c_str());
+  radiusLoc = glGetUniformLocation(bondProgram, "uRadius");
+
+  Mesh cylinder = createCylinder(16);
+  cylinderIndices = (GLsizei)cylinder.indices.size();
+
+  glGenVertexArrays(1, &bondVAO);
+  glGenBuffers(1, &bondVBO);
+  glGenBuffers(1, &bondEBO);
+  glGenBuffers(1, &bondInstanceVBO);
+
+  glBindVertexArray(bondVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, bondVBO);
+  glBufferData(GL_ARRAY_BUFFER, cylinder.vertices.size() * sizeof(float), cylinder.vertices.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bondEBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinder.indices.size() * sizeof(unsigned int),
+               cylinder.indices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, bondInstanceVBO);
+  const size_t bondOffsets[4] = {
+    offsetof(BondInstance, ax), offsetof(BondInstance, bx),
+    offsetof(BondInstance, ar), offsetof(BondInstance, br)
+  };
+  for (GLuint k = 0; k < 4; k++) {
+    glVertexAttribPointer(2 + k, 3, GL_FLOAT, GL_FALSE, sizeof(BondInstance),
+                          (void*)bondOffsets[k]);
+    glEnableVertexAttribArray(2 + k);
+    glVertexAttribDivisor(2 + k, 1);
+  }
+  glBindVertexArray(0);
+
+  // ---------- Hydrogen bonds: one instanced dashed line per bond ----------
+  hbondProgram = createProgram(withCameraBlock(hbondVsSrc).c_str(), hbondFsSrc);
+  glUseProgram(hbondProgram);
+  glUniform1f(glGetUniformLocation(hbondProgram, "uDash"), 0.25f);
+  glUseProgram(0);
+
+  glGenVertexArrays(1, &hbondVAO);
+  glGenBuffers(1, &hbondInstanceVBO);
+  glBindVertexArray(hbondVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, hbondInstanceVBO);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(HBondSegment),
+                        (void*)offsetof(HBondSegment, ax));
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(HBondSegment),
+                        (void*)offsetof(HBondSegment, bx));
+  for (GLuint k = 0; k < 2; k++) {
+    glEnableVertexAttribArray(k);
+    glVertexAttribDivisor(k, 1);
+  }
+  glBindVertexArray(0);
+}
+
+void BondRenderer::uploadBonds(std::span<const BondInstance> bonds) {
+  upload(bondInstanceVBO, bonds.data(), bonds.size(), sizeof(BondInstance), bondCapacity);
+  bondCount = bonds.size();
+}
+
+void BondRenderer::uploadHBonds(std::span<const HBondSegment> segments) {
+  upload(hbondInstanceVBO, segments.data(), segments.size(), sizeof(HBondSegment), hbondCapacity);
+  hbondCount = segments.size();
+}
+
+void BondRenderer::drawBonds() const {
+  glUseProgram(bondProgram);
+  glUniform1f(radiusLoc, radius);
+  glBindVertexArray(bondVAO);
+  glDrawElementsInstanced(GL_TRIANGLES, cylinderIndices, GL_UNSIGNED_INT, 0, (GLsizei)bondCount);
+}
+
+void BondRenderer::drawHBonds() const {
+  glUseProgram(hbondProgram);
+  glBindVertexArray(hbondVAO);
+  glDrawArraysInstanced(GL_LINES, 0, 2, (GLsizei)hbondCount);
+}
+
+void BondRenderer::release() {
+  if (bondVAO != 0) {
+    GLuint arrays[2] = {bondVAO, hbondVAO};
+    glDeleteVertexArrays(2, arrays);
+    GLuint buffers[4] = {bondVBO, bondEBO, bondInstanceVBO, hbondInstanceVBO};
+    glDeleteBuffers(4, buffers);
+    glDeleteProgram(bondProgram);
+    glDeleteProgram(hbondProgram);
+    bondVAO = 0;
+  }
+}
@@ -0,0 +1,293 @@
+#include "bonds.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "elements.hpp"
+
+static float imageShift(float d, float length) {
+  return length > 0.0f ? length * std::round(d / length) : 0.0f;
+}
+
+static bool samePosition(float a, float b) {
+  return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b);
+}
+
+void BondPerception::setBox(float lx, float ly, float lz) {
+  box[0] = lx;
+  box[1] = ly;
+  box[2] = lz;
+  periodic = lx > 0.0f && ly > 0.0f && lz > 0.0f;
+  stale = true;
+}
+
+void BondPerception::reset() {
+  stale = true;
+}
+
+uint32_t BondPerception::cellOf(float x, float y, float z) const {
+  const float p[3] = {x, y, z};
+  int c[3];
+  for (int k = 0; k < 3; k++) {
+    float v = p[k];
+    if (periodic) {
+      v -= box[k] * std::floor(v / box[k]);
+    } else {
+      v -= origin[k];
+    }
+    // clamping keeps adjacent atoms in adjacent cells, so stray atoms outside
+    // the grid only cost extra distance tests
+    c[k] = std::clamp((int)(v / extent[k] * (float)dims[k]), 0, dims[k] - 1);
+  }
+  return (uint32_t)((c[2] * dims[1] + c[1]) * dims[0] + c[0]);
+}
+
+int BondPerception::neighborCells(uint32_t cell, uint32_t out[27]) const {
+  int cx = (int)(cell % (uint32_t)dims[0]);
+  int cy = (int)(cell / (uint32_t)dims[0] % (uint32_t)dims[1]);
+  int cz = (int)(cell / (uint32_t)(dims[0] * dims[1]));
+
+  int range[3][2];
+  const int c[3] = {cx, cy, cz};
+  for (int k = 0; k < 3; k++) {
+    if (periodic && dims[k] >= 3) {
+      range[k][0] = c[k] - 1;
+      range[k][1] = c[k] + 1;
+    } else if (periodic) {
+      // small periodic grids would wrap onto the same cell twice
+      range[k][0] = 0;
+      range[k][1] = dims[k] - 1;
+    } else {
+      range[k][0] = std::max(c[k] - 1, 0);
+      range[k][1] = std::min(c[k] + 1, dims[k] - 1);
+    }
+  }
+
+  int n = 0;
+  for (int z = range[2][0]; z <= range[2][1]; z++) {
+    int wz = z < 0 ? z + dims[2] : (z >= dims[2] ? z - dims[2] : z);
+    for (int y = range[1][0]; y <= range[1][1]; y++) {
+      int wy = y < 0 ? y + dims[1] : (y >= dims[1] ? y - dims[1] : y);
+      int row = (wz * dims[1] + wy) * dims[0];
+      for (int x = range[0][0]; x <= range[0][1]; x++) {
+        int wx = x < 0 ? x + dims[0] : (x >= dims[0] ? x - dims[0] : x);
+        out[n++] = (uint32_t)(row + wx);
+      }
+    }
+  }
+  return n;
+}
+
+void BondPerception::rebuildGrid(const Molecule& mol) {
+  size_t n = mol.size();
+
+  radius.resize(n);
+  float maxRadius = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    radius[i] = (float)kElements[mol.atomicNumbers[i]].covalentRadius / 100.0f;
+    maxRadius = std::max(maxRadius, radius[i]);
+  }
+  cellSize = 2.0f * maxRadius + tolerance;
+
+  float lo[3] = {0.0f, 0.0f, 0.0f};
+  float hi[3] = {box[0], box[1], box[2]};
+  if (!periodic) {
+    std::span<const float> p[3] = {mol.xs(), mol.ys(), mol.zs()};
+    for (int k = 0; k < 3; k++) {
+      auto [mn, mx] = std::minmax_element(p[k].begin(), p[k].end());
+      // margin so atoms drifting over later frames stay inside the grid
+      lo[k] = (n > 0 ? *mn : 0.0f) - 2.0f * cellSize;
+      hi[k] = (n > 0 ? *mx : 0.0f) + 2.0f * cellSize;
+    }
+  }
+
+  // keep sparse systems from allocating far more cells than atoms
+  size_t maxCells = std::max<size_t>(64, 2 * n);
+  while (true) {
+    size_t cells = 1;
+    for (int k = 0; k < 3; k++) {
+      origin[k] = lo[k];
+      extent[k] = std::max(hi[k] - lo[k], cellSize);
+      dims[k] = std::max(1, (int)(extent[k] / cellSize));
+      cells *= (size_t)dims[k];
+    }
+    if (cells <= maxCells) {
+      break;
+    }
+    cellSize *= 1.25f;
+  }
+
+  size_t cells = (size_t)dims[0] * (size_t)dims[1] * (size_t)dims[2];
+  bondStart.assign(cells + 1, 0);
+  all.clear();
+  dirty.assign(cells, 1);
+  recompute.assign(cells, 0);
+  atomCell.assign(n, 0);
+  px.assign(mol.x.begin(), mol.x.end());
+  py.assign(mol.y.begin(), mol.y.end());
+  pz.assign(mol.z.begin(), mol.z.end());
+  for (size_t i = 0; i < n; i++) {
+    atomCell[i] = cellOf(px[i], py[i], pz[i]);
+  }
+  stale = false;
+}
+
+void BondPerception::perceiveCell(uint32_t cell, std::vector<Bond>& out) {
+  if (cellStart[cell] == cellStart[cell + 1]) {
+    return;
+  }
+
+  // Cells are numbered x-fastest, so neighbors with consecutive ids share one
+  // contiguous run of sorted atoms: 9 runs instead of 27 short loops.
+  uint32_t neighbors[27];
+  int count = neighborCells(cell, neighbors);
+  std::sort(neighbors, neighbors + count);
+  uint32_t runs[27][2];
+  int nruns = 0;
+  for (int k = 0; k < count; k++) {
+    if (nruns > 0 && runs[nruns - 1][1] == cellStart[neighbors[k]]
+        && neighbors[k] == neighbors[k - 1] + 1) {
+      runs[nruns - 1][1] = cellStart[neighbors[k] + 1];
+    } else {
+      runs[nruns][0] = cellStart[neighbors[k]];
+      runs[nruns][1] = cellStart[neighbors[k] + 1];
+      nruns++;
+    }
+  }
+
+  // sorted positions are wrapped into the box, so the minimum image is at
+  // most one box length away and needs no rounding
+  float half[3], length[3];
+  for (int k = 0; k < 3; k++) {
+    length[k] = periodic ? box[k] : 0.0f;
+    half[k] = periodic ? 0.5f * box[k] : INFINITY;
+  }
+
+  for (uint32_t s = cellStart[cell]; s < cellStart[cell + 1]; s++) {
+    uint32_t i = cellAtoms[s];
+    float xi = sx[s], yi = sy[s], zi = sz[s], ri = sr[s] + tolerance;
+    for (int k = 0; k < nruns; k++) {
+      for (uint32_t t = runs[k][0]; t < runs[k][1]; t++) {
+        float dx = sx[t] - xi;
+        float dy = sy[t] - yi;
+        float dz = sz[t] - zi;
+        dx -= dx > half[0] ? length[0] : (dx < -half[0] ? -length[0] : 0.0f);
+        dy -= dy > half[1] ? length[1] : (dy < -half[1] ? -length[1] : 0.0f);
+        dz -= dz > half[2] ? length[2] : (dz < -half[2] ? -length[2] : 0.0f);
+        float d2 = dx * dx + dy * dy + dz * dz;
+        float cutoff = ri + sr[t];
+        // each pair is owned by the cell of its lower index
+        uint32_t j = cellAtoms[t];
+        if (d2 < cutoff * cutoff && d2 > 0.01f && j > i) {
+          out.push_back({i, j});
+        }
+      }
+    }
+  }
+}
+
+const std::vector<Bond>& BondPerception::update(const Molecule& mol) {
+  size_t n = mol.size();
+  if (stale || n != px.size()) {
+    rebuildGrid(mol);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      if (!samePosition(mol.x[i], px[i]) || !samePosition(mol.y[i], py[i]) || !samePosition(mol.z[i], pz[i])) {
+        uint32_t c = cellOf(mol.x[i], mol.y[i], mol.z[i]);
+        dirty[atomCell[i]] = 1;
+        dirty[c] = 1;
+        atomCell[i] = c;
+        px[i] = mol.x[i];
+        py[i] = mol.y[i];
+        pz[i] = mol.z[i];
+      }
+    }
+  }
+
+  // CSR cell -> atoms, by counting sort
+  size_t cells = bondStart.size() - 1;
+  cellStart.assign(cells + 1, 0);
+  for (uint32_t c : atomCell) {
+    cellStart[c + 1]++;
+  }
+  for (size_t c = 0; c < cells; c++) {
+    cellStart[c + 1] += cellStart[c];
+  }
+  // positions are gathered in cell order so neighbor scans read contiguously
+  cellAtoms.resize(n);
+  sx.resize(n);
+  sy.resize(n);
+  sz.resize(n);
+  sr.resize(n);
+  std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+  for (uint32_t i = 0; i < (uint32_t)n; i++) {
+    uint32_t slot = fill[atomCell[i]]++;
+    cellAtoms[slot] = i;
+    sx[slot] = periodic ? px[i] - box[0] * std::floor(px[i] / box[0]) : px[i];
+    sy[slot] = periodic ? py[i] - box[1] * std::floor(py[i] / box[1]) : py[i];
+    sz[slot] = periodic ? pz[i] - box[2] * std::floor(pz[i] / box[2]) : pz[i];
+    sr[slot] = radius[i];
+  }
+
+  // a cell's bonds depend on its own atoms and those of its neighbors
+  uint32_t neighbors[27];
+  for (uint32_t c = 0; c < (uint32_t)cells; c++) {
+    if (dirty[c]) {
+      int count = neighborCells(c, neighbors);
+      for (int k = 0; k < count; k++) {
+        recompute[neighbors[k]] = 1;
+      }
+    }
+  }
+
+  // clean cells copy their previous bonds over, dirty ones are re-perceived
+  recomputed = 0;
+  next.clear();
+  next.reserve(all.size());
+  uint32_t start = 0;
+  for (uint32_t c = 0; c < (uint32_t)cells; c++) {
+    if (recompute[c]) {
+      perceiveCell(c, next);
+      recompute[c] = 0;
+      recomputed++;
+    } else {
+      next.insert(next.end(), all.begin() + bondStart[c], all.begin() + bondStart[c + 1]);
+    }
+    dirty[c] = 0;
+    bondStart[c] = start;
+    start = (uint32_t)next.size();
+  }
+  bondStart[cells] = start;
+
+  all.swap(next);
+  return all;
+}
+
+void buildBondInstances(const Molecule& mol, std::span<const Bond> bonds,
+                        const float box[3], std::vector<BondInstance>& out) {
+  out.clear();
+  out.reserve(bonds.size());
+
+  for (const Bond& bond : bonds) {
+    const ElementStyle& sa = kElementStyles[mol.atomicNumbers[bond.a]];
+    const ElementStyle& sb = kElementStyles[mol.atomicNumbers[bond.b]];
+    float ax = mol.x[bond.a], ay = mol.y[bond.a], az = mol.z[bond.a];
+    float bx = mol.x[bond.b], by = mol.y[bond.b], bz = mol.z[bond.b];
+
+    float sx = imageShift(bx - ax, box[0]);
+    float sy = imageShift(by - ay, box[1]);
+    float sz = imageShift(bz - az, box[2]);
+    bool wrapped = std::abs(sx) + std::abs(sy) + std::abs(sz) > 0.0f;
+    float dx = bx - ax - sx;
+    float dy = by - ay - sy;
+    float dz = bz - az - sz;
+
+    if (!wrapped) {
+      out.push_back({ax, ay, az, bx, by, bz, sa.r, sa.g, sa.b, sb.r, sb.g, sb.b});
+    } else {
+      out.push_back({ax, ay, az, ax + dx, ay + dy, az + dz, sa.r, sa.g, sa.b, sb.r, sb.g, sb.b});
+      out.push_back({bx, by, bz, bx - dx, by - dy, bz - dz, sb.r, sb.g, sb.b, sa.r, sa.g, sa.b});
+    }
+  }
+}
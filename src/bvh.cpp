@@ -0,0 +1,211 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static constexpr uint32_t kLeafSize = 4;
+
+void SphereBvh::build(std::span<const Instance> atoms) {
+  nodes.clear();
+  order.resize(atoms.size());
+  for (size_t i = 0; i < atoms.size(); i++) {
+    order[i] = (uint32_t)i;
+  }
+  if (atoms.empty()) {
+    spheres.clear();
+    return;
+  }
+  nodes.reserve(2 * atoms.size() / kLeafSize + 1);
+
+  struct Task {
+    uint32_t node, begin, end;
+  };
+  std::vector<Task> stack;
+  nodes.push_back({});
+  stack.push_back({0, 0, (uint32_t)atoms.size()});
+  while (!stack.empty()) {
+    Task task = stack.back();
+    stack.pop_back();
+    uint32_t count = task.end - task.begin;
+    if (count <= kLeafSize) {
+      nodes[task.node].first = task.begin;
+      nodes[task.node].count = count;
+      continue;
+    }
+
+    // split at the median centre along the widest axis
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (uint32_t k = task.begin; k < task.end; k++) {
+      const Instance& a = atoms[order[k]];
+      lo = glm::min(lo, glm::vec3(a.x, a.y, a.z));
+      hi = glm::max(hi, glm::vec3(a.x, a.y, a.z));
+    }
+    glm::vec3 size = hi - lo;
+    int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+    uint32_t mid = task.begin + count / 2;
+    std::nth_element(order.begin() + task.begin, order.begin() + mid, order.begin() + task.end,
+                     [&](uint32_t a, uint32_t b) {
+                       const float* pa = &atoms[a].x;
+                       const float* pb = &atoms[b].x;
+                       return pa[axis] < pb[axis];
+                     });
+
+    uint32_t left = (uint32_t)nodes.size();
+    nodes[task.node].first = left;
+    nodes[task.node].count = 0;
+    nodes.push_back({});
+    nodes.push_back({});
+    stack.push_back({left, task.begin, mid});
+    stack.push_back({left + 1, mid, task.end});
+  }
+
+  spheres.resize(atoms.size());
+  refit(atoms);
+}
+
+void SphereBvh::refit(std::span<const Instance> atoms) {
+  if (atoms.size() != order.size()) {
+    build(atoms);
+    return;
+  }
+  for (size_t k = 0; k < order.size(); k++) {
+    const Instance& a = atoms[order[k]];
+    spheres[k] = glm::vec4(a.x, a.y, a.z, a.radius);
+  }
+  refitNodes();
+}
+
+void SphereBvh::refitNodes() {
+  // children are stored after their parent, so a reverse sweep is bottom-up
+  for (size_t i = nodes.size(); i-- > 0;) {
+    Node& n = nodes[i];
+    if (n.count > 0) {
+      glm::vec3 lo(std::numeric_limits<float>::max());
+      glm::vec3 hi(-std::numeric_limits<float>::max());
+      for (uint32_t k = n.first; k < n.first + n.count; k++) {
+        glm::vec3 c(spheres[k]);
+        lo = glm::min(lo, c - spheres[k].w);
+        hi = glm::max(hi, c + spheres[k].w);
+      }
+      for (int a = 0; a < 3; a++) {
+        n.lo[a] = lo[a];
+        n.hi[a] = hi[a];
+      }
+    } else {
+      const Node& l = nodes[n.first];
+      const Node& r = nodes[n.first + 1];
+      for (int a = 0; a < 3; a++) {
+        n.lo[a] = std::min(l.lo[a], r.lo[a]);
+        n.hi[a] = std::max(l.hi[a], r.hi[a]);
+      }
+    }
+  }
+}
+
+// Ray parameter where the ray enters the box, or infinity if it misses or the
+// box lies beyond `limit`.
+static float slabEntry(const float lo[3], const float hi[3], const glm::vec3& origin,
+                       const glm::vec3& invDir, float limit) {
+  float tmin = 0.0f, tmax = limit;
+  for (int a = 0; a < 3; a++) {
+    float t0 = (lo[a] - origin[a]) * invDir[a];
+    float t1 = (hi[a] - origin[a]) * invDir[a];
+    tmin = std::max(tmin, std::min(t0, t1));
+    tmax = std::min(tmax, std::max(t0, t1));
+  }
+  return tmin <= tmax ? tmin : std::numeric_limits<float>::infinity();
+}
+
+uint32_t SphereBvh::pick(const glm::vec3& origin, const glm::vec3& dir, float* distance) const {
+  uint32_t hit = kNone;
+  float best = std::numeric_limits<float>::max();
+  if (nodes.empty()) {
+    return hit;
+  }
+  const glm::vec3 invDir = 1.0f / dir;
+  const float a = glm::dot(dir, dir);
+
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& n = nodes[stack[--top]];
+    if (slabEntry(n.lo, n.hi, origin, invDir, best) > best) {
+      continue;
+    }
+    if (n.count > 0) {
+      for (uint32_t k = n.first; k < n.first + n.count; k++) {
+        glm::vec3 oc = origin - glm::vec3(spheres[k]);
+        float b = glm::dot(oc, dir);
+        float c = glm::dot(oc, oc) - spheres[k].w * spheres[k].w;
+        float disc = b * b - a * c;
+        if (disc < 0.0f) {
+          continue;
+        }
+        float root = std::sqrt(disc);
+        float t = (-b - root) / a;
+        if (t < 0.0f) {
+          // origin inside the sphere
+          t = (-b + root) / a;
+        }
+        if (t >= 0.0f && t < best) {
+          best = t;
+          hit = order[k];
+        }
+      }
+      continue;
+    }
+    // visit the nearer child first so `best` shrinks early
+    uint32_t nearChild = n.first, farChild = n.first + 1;
+    float tNear = slabEntry(nodes[nearChild].lo, nodes[nearChild].hi, origin, invDir, best);
+    float tFar = slabEntry(nodes[farChild].lo, nodes[farChild].hi, origin, invDir, best);
+    if (tFar < tNear) {
+      std::swap(nearChild, farChild);
+      std::swap(tNear, tFar);
+    }
+    if (tFar <= best) {
+      stack[top++] = farChild;
+    }
+    if (tNear <= best) {
+      stack[top++] = nearChild;
+    }
+  }
+  if (distance != nullptr && hit != kNone) {
+    *distance = best;
+  }
+  return hit;
+}
+
+void SphereBvh::gather(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+  if (nodes.empty()) {
+    return;
+  }
+  const float r2 = radius * radius;
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& n = nodes[stack[--top]];
+    float d2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+      float d = std::max({n.lo[a] - center[a], 0.0f, center[a] - n.hi[a]});
+      d2 += d * d;
+    }
+    if (d2 > r2) {
+      continue;
+    }
+    if (n.count > 0) {
+      for (uint32_t k = n.first; k < n.first + n.count; k++) {
+        glm::vec3 d = glm::vec3(spheres[k]) - center;
+        if (glm::dot(d, d) <= r2) {
+          out.push_back(order[k]);
+        }
+      }
+    } else {
+      stack[top++] = n.first;
+      stack[top++] = n.first + 1;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#include "culling.hpp"
+
+#include <cmath>
+
+Frustum frustumFromMatrix(const glm::mat4& m) {
+  // Gribb-Hartmann: each plane is row 3 plus or minus row 0, 1 or 2.
+  Frustum f;
+  for (int p = 0; p < 6; p++) {
+    int row = p / 2;
+    float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+    float a = m[0][3] + sign * m[0][row];
+    float b = m[1][3] + sign * m[1][row];
+    float c = m[2][3] + sign * m[2][row];
+    float d = m[3][3] + sign * m[3][row];
+    float len = std::sqrt(a * a + b * b + c * c);
+    f.a[p] = a / len;
+    f.b[p] = b / len;
+    f.c[p] = c / len;
+    f.d[p] = d / len;
+  }
+  return f;
+}
+
+size_t cullSpheres(std::span<const Instance> in, const Frustum& f,
+                   std::vector<Instance>& out) {
+  out.resize(in.size());
+
+  size_t kept = 0;
+  for (size_t i = 0; i < in.size(); i++) {
+    const Instance& s = in[i];
+    bool inside = true;
+    for (int p = 0; p < 6; p++) {
+      float dist = f.a[p] * s.x + f.b[p] * s.y + f.c[p] * s.z + f.d[p];
+      inside &= dist > -s.radius;
+    }
+    // Always write, advance only when visible: no unpredictable branch.
+    out[kept] = s;
+    kept += inside ? 1 : 0;
+  }
+  out.resize(kept);
+  return kept;
+}
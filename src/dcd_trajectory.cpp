@@ -0,0 +1,167 @@
+#include "dcd_trajectory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static uint32_t swapBytes(uint32_t v) {
+  return (v >> 24) | ((v >> 8) & 0xff00u) | ((v << 8) & 0xff0000u) | (v << 24);
+}
+
+static uint32_t loadU32(const char* p, bool swapped) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return swapped ? swapBytes(v) : v;
+}
+
+static double loadF64(const char* p, bool swapped) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  if (swapped) {
+    v = (uint64_t)swapBytes((uint32_t)v) << 32 | swapBytes((uint32_t)(v >> 32));
+  }
+  return std::bit_cast<double>(v);
+}
+
+// The first record is 84 bytes: "CORD" and 20 control words.
+static constexpr uint32_t kHeaderRecord = 84;
+
+bool isDcdFile(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  char head[8] = {};
+  in.read(head, sizeof(head));
+  if (!in || std::memcmp(head + 4, "CORD", 4) != 0) {
+    return false;
+  }
+  uint32_t marker = loadU32(head, false);
+  return marker == kHeaderRecord || swapBytes(marker) == kHeaderRecord;
+}
+
+DcdTrajectory::DcdTrajectory(const std::string& filename, const Molecule& topology)
+  : file(filename) {
+  const char* data = file.data();
+  const size_t size = file.size();
+  auto truncated = [&] { return std::runtime_error("Truncated DCD file: " + filename + "\n"); };
+
+  if (size < 8 + kHeaderRecord || std::memcmp(data + 4, "CORD", 4) != 0) {
+    throw std::runtime_error("Not a DCD file: " + filename + "\n");
+  }
+  swapped = loadU32(data, false) != kHeaderRecord;
+  if (loadU32(data, swapped) != kHeaderRecord) {
+    throw std::runtime_error("Not a DCD file: " + filename + "\n");
+  }
+
+  // control words after "CORD": [8] fixed atoms, [10] unit cell present,
+  // [11] 4D coordinates, [19] CHARMM version (0 for X-PLOR files, which
+  // have neither extension)
+  auto control = [&](int k) { return loadU32(data + 8 + 4 * k, swapped); };
+  const bool charmm = control(19) != 0;
+  if (control(8) != 0) {
+    throw std::runtime_error("DCD files with fixed atoms are not supported: " + filename + "\n");
+  }
+  const bool hasCell = charmm && control(10) != 0;
+  const bool has4D = charmm && control(11) != 0;
+
+  // title record, then the atom count record
+  size_t pos = 4 + kHeaderRecord + 4;
+  if (pos + 4 > size) {
+    throw truncated();
+  }
+  size_t titleBytes = loadU32(data + pos, swapped);
+  pos += 4 + titleBytes + 4;
+  if (pos + 12 > size || loadU32(data + pos, swapped) != 4) {
+    throw truncated();
+  }
+  natoms = loadU32(data + pos + 4, swapped);
+  firstFrame = pos + 12;
+
+  if (natoms != topology.size()) {
+    throw std::runtime_error("Topology has " + std::to_string(topology.size()) +
+                             " atoms but " + filename + " has " + std::to_string(natoms) + "\n");
+  }
+
+  const size_t axisBytes = 4 * natoms + 8;
+  if (hasCell) {
+    if (firstFrame + 4 > size) {
+      throw truncated();
+    }
+    cellBytes = loadU32(data + firstFrame, swapped) + 8;
+  }
+  frameStride = cellBytes + (has4D ? 4 : 3) * axisBytes;
+  nframes = (size - firstFrame) / frameStride;
+  if (natoms == 0 || nframes == 0) {
+    throw truncated();
+  }
+  // trailing bytes of an interrupted write are ignored
+  const char* frame = data + firstFrame + cellBytes;
+  for (int k = 0; k < 3; k++) {
+    if (loadU32(frame + k * axisBytes, swapped) != 4 * natoms) {
+      throw std::runtime_error("Corrupt DCD frame in " + filename + "\n");
+    }
+  }
+
+  style.resize(natoms);
+  toDraw(topology, style);
+}
+
+bool DcdTrajectory::unitCell(float cell[9]) const {
+  if (cellBytes != 6 * sizeof(double) + 8) {
+    return false;
+  }
+  // A, gamma, B, beta, alpha, C. Older writers store the angles in degrees,
+  // CHARMM since c32 and NAMD their cosines.
+  const char* record = file.data() + firstFrame + 4;
+  double v[6];
+  for (int k = 0; k < 6; k++) {
+    v[k] = loadF64(record + 8 * k, swapped);
+  }
+  auto cosine = [](double angle) {
+    return std::fabs(angle) <= 1.0 ? angle : std::cos(angle * 3.14159265358979323846 / 180.0);
+  };
+  const double a = v[0], b = v[2], c = v[5];
+  const double cosGamma = cosine(v[1]), cosBeta = cosine(v[3]), cosAlpha = cosine(v[4]);
+  const double sinGamma = std::sqrt(1.0 - cosGamma * cosGamma);
+  if (a <= 0.0 || b <= 0.0 || c <= 0.0 || sinGamma <= 0.0) {
+    return false;
+  }
+  // a along x, b in the xy plane
+  const double cy = (cosAlpha - cosBeta * cosGamma) / sinGamma;
+  const double cz = std::sqrt(std::max(0.0, 1.0 - cosBeta * cosBeta - cy * cy));
+  const double vectors[9] = {a,           0.0,         0.0,    b * cosGamma, b * sinGamma,
+                             0.0,         c * cosBeta, c * cy, c * cz};
+  for (int k = 0; k < 9; k++) {
+    cell[k] = (float)vectors[k];
+  }
+  return true;
+}
+
+void DcdTrajectory::readFrame(size_t index, std::vector<Instance>& out) {
+  if (index >= nframes) {
+    throw std::out_of_range("DCD frame " + std::to_string(index) + " out of range\n");
+  }
+  if (out.size() != natoms) {
+    out = style;
+  }
+  const size_t axisBytes = 4 * natoms + 8;
+  const char* frame = file.data() + firstFrame + index * frameStride + cellBytes;
+  const char* xs = frame + 4;
+  const char* ys = xs + axisBytes;
+  const char* zs = ys + axisBytes;
+  if (!swapped) {
+    for (size_t i = 0; i < natoms; i++) {
+      std::memcpy(&out[i].x, xs + 4 * i, sizeof(float));
+      std::memcpy(&out[i].y, ys + 4 * i, sizeof(float));
+      std::memcpy(&out[i].z, zs + 4 * i, sizeof(float));
+    }
+  } else {
+    for (size_t i = 0; i < natoms; i++) {
+      out[i].x = std::bit_cast<float>(loadU32(xs + 4 * i, true));
+      out[i].y = std::bit_cast<float>(loadU32(ys + 4 * i, true));
+      out[i].z = std::bit_cast<float>(loadU32(zs + 4 * i, true));
+    }
+  }
+}
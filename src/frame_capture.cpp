@@ -0,0 +1,242 @@
+#include "frame_capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "image_io.hpp"
+
+// ---------- OffscreenTarget ----------
+
+OffscreenTarget::OffscreenTarget(int width, int height, bool sampled)
+    : w(width), h(height), sampled(sampled) {
+  if (sampled) {
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  } else {
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+  }
+
+  glGenRenderbuffers(1, &depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  if (sampled) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+  } else {
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+  }
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error("Offscreen framebuffer incomplete: " + std::to_string(status) + "\n");
+  }
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  glDeleteFramebuffers(1, &fbo);
+  if (sampled) {
+    glDeleteTextures(1, &color);
+  } else {
+    glDeleteRenderbuffers(1, &color);
+  }
+  glDeleteRenderbuffers(1, &depth);
+}
+
+void OffscreenTarget::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glViewport(0, 0, w, h);
+}
+
+// ---------- FrameCapture ----------
+
+FrameCapture::FrameCapture(unsigned threads) {
+  if (threads == 0) {
+    unsigned hw = std::thread::hardware_concurrency();
+    threads = hw > 1 ? hw - 1 : 1;
+  }
+  // Bounds the pixels held in memory when encoding is slower than rendering.
+  maxQueued = threads * 2;
+
+  for (Slot& slot : slots) {
+    glGenBuffers(1, &slot.pbo);
+  }
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back(&FrameCapture::work, this);
+  }
+}
+
+FrameCapture::~FrameCapture() {
+  release();
+}
+
+void FrameCapture::release() {
+  if (workers.empty()) {
+    return;
+  }
+  finish();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobReady.notify_all();
+  for (std::thread& t : workers) {
+    t.join();
+  }
+  workers.clear();
+  for (Slot& slot : slots) {
+    glDeleteBuffers(1, &slot.pbo);
+    slot.pbo = 0;
+  }
+}
+
+void FrameCapture::capture(int width, int height, const std::string& path) {
+  if (inFlight == kSlots) {
+    collect(slots[oldestSlot], true);
+  }
+
+  Slot& slot = slots[nextSlot];
+  size_t bytes = size_t(width) * height * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  if (bytes > slot.capacity) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    slot.capacity = bytes;
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.width = width;
+  slot.height = height;
+  slot.path = path;
+
+  nextSlot = (nextSlot + 1) % kSlots;
+  inFlight++;
+}
+
+void FrameCapture::poll() {
+  while (inFlight > 0) {
+    Slot& slot = slots[oldestSlot];
+    GLenum r = glClientWaitSync(slot.fence, 0, 0);
+    if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) {
+      return;
+    }
+    collect(slot, false);
+  }
+}
+
+void FrameCapture::collect(Slot& slot, bool wait) {
+  if (wait) {
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+      GLenum r = glClientWaitSync(slot.fence, flags, 1000000);
+      if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED || r == GL_WAIT_FAILED) {
+        break;
+      }
+      flags = 0;
+    }
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  Job job;
+  job.width = slot.width;
+  job.height = slot.height;
+  job.path = std::move(slot.path);
+  job.pixels.resize(size_t(slot.width) * slot.height * 4);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  const void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+  if (src != nullptr) {
+    std::memcpy(job.pixels.data(), src, job.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  oldestSlot = (oldestSlot + 1) % kSlots;
+  inFlight--;
+
+  if (src == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (firstError.empty()) {
+      firstError = "Failed to map pixel buffer for " + job.path + "\n";
+    }
+    return;
+  }
+  submit(std::move(job));
+}
+
+void FrameCapture::submit(Job job) {
+  std::unique_lock<std::mutex> lock(mutex);
+  jobDone.wait(lock, [&] { return jobs.size() < maxQueued; });
+  jobs.push_back(std::move(job));
+  lock.unlock();
+  jobReady.notify_one();
+}
+
+void FrameCapture::finish() {
+  while (inFlight > 0) {
+    collect(slots[oldestSlot], true);
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  jobDone.wait(lock, [&] { return jobs.empty() && busy == 0; });
+}
+
+size_t FrameCapture::written() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return done;
+}
+
+std::string FrameCapture::error() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return firstError;
+}
+
+void FrameCapture::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+    if (jobs.empty()) {
+      return;
+    }
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    busy++;
+    lock.unlock();
+    jobDone.notify_all();
+
+    std::string failure;
+    try {
+      bool ppm = job.path.size() >= 4 && job.path.compare(job.path.size() - 4, 4, ".ppm") == 0;
+      if (ppm) {
+        writePpm(job.path, job.pixels.data(), job.width, job.height);
+      } else {
+        writePng(job.path, job.pixels.data(), job.width, job.height);
+      }
+    } catch (const std::exception& e) {
+      failure = e.what();
+    }
+
+    lock.lock();
+    busy--;
+    if (failure.empty()) {
+      done++;
+    } else if (firstError.empty()) {
+      firstError = failure;
+    }
+    jobDone.notify_all();
+  }
+}
@@ -0,0 +1,183 @@
+#include "frame_pipeline.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+static bool sameBits(float a, float b) {
+  return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b);
+}
+
+FramePipeline::FramePipeline(std::unique_ptr<FrameSource> source, const Molecule& topology)
+  : streamer(std::move(source)), topology(topology) {
+  worker = std::thread(&FramePipeline::run, this);
+}
+
+FramePipeline::~FramePipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+void FramePipeline::request(size_t frame) {
+  std::lock_guard<std::mutex> lock(mutex);
+  frame %= streamer.frameCount();
+  if (frame != requested) {
+    requested = frame;
+    wake.notify_one();
+  }
+}
+
+void FramePipeline::configure(const FrameAnalysis& analysis) {
+  std::lock_guard<std::mutex> lock(mutex);
+  settings = analysis;
+  version++;
+  wake.notify_one();
+}
+
+std::unique_ptr<FramePacket> FramePipeline::take() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return std::move(ready);
+}
+
+void FramePipeline::recycle(std::unique_ptr<FramePacket> packet) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!spare) {
+    spare = std::move(packet);
+  }
+}
+
+std::string FramePipeline::error() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return failure;
+}
+
+void FramePipeline::prepare(FramePacket& packet, const std::vector<Instance>& instances,
+                            const FrameAnalysis& analysis) {
+  packet.instances.assign(instances.begin(), instances.end());
+  if (packet.mol.size() != topology.size()) {
+    packet.mol = topology;
+  }
+  packet.mol.setPositions(instances);
+
+  if (analysis.image && imager.periodic()) {
+    if (moleculesStale) {
+      BondPerception connectivity;
+      connectivity.setBox(analysis.box[0], analysis.box[1], analysis.box[2]);
+      imager.setMolecules(packet.mol.size(), connectivity.update(packet.mol));
+      imager.recenterOn(recenterAtom);
+      moleculesStale = false;
+    }
+    imager.apply(packet.mol, packet.instances);
+  }
+
+  packet.hasBonds = analysis.bonds;
+  if (analysis.bonds) {
+    const std::vector<Bond>& bonds = bondPerception.update(packet.mol);
+    buildBondInstances(packet.mol, bonds, analysis.box, packet.bonds);
+    packet.bondStats = {bonds.size(), bondPerception.cellsRecomputed(),
+                        bondPerception.cellCount()};
+  }
+
+  packet.hasHBonds = analysis.hbonds;
+  if (analysis.hbonds) {
+    const std::vector<HBond>& hbonds = hbondDetector.update(packet.mol, packet.frame);
+    buildHBondSegments(packet.mol, hbonds, analysis.box, packet.hbonds);
+    HBondStats& s = packet.hbondStats;
+    s.bonds = hbonds.size();
+    s.acceptors = hbondDetector.acceptorCount();
+    s.formed = hbondDetector.formed();
+    s.broken = hbondDetector.broken();
+    s.meanLifetime = hbondDetector.meanLifetime();
+    s.lifetimesRecorded = hbondDetector.lifetimesRecorded();
+    s.lifetimeResolution = hbondDetector.lifetimeResolution();
+    s.trackingRestarts = hbondDetector.trackingRestarts();
+    s.listRebuilds = hbondDetector.listRebuilds();
+    s.framesProcessed = hbondDetector.framesProcessed();
+  }
+}
+
+void FramePipeline::run() {
+  // what the detectors are set up for, and what was prepared last
+  FrameAnalysis applied;
+  size_t preparedFrame = SIZE_MAX;
+  uint64_t preparedVersion = 0;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    if (requested == preparedFrame && version == preparedVersion) {
+      wake.wait(lock);
+      continue;
+    }
+    const size_t frame = requested;
+    const uint64_t frameVersion = version;
+    const FrameAnalysis analysis = settings;
+    std::unique_ptr<FramePacket> packet = std::move(spare);
+    lock.unlock();
+
+    // A short wait, so a newer request is picked up while decoding lags.
+    const std::vector<Instance>* instances =
+      streamer.acquire(frame, std::chrono::milliseconds(10));
+    if (instances == nullptr) {
+      std::string decodeError = streamer.error();
+      lock.lock();
+      if (!spare) {
+        spare = std::move(packet);
+      }
+      if (!decodeError.empty()) {
+        failure = decodeError;
+        return;
+      }
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!packet) {
+      packet = std::make_unique<FramePacket>();
+    }
+    packet->frame = frame;
+    try {
+      if (std::memcmp(applied.box, analysis.box, sizeof(analysis.box)) != 0) {
+        bondPerception.setBox(analysis.box[0], analysis.box[1], analysis.box[2]);
+        hbondDetector.setBox(analysis.box[0], analysis.box[1], analysis.box[2]);
+        imager.setBox(analysis.box);
+        moleculesStale = true;
+      }
+      if (std::memcmp(applied.center, analysis.center, sizeof(analysis.center)) != 0) {
+        imager.setCenter(analysis.center);
+      }
+      if (applied.recenterAtom != analysis.recenterAtom) {
+        recenterAtom = analysis.recenterAtom;
+        imager.recenterOn(recenterAtom);
+      }
+      if (!sameBits(applied.hbondDistance, analysis.hbondDistance) ||
+          !sameBits(applied.hbondAngle, analysis.hbondAngle) ||
+          !sameBits(applied.hbondSkin, analysis.hbondSkin)) {
+        hbondDetector.maxDistance = analysis.hbondDistance;
+        hbondDetector.maxAngle = analysis.hbondAngle;
+        hbondDetector.skin = analysis.hbondSkin;
+        hbondDetector.reset();
+      }
+      applied = analysis;
+      prepare(*packet, *instances, analysis);
+    } catch (const std::exception& e) {
+      lock.lock();
+      failure = e.what();
+      return;
+    }
+    packet->prepareMs = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+
+    lock.lock();
+    // a packet nobody took is simply superseded
+    if (ready && !spare) {
+      spare = std::move(ready);
+    }
+    ready = std::move(packet);
+    preparedFrame = frame;
+    preparedVersion = frameVersion;
+  }
+}
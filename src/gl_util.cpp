@@ -0,0 +1,202 @@
+#include "gl_util.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "render_state.hpp"
+
+static std::string cacheDir;
+static ProgramCacheStats cacheStats;
+
+GLuint compileShader(GLenum type, const char* src) {
+  GLuint s = glCreateShader(type);
+  glShaderSource(s, 1, &src, nullptr);
+  glCompileShader(s);
+
+  GLint ok = 0;
+  glGetShaderiv(s, GL_COMPILE_STATUS, & ok);
+  if (!ok) {
+    char log[1024];
+    glGetShaderInfoLog(s, 1024, nullptr, log);
+    std::cerr << "Shader compile error:\n" << log << "\n";
+  }
+  return s;
+}
+
+// ---------- Program binary cache ----------
+
+struct ProgramBinaryHeader {
+  char magic[8];
+  uint32_t format;
+  uint32_t length;
+};
+
+static constexpr char kBinaryMagic[8] = {'C', 'K', 'P', 'R', 'O', 'G', 'B', '1'};
+
+static bool binariesSupported() {
+  static const bool supported = [] {
+    if (!GLAD_GL_VERSION_4_1 || glGetProgramBinary == nullptr) {
+      return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }();
+  return supported;
+}
+
+static uint64_t fnv1a(uint64_t h, const char* s) {
+  // the terminator goes in too, so ("ab", "c") and ("a", "bc") differ
+  do {
+    h ^= (unsigned char)*s;
+    h *= 0x100000001b3ull;
+  } while (*s++ != '\0');
+  return h;
+}
+
+// Cache file for these sources on the current driver, or "" when disabled.
+static std::string binaryPath(const char* vsSrc, const char* fsSrc) {
+  if (cacheDir.empty() || !binariesSupported()) {
+    return "";
+  }
+  uint64_t h = 0xcbf29ce484222325ull;
+  h = fnv1a(h, vsSrc);
+  h = fnv1a(h, fsSrc);
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const GLubyte* s = glGetString(name);
+    h = fnv1a(h, s != nullptr ? (const char*)s : "");
+  }
+  char file[32];
+  std::snprintf(file, sizeof(file), "%016llx.bin", (unsigned long long)h);
+  return (std::filesystem::path(cacheDir) / file).string();
+}
+
+// The linked program stored at `path`, or 0 if missing or rejected.
+static GLuint loadBinary(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  ProgramBinaryHeader header;
+  if (!in.read((char*)&header, sizeof(header)) ||
+      std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+    return 0;
+  }
+  std::vector<char> binary(header.length);
+  if (!in.read(binary.data(), (std::streamsize)binary.size())) {
+    return 0;
+  }
+  GLuint p = glCreateProgram();
+  glProgramBinary(p, header.format, binary.data(), (GLsizei)binary.size());
+  GLint ok = 0;
+  glGetProgramiv(p, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    // driver update or different GPU behind the same strings
+    glDeleteProgram(p);
+    return 0;
+  }
+  return p;
+}
+
+static void saveBinary(GLuint p, const std::string& path) {
+  GLint length = 0;
+  glGetProgramiv(p, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  ProgramBinaryHeader header;
+  std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(p, length, &length, &format, binary.data());
+  header.format = format;
+  header.length = (uint32_t)length;
+
+  // a failed write only costs a compile next time
+  std::error_code ec;
+  std::filesystem::create_directories(cacheDir, ec);
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write(binary.data(), length);
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp, path, ec);
+}
+
+void setProgramCacheDir(const std::string& dir) {
+  cacheDir = dir;
+}
+
+std::string defaultProgramCacheDir() {
+  std::filesystem::path base;
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0') {
+    base = xdg;
+  } else if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    base = std::filesystem::path(home) / ".cache";
+  } else {
+    return "";
+  }
+  return (base / "chemviz" / "shaders").string();
+}
+
+const ProgramCacheStats& programCacheStats() {
+  return cacheStats;
+}
+
+// ---------- Programs ----------
+
+static GLuint linkProgram(const char* vsSrc, const char* fsSrc, bool retrievable) {
+  GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
+  GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
+
+  GLuint p = glCreateProgram();
+  glAttachShader(p, vs);
+  glAttachShader(p, fs);
+  if (retrievable) {
+    glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glLinkProgram(p);
+
+  glDetachShader(p, vs);
+  glDetachShader(p, fs);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  return p;
+}
+
+GLuint createProgram(const char* vsSrc, const char* fsSrc) {
+  std::string cached = binaryPath(vsSrc, fsSrc);
+  GLuint p = cached.empty() ? 0 : loadBinary(cached);
+  if (p != 0) {
+    cacheStats.loaded++;
+  } else {
+    p = linkProgram(vsSrc, fsSrc, !cached.empty());
+    cacheStats.compiled++;
+
+    GLint ok = 0;
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+      char log[1024];
+      glGetProgramInfoLog(p, 1024, nullptr, log);
+      std::cerr << "Program link error:\n" << log << "\n";
+    } else if (!cached.empty()) {
+      saveBinary(p, cached);
+    }
+  }
+
+  // block bindings are not part of the binary, and GLSL 3.30 cannot set them
+  GLuint camera = glGetUniformBlockIndex(p, "Camera");
+  if (camera != GL_INVALID_INDEX) {
+    glUniformBlockBinding(p, camera, kCameraBinding);
+  }
+  return p;
+}
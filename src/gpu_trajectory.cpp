@@ -0,0 +1,100 @@
+#include "gpu_trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QuantizedFrames quantizeFrames(FramePipeline& frames, size_t first, size_t count) {
+  QuantizedFrames q;
+  q.atoms = frames.atomCount();
+  q.first = std::min(first, frames.frameCount());
+  q.frames = std::min(count, frames.frameCount() - q.first);
+
+  // Positions are kept as floats until the bounding box of the whole window
+  // is known; decoding twice would cost more than the transient memory.
+  std::vector<float> positions(q.frames * q.atoms * 3);
+  std::vector<Instance> frame;
+  float lo[3], hi[3];
+  for (int k = 0; k < 3; k++) {
+    lo[k] = std::numeric_limits<float>::max();
+    hi[k] = std::numeric_limits<float>::lowest();
+  }
+
+  for (size_t f = 0; f < q.frames; f++) {
+    frames.fetch(q.first + f, frame);
+    float* dst = positions.data() + f * q.atoms * 3;
+    for (size_t i = 0; i < q.atoms; i++) {
+      const float p[3] = {frame[i].x, frame[i].y, frame[i].z};
+      for (int k = 0; k < 3; k++) {
+        dst[i * 3 + k] = p[k];
+        lo[k] = std::min(lo[k], p[k]);
+        hi[k] = std::max(hi[k], p[k]);
+      }
+    }
+  }
+
+  float inv[3];
+  for (int k = 0; k < 3; k++) {
+    if (q.frames == 0 || q.atoms == 0) {
+      lo[k] = hi[k] = 0.0f;
+    }
+    q.origin[k] = lo[k];
+    q.extent[k] = std::max(hi[k] - lo[k], 1e-6f);
+    inv[k] = 65535.0f / q.extent[k];
+  }
+
+  const size_t n = q.frames * q.atoms;
+  q.texels.resize(n * 4);
+  for (size_t t = 0; t < n; t++) {
+    for (int k = 0; k < 3; k++) {
+      float v = std::round((positions[t * 3 + k] - q.origin[k]) * inv[k]);
+      q.texels[t * 4 + k] = (uint16_t)std::clamp(v, 0.0f, 65535.0f);
+    }
+    q.texels[t * 4 + 3] = 0;
+  }
+  return q;
+}
+
+GpuTrajectory::~GpuTrajectory() {
+  release();
+}
+
+void GpuTrajectory::upload(const QuantizedFrames& q) {
+  release();
+
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  glBufferData(GL_TEXTURE_BUFFER, q.texels.size() * sizeof(uint16_t), q.texels.data(), GL_STATIC_DRAW);
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16, buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  firstFrame = q.first;
+  frames = q.frames;
+  atoms = q.atoms;
+  for (int k = 0; k < 3; k++) {
+    box[k] = q.origin[k];
+    box[3 + k] = q.extent[k];
+  }
+}
+
+void GpuTrajectory::release() {
+  if (texture != 0) {
+    glDeleteTextures(1, &texture);
+    texture = 0;
+  }
+  if (buffer != 0) {
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+  }
+  frames = 0;
+}
+
+void GpuTrajectory::bind(GLenum unit) const {
+  glActiveTexture(unit);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,381 @@
+#include "hbonds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Longest donor-hydrogen covalent bond considered when attaching hydrogens.
+static constexpr float kDonorHydrogen = 1.25f;
+
+static bool isHeavy(uint8_t z) {
+  return z == 7 || z == 8 || z == 9;
+}
+
+// Nearest multiple of the box length. Positions may be unwrapped, so this
+// rounds rather than subtracting one box length; the truncating conversion
+// avoids a libm call in the per-frame loops.
+static float imageShift(float d, float length, float inverse) {
+  float t = d * inverse;
+  return length * (float)(int64_t)(t + (t < 0.0f ? -0.5f : 0.5f));
+}
+
+void HBondDetector::setBox(float lx, float ly, float lz) {
+  box[0] = lx;
+  box[1] = ly;
+  box[2] = lz;
+  periodic = lx > 0.0f && ly > 0.0f && lz > 0.0f;
+  for (int a = 0; a < 3; a++) {
+    invBox[a] = periodic ? 1.0f / box[a] : 0.0f;
+  }
+  reset();
+}
+
+void HBondDetector::reset() {
+  stale = true;
+  current.clear();
+  trackedKeys.clear();
+  trackedSince.clear();
+  lastFrame = SIZE_MAX;
+  frames = 0;
+  rebuilds = 0;
+  formedLast = 0;
+  brokenLast = 0;
+  lifetimeSum = 0.0;
+  ended = 0;
+  largestStep = 0;
+  restarts = 0;
+}
+
+bool HBondDetector::listStale(const Molecule& mol) const {
+  if (stale || refX.size() != heavy.size() || std::abs(listCutoff - (maxDistance + skin)) > 1e-6f ||
+      (!heavy.empty() && heavy.back() >= mol.size())) {
+    return true;
+  }
+  const float limit = 0.25f * skin * skin;
+  for (size_t k = 0; k < heavy.size(); k++) {
+    uint32_t i = heavy[k];
+    float dx = mol.x[i] - refX[k];
+    float dy = mol.y[i] - refY[k];
+    float dz = mol.z[i] - refZ[k];
+    dx -= imageShift(dx, box[0], invBox[0]);
+    dy -= imageShift(dy, box[1], invBox[1]);
+    dz -= imageShift(dz, box[2], invBox[2]);
+    if (dx * dx + dy * dy + dz * dz > limit) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HBondDetector::rebuild(const Molecule& mol) {
+  const size_t n = mol.size();
+  listCutoff = maxDistance + skin;
+
+  // ---------- Grid over the heavy atoms ----------
+  float lo[3] = {0.0f, 0.0f, 0.0f};
+  float len[3] = {box[0], box[1], box[2]};
+  if (!periodic && n > 0) {
+    const std::span<const float> p[3] = {mol.xs(), mol.ys(), mol.zs()};
+    for (int a = 0; a < 3; a++) {
+      auto [mn, mx] = std::minmax_element(p[a].begin(), p[a].end());
+      lo[a] = *mn;
+      len[a] = std::max(*mx - *mn, 1e-3f);
+    }
+  }
+  int dims[3];
+  for (int a = 0; a < 3; a++) {
+    dims[a] = std::clamp((int)(len[a] / listCutoff), 1, 512);
+  }
+  const size_t cells = (size_t)dims[0] * dims[1] * dims[2];
+  auto wrap = [&](float v, int a) {
+    v -= lo[a];
+    return periodic ? v - len[a] * std::floor(v / len[a]) : v;
+  };
+  auto cellOf = [&](float x, float y, float z) {
+    const float v[3] = {x, y, z};
+    int c[3];
+    for (int a = 0; a < 3; a++) {
+      c[a] = std::clamp((int)(v[a] / len[a] * (float)dims[a]), 0, dims[a] - 1);
+    }
+    return (uint32_t)((c[2] * dims[1] + c[1]) * dims[0] + c[0]);
+  };
+
+  // heavy atoms are numbered in cell order, and their wrapped positions
+  // gathered the same way, so neighbor scans read contiguous runs
+  std::vector<uint32_t> atomCell;
+  std::vector<uint32_t> cellStart(cells + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (isHeavy(mol.atomicNumbers[i])) {
+      atomCell.push_back(cellOf(wrap(mol.x[i], 0), wrap(mol.y[i], 1), wrap(mol.z[i], 2)));
+      cellStart[atomCell.back() + 1]++;
+    }
+  }
+  for (size_t c = 0; c < cells; c++) {
+    cellStart[c + 1] += cellStart[c];
+  }
+  heavy.resize(atomCell.size());
+  AlignedVector<float> sx(heavy.size()), sy(heavy.size()), sz(heavy.size());
+  std::vector<uint32_t> heavySlot(n, UINT32_MAX);
+  {
+    std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (isHeavy(mol.atomicNumbers[i])) {
+        uint32_t slot = cursor[atomCell[k++]]++;
+        heavy[slot] = (uint32_t)i;
+        heavySlot[i] = slot;
+        sx[slot] = wrap(mol.x[i], 0);
+        sy[slot] = wrap(mol.y[i], 1);
+        sz[slot] = wrap(mol.z[i], 2);
+      }
+    }
+  }
+
+  // Slot ranges of the cells around `cell`, consecutive cells merged. Small
+  // periodic grids take every cell along that axis instead of wrapping onto
+  // the same one twice.
+  auto cellRuns = [&](uint32_t cell, uint32_t runs[27][2]) {
+    const int c[3] = {(int)(cell % (uint32_t)dims[0]), (int)(cell / (uint32_t)dims[0] % (uint32_t)dims[1]),
+                      (int)(cell / (uint32_t)(dims[0] * dims[1]))};
+    int range[3][2];
+    for (int a = 0; a < 3; a++) {
+      if (periodic && dims[a] >= 3) {
+        range[a][0] = c[a] - 1;
+        range[a][1] = c[a] + 1;
+      } else if (periodic) {
+        range[a][0] = 0;
+        range[a][1] = dims[a] - 1;
+      } else {
+        range[a][0] = std::max(c[a] - 1, 0);
+        range[a][1] = std::min(c[a] + 1, dims[a] - 1);
+      }
+    }
+    uint32_t ids[27];
+    int count = 0;
+    for (int z = range[2][0]; z <= range[2][1]; z++) {
+      int wz = (z + dims[2]) % dims[2];
+      for (int y = range[1][0]; y <= range[1][1]; y++) {
+        int row = (wz * dims[1] + (y + dims[1]) % dims[1]) * dims[0];
+        for (int x = range[0][0]; x <= range[0][1]; x++) {
+          ids[count++] = (uint32_t)(row + (x + dims[0]) % dims[0]);
+        }
+      }
+    }
+    std::sort(ids, ids + count);
+    int nruns = 0;
+    for (int k = 0; k < count; k++) {
+      if (nruns > 0 && ids[k] == ids[k - 1] + 1) {
+        runs[nruns - 1][1] = cellStart[ids[k] + 1];
+      } else {
+        runs[nruns][0] = cellStart[ids[k]];
+        runs[nruns][1] = cellStart[ids[k] + 1];
+        nruns++;
+      }
+    }
+    return nruns;
+  };
+
+  // wrapped positions are at most one box length apart
+  float half[3], length[3];
+  for (int a = 0; a < 3; a++) {
+    length[a] = periodic ? box[a] : 0.0f;
+    half[a] = periodic ? 0.5f * box[a] : INFINITY;
+  }
+  auto distance2 = [&](float x, float y, float z, uint32_t t) {
+    float dx = sx[t] - x;
+    float dy = sy[t] - y;
+    float dz = sz[t] - z;
+    dx -= dx > half[0] ? length[0] : (dx < -half[0] ? -length[0] : 0.0f);
+    dy -= dy > half[1] ? length[1] : (dy < -half[1] ? -length[1] : 0.0f);
+    dz -= dz > half[2] ? length[2] : (dz < -half[2] ? -length[2] : 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+  };
+
+  // ---------- Neighbor list ----------
+  const float cut2 = listCutoff * listCutoff;
+  neighborStart.assign(1, 0);
+  neighbors.clear();
+  uint32_t runs[27][2];
+  for (uint32_t cell = 0; cell < (uint32_t)cells; cell++) {
+    if (cellStart[cell] == cellStart[cell + 1]) {
+      continue;
+    }
+    int nruns = cellRuns(cell, runs);
+    for (uint32_t s = cellStart[cell]; s < cellStart[cell + 1]; s++) {
+      for (int k = 0; k < nruns; k++) {
+        for (uint32_t t = runs[k][0]; t < runs[k][1]; t++) {
+          if (t != s && distance2(sx[s], sy[s], sz[s], t) < cut2) {
+            neighbors.push_back(t);
+          }
+        }
+      }
+      neighborStart.push_back((uint32_t)neighbors.size());
+    }
+  }
+
+  // ---------- Hydrogens to their nearest donor ----------
+  std::vector<uint32_t> donorOf;
+  std::vector<uint32_t> attached;
+  for (size_t i = 0; i < n; i++) {
+    if (mol.atomicNumbers[i] != 1 || heavy.empty()) {
+      continue;
+    }
+    float x = wrap(mol.x[i], 0), y = wrap(mol.y[i], 1), z = wrap(mol.z[i], 2);
+    int nruns = cellRuns(cellOf(x, y, z), runs);
+    uint32_t donor = UINT32_MAX;
+    float best = kDonorHydrogen * kDonorHydrogen;
+    for (int k = 0; k < nruns; k++) {
+      for (uint32_t t = runs[k][0]; t < runs[k][1]; t++) {
+        float d2 = distance2(x, y, z, t);
+        if (d2 < best) {
+          best = d2;
+          donor = t;
+        }
+      }
+    }
+    if (donor != UINT32_MAX) {
+      donorOf.push_back(donor);
+      attached.push_back((uint32_t)i);
+    }
+  }
+  hydrogenStart.assign(heavy.size() + 1, 0);
+  for (uint32_t k : donorOf) {
+    hydrogenStart[k + 1]++;
+  }
+  for (size_t k = 0; k < heavy.size(); k++) {
+    hydrogenStart[k + 1] += hydrogenStart[k];
+  }
+  hydrogens.resize(attached.size());
+  {
+    std::vector<uint32_t> cursor(hydrogenStart.begin(), hydrogenStart.end() - 1);
+    for (size_t h = 0; h < attached.size(); h++) {
+      hydrogens[cursor[donorOf[h]]++] = attached[h];
+    }
+  }
+
+  refX.resize(heavy.size());
+  refY.resize(heavy.size());
+  refZ.resize(heavy.size());
+  for (size_t k = 0; k < heavy.size(); k++) {
+    refX[k] = mol.x[heavy[k]];
+    refY[k] = mol.y[heavy[k]];
+    refZ[k] = mol.z[heavy[k]];
+  }
+  stale = false;
+  rebuilds++;
+}
+
+const std::vector<HBond>& HBondDetector::update(const Molecule& mol, size_t frame) {
+  if (listStale(mol)) {
+    rebuild(mol);
+  }
+
+  // heavy positions in slot order, so listed neighbors are mostly nearby in memory
+  const size_t count = heavy.size();
+  px.resize(count);
+  py.resize(count);
+  pz.resize(count);
+  for (size_t k = 0; k < count; k++) {
+    px[k] = mol.x[heavy[k]];
+    py[k] = mol.y[heavy[k]];
+    pz[k] = mol.z[heavy[k]];
+  }
+
+  current.clear();
+  const float maxD2 = maxDistance * maxDistance;
+  const float cosMax = std::cos(maxAngle * 3.14159265f / 180.0f);
+  for (size_t k = 0; k < count; k++) {
+    if (hydrogenStart[k] == hydrogenStart[k + 1]) {
+      continue;
+    }
+    for (uint32_t s = neighborStart[k]; s < neighborStart[k + 1]; s++) {
+      const uint32_t a = neighbors[s];
+      float da[3] = {px[a] - px[k], py[a] - py[k], pz[a] - pz[k]};
+      for (int c = 0; c < 3; c++) {
+        da[c] -= imageShift(da[c], box[c], invBox[c]);
+      }
+      float r2 = da[0] * da[0] + da[1] * da[1] + da[2] * da[2];
+      if (r2 >= maxD2) {
+        continue;
+      }
+      float rda = std::sqrt(r2);
+      for (uint32_t h = hydrogenStart[k]; h < hydrogenStart[k + 1]; h++) {
+        const uint32_t hydrogen = hydrogens[h];
+        float dh[3] = {mol.x[hydrogen] - px[k], mol.y[hydrogen] - py[k], mol.z[hydrogen] - pz[k]};
+        for (int c = 0; c < 3; c++) {
+          dh[c] -= imageShift(dh[c], box[c], invBox[c]);
+        }
+        float rdh = std::sqrt(dh[0] * dh[0] + dh[1] * dh[1] + dh[2] * dh[2]);
+        float dot = dh[0] * da[0] + dh[1] * da[1] + dh[2] * da[2];
+        if (dot >= cosMax * rdh * rda) {
+          current.push_back({heavy[k], hydrogen, heavy[a]});
+        }
+      }
+    }
+  }
+
+  if (frame != lastFrame) {
+    track(frame);
+  }
+  frames++;
+  return current;
+}
+
+void HBondDetector::track(size_t frame) {
+  const bool continuing =
+    lastFrame != SIZE_MAX && frame > lastFrame && frame - lastFrame <= std::max<size_t>(maxGap, 1);
+  if (continuing) {
+    largestStep = std::max(largestStep, frame - lastFrame);
+  } else {
+    restarts += lastFrame != SIZE_MAX ? 1 : 0;
+    trackedKeys.clear();
+    trackedSince.clear();
+  }
+
+  nextKeys.clear();
+  for (const HBond& b : current) {
+    nextKeys.push_back((uint64_t)b.hydrogen << 32 | b.acceptor);
+  }
+  std::sort(nextKeys.begin(), nextKeys.end());
+  nextSince.assign(nextKeys.size(), frame);
+
+  formedLast = 0;
+  brokenLast = 0;
+  size_t i = 0, j = 0;
+  while (i < trackedKeys.size() || j < nextKeys.size()) {
+    if (j == nextKeys.size() || (i < trackedKeys.size() && trackedKeys[i] < nextKeys[j])) {
+      brokenLast++;
+      lifetimeSum += (double)(frame - trackedSince[i]);
+      ended++;
+      i++;
+    } else if (i == trackedKeys.size() || nextKeys[j] < trackedKeys[i]) {
+      formedLast += continuing ? 1 : 0;
+      j++;
+    } else {
+      nextSince[j] = trackedSince[i];
+      i++;
+      j++;
+    }
+  }
+  std::swap(trackedKeys, nextKeys);
+  std::swap(trackedSince, nextSince);
+  lastFrame = frame;
+}
+
+void buildHBondSegments(const Molecule& mol, std::span<const HBond> hbonds,
+                        const float box[3], std::vector<HBondSegment>& out) {
+  float invBox[3];
+  for (int a = 0; a < 3; a++) {
+    invBox[a] = box[a] > 0.0f ? 1.0f / box[a] : 0.0f;
+  }
+  out.resize(hbonds.size());
+  for (size_t k = 0; k < hbonds.size(); k++) {
+    uint32_t h = hbonds[k].hydrogen, a = hbonds[k].acceptor;
+    float dx = mol.x[a] - mol.x[h];
+    float dy = mol.y[a] - mol.y[h];
+    float dz = mol.z[a] - mol.z[h];
+    dx -= imageShift(dx, box[0], invBox[0]);
+    dy -= imageShift(dy, box[1], invBox[1]);
+    dz -= imageShift(dz, box[2], invBox[2]);
+    out[k] = {mol.x[h], mol.y[h], mol.z[h], mol.x[h] + dx, mol.y[h] + dy, mol.z[h] + dz};
+  }
+}
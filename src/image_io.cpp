@@ -0,0 +1,279 @@
+#include "image_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+// ---------- Deflate (fixed Huffman codes, greedy LZ77) ----------
+
+static constexpr uint16_t kLengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static constexpr uint8_t kLengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static constexpr uint16_t kDistBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+  193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static constexpr uint8_t kDistExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static constexpr size_t kWindow = 32768;
+static constexpr size_t kMaxMatch = 258;
+static constexpr int kHashBits = 15;
+static constexpr int kMaxChain = 32;
+
+struct BitWriter {
+  std::vector<uint8_t>& out;
+  uint32_t acc = 0;
+  int count = 0;
+
+  // Deflate packs values LSB first.
+  void put(uint32_t value, int bits) {
+    acc |= value << count;
+    count += bits;
+    while (count >= 8) {
+      out.push_back(uint8_t(acc));
+      acc >>= 8;
+      count -= 8;
+    }
+  }
+
+  // Huffman codes are defined MSB first.
+  void putCode(uint32_t code, int bits) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < bits; i++) {
+      reversed |= ((code >> i) & 1u) << (bits - 1 - i);
+    }
+    put(reversed, bits);
+  }
+
+  void flush() {
+    if (count > 0) {
+      out.push_back(uint8_t(acc));
+    }
+    acc = 0;
+    count = 0;
+  }
+};
+
+static void putLiteral(BitWriter& bw, unsigned v) {
+  if (v < 144) {
+    bw.putCode(0x30 + v, 8);
+  } else if (v < 256) {
+    bw.putCode(0x190 + (v - 144), 9);
+  } else if (v < 280) {
+    bw.putCode(v - 256, 7);
+  } else {
+    bw.putCode(0xC0 + (v - 280), 8);
+  }
+}
+
+static void putMatch(BitWriter& bw, size_t length, size_t distance) {
+  int l = 28;
+  while (kLengthBase[l] > length) {
+    l--;
+  }
+  putLiteral(bw, 257 + l);
+  bw.put(uint32_t(length - kLengthBase[l]), kLengthExtra[l]);
+
+  int d = 29;
+  while (kDistBase[d] > distance) {
+    d--;
+  }
+  bw.putCode(d, 5);
+  bw.put(uint32_t(distance - kDistBase[d]), kDistExtra[d]);
+}
+
+static uint32_t hash3(const uint8_t* p) {
+  uint32_t v = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16;
+  return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size) {
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    size_t n = size < 5552 ? size : 5552;
+    size -= n;
+    while (n-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> out = {0x78, 0x01};
+  out.reserve(size / 2 + 64);
+
+  BitWriter bw{out};
+  bw.put(1, 1);  // BFINAL
+  bw.put(1, 2);  // BTYPE = fixed Huffman
+
+  // head: most recent position per hash; prev: previous position with the
+  // same hash, indexed modulo the window.
+  std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+  std::vector<int32_t> prev(kWindow, -1);
+
+  auto insert = [&](size_t pos) {
+    uint32_t h = hash3(data + pos);
+    prev[pos % kWindow] = head[h];
+    head[h] = int32_t(pos);
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    size_t bestLen = 0, bestDist = 0;
+    if (i + 3 <= size) {
+      size_t limit = std::min(kMaxMatch, size - i);
+      int32_t cand = head[hash3(data + i)];
+      for (int chain = 0; chain < kMaxChain && cand >= 0; chain++) {
+        size_t dist = i - size_t(cand);
+        if (dist > kWindow - 1) {
+          break;
+        }
+        size_t len = 0;
+        while (len < limit && data[cand + len] == data[i + len]) {
+          len++;
+        }
+        if (len > bestLen) {
+          bestLen = len;
+          bestDist = dist;
+          if (len == limit) {
+            break;
+          }
+        }
+        int32_t next = prev[size_t(cand) % kWindow];
+        if (next >= cand) {
+          break;
+        }
+        cand = next;
+      }
+    }
+
+    if (bestLen >= 3) {
+      putMatch(bw, bestLen, bestDist);
+      for (size_t k = 0; k < bestLen; k++, i++) {
+        if (i + 3 <= size) {
+          insert(i);
+        }
+      }
+    } else {
+      putLiteral(bw, data[i]);
+      if (i + 3 <= size) {
+        insert(i);
+      }
+      i++;
+    }
+  }
+  putLiteral(bw, 256);
+  bw.flush();
+
+  uint32_t adler = adler32(data, size);
+  for (int s = 24; s >= 0; s -= 8) {
+    out.push_back(uint8_t(adler >> s));
+  }
+  return out;
+}
+
+// ---------- PNG ----------
+
+static const std::array<uint32_t, 256> kCrcTable = [] {
+  std::array<uint32_t, 256> t{};
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    t[n] = c;
+  }
+  return t;
+}();
+
+static void putBE32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int s = 24; s >= 0; s -= 8) {
+    out.push_back(uint8_t(v >> s));
+  }
+}
+
+static void writeChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(data.size() + 12);
+  putBE32(chunk, uint32_t(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 4; i < chunk.size(); i++) {
+    crc = kCrcTable[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+  }
+  putBE32(chunk, crc ^ 0xFFFFFFFFu);
+  file.write((const char*)chunk.data(), chunk.size());
+}
+
+void writePng(const std::string& path, const uint8_t* rgba, int width, int height) {
+  // Each scanline gets the Sub filter: neighbouring pixels are usually close,
+  // which leaves long runs of small residuals for the LZ77 stage.
+  const size_t stride = size_t(width) * 3 + 1;
+  std::vector<uint8_t> raw(stride * height);
+  for (int y = 0; y < height; y++) {
+    const uint8_t* src = rgba + size_t(height - 1 - y) * width * 4;
+    uint8_t* dst = raw.data() + y * stride;
+    dst[0] = 1;
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < 3; c++) {
+        uint8_t left = x > 0 ? src[(x - 1) * 4 + c] : 0;
+        dst[1 + x * 3 + c] = uint8_t(src[x * 4 + c] - left);
+      }
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open file: " + path + "\n");
+  }
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  file.write((const char*)signature, 8);
+
+  std::vector<uint8_t> header;
+  putBE32(header, uint32_t(width));
+  putBE32(header, uint32_t(height));
+  header.insert(header.end(), {8, 2, 0, 0, 0});
+  writeChunk(file, "IHDR", header);
+  writeChunk(file, "IDAT", zlibCompress(raw.data(), raw.size()));
+  writeChunk(file, "IEND", {});
+
+  if (!file) {
+    throw std::runtime_error("Failed to write file: " + path + "\n");
+  }
+}
+
+// ---------- PPM ----------
+
+void writePpm(const std::string& path, const uint8_t* rgba, int width, int height) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open file: " + path + "\n");
+  }
+  file << "P6\n" << width << " " << height << "\n255\n";
+
+  std::vector<uint8_t> row(size_t(width) * 3);
+  for (int y = height - 1; y >= 0; y--) {
+    const uint8_t* src = rgba + size_t(y) * width * 4;
+    for (int x = 0; x < width; x++) {
+      row[x * 3 + 0] = src[x * 4 + 0];
+      row[x * 3 + 1] = src[x * 4 + 1];
+      row[x * 3 + 2] = src[x * 4 + 2];
+    }
+    file.write((const char*)row.data(), row.size());
+  }
+
+  if (!file) {
+    throw std::runtime_error("Failed to write file: " + path + "\n");
+  }
+}
@@ -0,0 +1,4 @@
+#include "lib.hpp"
+
+library::library() : name("ChemisKit") {
+}
@@ -1,9 +1,21 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <cfloat>
 #include <cmath>
 #include <fstream>
 #include <unistd.h>
+#include <future>
+#include <memory>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <thread>
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -14,37 +26,30 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include "imgui_internal.h"
 
-static float g_zoom = 0.2f;
-
-struct OrbitCamera {
-  glm::vec3 target = glm::vec3(0.0f);
-  float distance = 10.0f;
-  float yaw = 0.0f;
-  float pitch = 0.3f;
-
-  float fov = 45.0f;
-  float nearPlane = 0.01f;
-  float farPlane = 1000.0f;
-
-  glm::vec3 position() const {
-    glm::vec3 dir;
-    dir.x = cos(pitch) * sin(yaw);
-    dir.y = sin(pitch);
-    dir.z = cos(pitch) * cos(yaw);
-    return target + dir * distance;
-  }
-
-  glm::mat4 view() const {
-    return glm::lookAt(position(), target, glm::vec3(0,1,0));
-  }
-
-  glm::mat4 projection(float aspect) const {
-    return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
-  }
-};
+#include "atom_picker.hpp"
+#include "binary_trajectory.hpp"
+#include "bond_renderer.hpp"
+#include "camera.hpp"
+#include "frame_capture.hpp"
+#include "frame_pipeline.hpp"
+#include "gl_util.hpp"
+#include "gpu_trajectory.hpp"
+#include "hbonds.hpp"
+#include "molecule.hpp"
+#include "playback_clock.hpp"
+#include "profiler.hpp"
+#include "rdf_panel.hpp"
+#include "render_state.hpp"
+#include "scene_loader.hpp"
+#include "scene_view.hpp"
+#include "sphere_lod.hpp"
+#include "sphere_renderer.hpp"
+#include "trajectory.hpp"
+
+// Systems larger than this open in the octree sphere mode.
+static constexpr size_t kOctreeAtoms = 1000000;
 
 static OrbitCamera g_cam;
 
@@ -69,233 +74,83 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
   glViewport(0, 0, width, height);
 }
 
-struct Mesh {
-  std::vector<float> vertices;
-  std::vector<unsigned int> indices;
-};
-
-struct Instance {
-  float x, y ,z;
-  float radius;
-  float r, g, b;
-};
-
-Mesh createSphere(float radius, int sectorCount, int stackCount) {
-  Mesh mesh;
-  const float pi = M_PI;
-
-  float x, y, z, xy;
-  float sectorStep = 2 * pi / sectorCount;
-  float stackStep = pi / stackCount;
-  float sectorAngle, stackAngle;
-
-  for (int i = 0; i <= stackCount; i++) {
-    stackAngle = pi / 2 - i * stackStep;
-    xy = radius * cosf(stackAngle);
-    y = radius * sinf(stackAngle);
-
-    for (int j = 0; j <= sectorCount; j++) {
-      sectorAngle = j * sectorStep;
-
-      x = xy * cosf(sectorAngle);
-      z = xy * sinf(sectorAngle);
-
-      mesh.vertices.push_back(x);
-      mesh.vertices.push_back(y);
-      mesh.vertices.push_back(z);
-
-      mesh.vertices.push_back(x / radius);
-      mesh.vertices.push_back(y / radius);
-      mesh.vertices.push_back(z / radius);
+// Regular files in the working directory, for the File > Open dialog.
+static std::vector<std::string> listFiles() {
+  std::vector<std::string> names;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(".", ec)) {
+    if (entry.is_regular_file(ec)) {
+      names.push_back(entry.path().filename().string());
     }
   }
-
-  int k1, k2;
-  for (int i = 0; i < stackCount; i++) {
-    k1 = i * (sectorCount + 1);
-    k2 = k1 + sectorCount + 1;
-
-    for (int j = 0; j < sectorCount; j++, k1++, k2++) {
-      if (i != 0) {
-        mesh.indices.push_back(k1);
-        mesh.indices.push_back(k2);
-        mesh.indices.push_back(k1 + 1);
-      }
-
-      if (i != (stackCount - 1)) {
-        mesh.indices.push_back(k1 + 1);
-        mesh.indices.push_back(k2);
-        mesh.indices.push_back(k2 + 1);
-      }
-    }
-  }
-
-  return mesh;
-}
-
-static GLuint compileShader(GLenum type, const char* src) {
-  GLuint s = glCreateShader(type);
-  glShaderSource(s, 1, &src, nullptr);
-  glCompileShader(s);
-
-  GLint ok = 0;
-  glGetShaderiv(s, GL_COMPILE_STATUS, & ok);
-  if (!ok) {
-    char log[1024];
-    glGetShaderInfoLog(s, 1024, nullptr, log);
-    std::cerr << "Shader compile error:\n" << log << "\n";
-  }
-  return s;
+  std::sort(names.begin(), names.end());
+  return names;
 }
 
-static GLuint createProgram(const char* vsSrc, const char* fsSrc) {
-  GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
-  GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
-
-  GLuint p = glCreateProgram();
-  glAttachShader(p, vs);
-  glAttachShader(p, fs);
-  glLinkProgram(p);
-
-  GLint ok = 0;
-  glGetProgramiv(p, GL_LINK_STATUS, &ok);
-  if (!ok) {
-    char log[1024];
-    glGetProgramInfoLog(p, 1024, nullptr, log);
-    std::cerr << "Program link error:\n" << log << "\n";
-  }
-
-  glDeleteShader(vs);
-  glDeleteShader(fs);
-  return p;
-}
-
-struct Atom {
-  std::string sym;
-  int atomicNumber;
-  float x, y, z;
-};
-
-struct AtomDraw {
-  float x, y, z;
-  float radius;
-  float r, g, b;
-};
-
-struct Molecule {
-  std::vector<Atom> atoms;
-
-  int size() const {
-    return (int)atoms.size();
-  }
-
-  std::vector<float> coords1D() const {
-    std::vector<float> out;
-    out.reserve(atoms.size() * 3);
-
-    for (const Atom& a : atoms) {
-      out.push_back(a.x);
-      out.push_back(a.y);
-      out.push_back(a.z);
+auto main(int argc, char** argv) -> int {
+  const auto startTime = std::chrono::steady_clock::now();
+  if (argc >= 4 && std::string(argv[1]) == "--convert") {
+    bool quantize = argc >= 5 && std::string(argv[4]) == "--quantize";
+    try {
+      convertXyzToBinary(argv[2], argv[3], quantize);
+    } catch (const std::exception& e) {
+      std::cerr << e.what();
+      return 1;
     }
-
-    return out;
+    return 0;
   }
 
-  std::vector<std::string> symbols() const {
-    std::vector<std::string> out;
-    out.reserve(atoms.size());
-
-    for (const Atom& a : atoms) {
-      out.push_back(a.sym);
+  // Headless batch rendering:
+  //   --render <trajectory> <output dir> [--frames first:last] [--size WxH]
+  //            [--format png|ppm] [--threads N]
+  // renders every frame in the range with the default camera into an
+  // offscreen framebuffer and writes <output dir>/frame_NNNNNN.<format>.
+  bool headless = false;
+  std::string renderDir;
+  std::string renderFormat = "png";
+  size_t renderFirst = 0;
+  size_t renderLast = SIZE_MAX;
+  int renderWidth = 1920;
+  int renderHeight = 1080;
+  unsigned renderThreads = 0;
+  std::string path = argc > 1 ? argv[1] : "./waterbox-1195.xyz";
+
+  if (argc >= 4 && std::string(argv[1]) == "--render") {
+    headless = true;
+    path = argv[2];
+    renderDir = argv[3];
+    for (int i = 4; i + 1 < argc; i += 2) {
+      std::string opt = argv[i];
+      const char* value = argv[i + 1];
+      if (opt == "--frames") {
+        if (std::sscanf(value, "%zu:%zu", &renderFirst, &renderLast) != 2
+            || renderFirst > renderLast) {
+          std::cerr << "Invalid --frames, expected first:last: " << value << "\n";
+          return 1;
+        }
+      } else if (opt == "--size") {
+        if (std::sscanf(value, "%dx%d", &renderWidth, &renderHeight) != 2
+            || renderWidth <= 0 || renderHeight <= 0) {
+          std::cerr << "Invalid --size, expected WxH: " << value << "\n";
+          return 1;
+        }
+      } else if (opt == "--format") {
+        renderFormat = value;
+      } else if (opt == "--threads") {
+        renderThreads = (unsigned)std::atoi(value);
+      } else {
+        std::cerr << "Unknown option: " << opt << "\n";
+        return 1;
+      }
     }
-
-    return out;
   }
-};
-
-Molecule read_xyz(std::string filename) {
-  std::ifstream xyz_file(filename);
-  if (!xyz_file.is_open()) {
-    throw std::runtime_error("Failed to open file: " + filename + "\n");
-  }
-
-  Molecule mol;
-  int natoms;
-  std::string comment;
-
-  if (!(xyz_file >> natoms)){
-    throw std::runtime_error("Failed to read atom count.\n");
-  }
-
-  xyz_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-  std::getline(xyz_file, comment);
-
-  std::string element;
-  float x, y, z;
-  while (xyz_file >> element >> x >> y >> z) {
-    int atomicNum = 0;
-    if (element == "H") {
-      atomicNum = 1;
-    } else if (element == "O") {
-      atomicNum = 8;
-    } else {
-      std::cerr << "Unknown atom: " << element << "\n";
-      throw std::runtime_error("Unknown atom: " + element + "\n");
-    }
-
-    Atom a = {
-      .sym = element,
-      .atomicNumber = atomicNum,
-      .x = x,
-      .y = y,
-      .z = z
-    };
 
-    mol.atoms.push_back(a);
-  }
-  if ((int)mol.atoms.size() != natoms) {
-    throw std::runtime_error(
-      "Number of atoms not equal to mol.atoms: " + std::to_string(natoms) + " : " + std::to_string(mol.atoms.size())
-    );
-  }
-  return mol;
-}
-
-AtomDraw toDraw(const Atom& a) {
-  AtomDraw d{};
-  d.x = a.x;
-  d.y = a.y;
-  d.z = a.z;
-
-  switch(a.atomicNumber) {
-    case 1: d.radius=(25.0/53.0)*0.2; d.r=0.8f; d.g=0.8f; d.b=0.8f; break;
-    case 8: d.radius=(60.0/53.0)*0.2; d.r=1.0f; d.g=0.0f; d.b=0.0f; break;
-    default: d.radius=(53.0)*0.2; d.r=0.0f; d.g=0.0f; d.b=0.0f;
-  }
-
-  return d;
-}
-
-static float elementRadius[119];
-static float elementColor[119][3];
-
-static uint32_t rng_state = 123456789;
-
-inline float fastRand() {
-  rng_state ^= rng_state << 13;
-  rng_state ^= rng_state >> 17;
-  rng_state ^= rng_state << 5;
-
-  return (rng_state & 0x00FFFFFF) / 16777216.0f;
-}
-
-inline float randRange(float min, float max) {
-  return min + (max - min) * fastRand();
-}
-
-auto main() -> int {
-  if (glfwPlatformSupported(GLFW_PLATFORM_WAYLAND)) {
+  // Cluster nodes have no display server: use GLFW's null platform, which
+  // creates its context through OSMesa (e.g. llvmpipe).
+  bool noDisplay = std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr;
+  if (headless && noDisplay) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  } else if (glfwPlatformSupported(GLFW_PLATFORM_WAYLAND)) {
     glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
   }
   glfwInit();
@@ -330,39 +185,28 @@ auto main() -> int {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_RESIZABLE, 1);
-  
-
-  Molecule mol = read_xyz("./waterbox-1195.xyz");
-  for (size_t i = 0; i < mol.atoms.size(); i++) {
-    auto a = mol.atoms[i];
-    std::cout << "[" << i << "]: " << a.sym
-              << "(Z= " << a.atomicNumber << ") (" << a.x << ", " << a.y << ", " << a.z << ")\n";
+  if (headless) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (platform == GLFW_PLATFORM_NULL) {
+      glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
   }
 
-  // for (int i = 0; i < 50; i++) {
-  //   Atom a;
-  //   a.sym = "H";
-  //   a.atomicNumber = 1;
-  //   a.x = randRange(-5.0f, 5.0f);
-  //   a.y = randRange(-5.0f, 5.0f);
-  //   a.z = randRange(-5.0f, 5.0f);
-
-  //   atoms.push_back(a);
-  // }
+  // Files are parsed off the render thread: the first one while the window
+  // opens and then shows its progress, later ones (File > Open) while the
+  // current one keeps rendering.
+  SceneLoader loader;
+  loader.start(path, kOctreeAtoms);
 
+  // Further views are ImGui windows; dragged out of the main window they get
+  // their own OS window with a context sharing this one's objects.
   GLFWwindow* window = glfwCreateWindow(1200, 800, "Test", NULL, NULL);
-  GLFWwindow* window2 = glfwCreateWindow(1200, 800, "Test", NULL, window);
 
   if (window == nullptr) {
     std::cerr << "Failed to create GLFW window\n";
     glfwTerminate();
     return -1;
   }
-  if (window2 == nullptr) {
-    std::cerr << "Failed to create GLFW window\n";
-    glfwTerminate();
-    return -1;
-  }
 
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
   glfwSetScrollCallback(window, scroll_callback);
@@ -376,11 +220,19 @@ auto main() -> int {
   std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
   std::cout << "Version:  " << glGetString(GL_VERSION)  << "\n";
 
+  // Programs are created before the UI so the shader cache is warm from the
+  // second launch on.
+  setProgramCacheDir(defaultProgramCacheDir());
+
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGuiIO& io = ImGui::GetIO(); (void)io;
   io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-  io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+  if (headless) {
+    io.IniFilename = nullptr;
+  } else {
+    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+  }
   
 
   ImGui::StyleColorsDark();
@@ -391,191 +243,273 @@ auto main() -> int {
   int fbw, fbh;
   glfwGetFramebufferSize(window, &fbw, &fbh);
   glViewport(0, 0, fbw, fbh);
-  
 
-  const char* vsSrc = R"(#version 330 core
-  layout(location=0) in vec3 aPos;
-  layout(location=1) in vec3 aNrm;
-
-  layout(location=2) in vec3 iPos;
-  layout(location=3) in float iRadius;
-  layout(location=4) in vec3 iColor;
-
-  out vec3 vNrmVS;
-  out vec3 vColor;
-
-  uniform mat4 uView;
-  uniform mat4 uProj;
-
-  void main() {
-    vec3 worldPos = (aPos * iRadius) + iPos;
-
-    vNrmVS = mat3(uView) * aNrm;
-    vColor = iColor;
-
-    gl_Position = uProj * uView * vec4(worldPos, 1.0);
+  // ---------- Wait for the first file ----------
+  std::unique_ptr<LoadedScene> initial;
+  while (!(initial = loader.poll()) && loader.busy()) {
+    if (headless) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    glfwPollEvents();
+    if (glfwWindowShouldClose(window) != 0) {
+      loader.cancel();
+      break;
+    }
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+    const ImGuiViewport* vp = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(vp->WorkPos.x + vp->WorkSize.x * 0.5f,
+                                   vp->WorkPos.y + vp->WorkSize.y * 0.5f),
+                            ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(480, 0));
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoDocking);
+    const LoadProgress& progress = loader.progress();
+    ImGui::Text("Loading %s", path.c_str());
+    ImGui::ProgressBar(progress.fraction(), ImVec2(-1.0f, 0.0f), progress.stage.load());
+    ImGui::End();
+    ImGui::Render();
+    glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+      ImGui::UpdatePlatformWindows();
+      ImGui::RenderPlatformWindowsDefault();
+      glfwMakeContextCurrent(window);
+    }
+    glfwSwapBuffers(window);
   }
-  )";
-
-  const char* fsSrc = R"(#version 330 core
-  in vec3 vNrmVS;
-  in vec3 vColor;
-  out vec4 FragColor;
-
-  void main() {
-    vec3 N = normalize(vNrmVS);
-    vec3 L = normalize(vec3(0.0, 0.0, 1.0));
-
-    float diff = max(dot(N, L), 0.0);
-    vec3 color = vColor * (0.2 + 0.8 * diff);
-    FragColor = vec4(color, 1.0);
+  if (!initial) {
+    int status = 0;
+    if (!loader.error().empty()) {
+      std::cerr << "Failed to load " << path << ": " << loader.error();
+      status = 1;
+    }
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    glfwTerminate();
+    return status;
   }
-  )";
-
-  GLuint program = createProgram(vsSrc, fsSrc);
-
-  Mesh sphere = createSphere(1.0f, 100, 100);
-
-  GLuint VAO, VBO, EBO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  glBindVertexArray(VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER,
-               sphere.vertices.size() * sizeof(float),
-               sphere.vertices.data(),
-               GL_STATIC_DRAW
-             );
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               sphere.indices.size() * sizeof(unsigned int),
-               sphere.indices.data(),
-               GL_STATIC_DRAW
-             );
-
-  glVertexAttribPointer(
-    0,
-    3,
-    GL_FLOAT,
-    GL_FALSE,
-    6 * sizeof(float),
-    (void*)0
-  );
-  glEnableVertexAttribArray(0);
-
-  glVertexAttribPointer(
-    1,
-    3,
-    GL_FLOAT,
-    GL_FALSE,
-    6 * sizeof(float),
-    (void*)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-
-  GLuint instanceVBO;
-  glGenBuffers(1, &instanceVBO);
-  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-  glBufferData(GL_ARRAY_BUFFER,
-               mol.atoms.size() * sizeof(Instance),
-               nullptr,
-               GL_STREAM_DRAW);
-
-  // attach instance attributes to the SAME VAO
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-
-  // iPos (location=2) => offset x
-  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
-                        (void*)offsetof(Instance, x));
-  glEnableVertexAttribArray(2);
-  glVertexAttribDivisor(2, 1);
-
-  // iRadius (location=3) => offset radius
-  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Instance),
-                        (void*)offsetof(Instance, radius));
-  glEnableVertexAttribArray(3);
-  glVertexAttribDivisor(3, 1);
-
-  // iColor (location=4) => offset r
-  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
-                        (void*)offsetof(Instance, r));
-  glEnableVertexAttribArray(4);
-  glVertexAttribDivisor(4, 1);
-  // glBindVertexArray(VAO);
-  // glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-
-  // // layout(location=2) vec3 iPos
-  // glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)0);
-  // glEnableVertexAttribArray(2);
-  // glVertexAttribDivisor(2, 1);
-
-  // // layout(location=3) float iRadius
-  // glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)0);
-  // glEnableVertexAttribArray(2);
-  // glVertexAttribDivisor(2, 1);
-
-  // // layout(location=2) vec3 iPos
-  // glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)0);
-  // glEnableVertexAttribArray(2);
-  // glVertexAttribDivisor(2, 1);
-
-  glfwSwapInterval(1);
-  std::vector<Instance> instances(mol.atoms.size());
-  std::vector<std::vector<Instance>> steps(50000, instances);
-
-  for (size_t i = 0; i < mol.atoms.size(); i++) {
-    instances[i] = {
-      .x=mol.atoms[i].x,
-      .y=mol.atoms[i].y,
-      .z=mol.atoms[i].z};
+  LoadedScene scene = std::move(*initial);
+  Molecule mol = std::move(scene.mol);
+  std::cout << "Loaded " << path << ": " << mol.size() << " atoms, "
+            << scene.source->frameCount() << " frames\n";
+
+  // The molecule already holds frame 0, so it is drawn on the first iteration
+  // instead of waiting for the pipeline.
+  // The stream only grows as needed; in octree mode it holds just the near
+  // spheres, so large systems don't reserve a full-size ring up front.
+  CameraUniforms camera;
+  SphereRenderer spheres(std::min<size_t>(mol.size(), kOctreeAtoms));
+  if (mol.size() > kOctreeAtoms) {
+    spheres.mode = SphereOctree;
   }
-  glm::vec3 c(0);
-  for (auto& a : mol.atoms) c += glm::vec3(a.x,a.y,a.z);
-  c /= float(mol.atoms.size());
-  g_cam.target = c;
-  g_cam.distance = 30.0f; // tweak
-
-  for (size_t step = 0; step < steps.size(); step++) {
-    for (size_t i = 0; i < mol.atoms.size(); i++) {
-      mol.atoms[i].x += randRange(-0.05f, 0.05f);
-      mol.atoms[i].y += randRange(-0.05f, 0.05f);
-      mol.atoms[i].z += randRange(-0.05f, 0.05f);
-      AtomDraw d  = toDraw(mol.atoms[i]);
-      instances[i] = {d.x, d.y, d.z, d.radius, d.r, d.g, d.b};
-    }
-    steps[step] =  instances;
+  spheres.replaceInstances(std::move(scene.instances), std::move(scene.octree),
+                           std::min<size_t>(mol.size(), kOctreeAtoms));
+
+  // Primitive counts are read back from an older query so the CPU never waits.
+  GLuint primitiveQueries[2];
+  glGenQueries(2, primitiveQueries);
+  bool queryIssued[2] = {false, false};
+  GLuint64 trianglesPerFrame = 0;
+  int queryIndex = 0;
+
+  // Bonds and H-bonds are uploaded once per frame by the main view and
+  // drawn by every view following the playhead.
+  BondRenderer bondRenderer;
+
+  const ProgramCacheStats& shaderCache = programCacheStats();
+  std::cout << "Shader programs: " << shaderCache.loaded << " cached, "
+            << shaderCache.compiled << " compiled\n";
+
+  // Bonds and H-bonds are found by the frame pipeline with these settings;
+  // the render thread only uploads what it delivers.
+  FrameAnalysis analysis;
+  bool analysisChanged = false;
+
+  std::vector<BondInstance> bondInstances;
+  BondStats bondStats;
+  bool showBonds = true;
+  bool bondsDirty = true;
+
+  std::vector<HBondSegment> hbondSegments;
+  HBondStats hbondStats;
+  bool showHBonds = false;
+  bool hbondsDirty = true;
+  // bond count of the most recent frames, oldest first
+  std::vector<float> hbondHistory;
+
+  // Picking: the BVH over the shown spheres is refit once the frame changed.
+  AtomPicker picker;
+  picker.reset(std::move(scene.bvh));
+  std::vector<uint32_t> neighbors;
+
+  bool periodicBonds = false;
+  float bondBox[3] = {0.0f, 0.0f, 0.0f};
+  // With a box, frames are imaged on the pipeline: molecules made whole and
+  // wrapped around the camera target, optionally following the selection.
+  bool imagePeriodic = true;
+  bool recenterOnSelection = false;
+
+  glfwSwapInterval(headless ? 0 : 1);
+
+  // Screenshots use a single encoder thread; batch rendering uses the pool.
+  FrameCapture frameCapture(headless ? renderThreads : 1);
+  std::unique_ptr<OffscreenTarget> offscreen;
+  if (headless) {
+    offscreen = std::make_unique<OffscreenTarget>(renderWidth, renderHeight);
   }
+  bool screenshotRequested = false;
+
+  FrameProfiler profiler;
+  bool showProfiler = false;
+
+  // Decoding and per-frame analysis run on the pipeline's workers.
+  // Shared with the pin jobs of the extra views.
+  auto pipeline = std::make_shared<FramePipeline>(std::move(scene.source), mol);
+
+  // File > Open: the loader's result is swapped in at the top of a frame.
+  // Replaced pipelines are destroyed on a worker too, since that joins their
+  // threads.
+  bool openRequested = false;
+  char openPath[1024] = {};
+  std::vector<std::string> openListing;
+  std::vector<std::future<void>> retiring;
+  // A job whose result is no longer wanted is waited for there as well, since
+  // dropping a std::async future blocks until it finishes.
+  auto retire = [&](auto& job) {
+    if (job.valid()) {
+      retiring.push_back(std::async(std::launch::async,
+                                    [old = std::move(job)]() mutable { old.wait(); }));
+    }
+  };
+
+  RdfPanel rdf(pipeline->frameCount());
+
+  // The camera and the periodic imaging centre on the middle of frame 0; a
+  // box given by the file replaces the one in the panel.
+  auto adoptScene = [&](const LoadedScene& loaded) {
+    g_cam.target = loaded.center;
+    analysis.center[0] = loaded.center.x;
+    analysis.center[1] = loaded.center.y;
+    analysis.center[2] = loaded.center.z;
+    if (loaded.periodic) {
+      periodicBonds = true;
+      std::copy(loaded.box, loaded.box + 3, bondBox);
+      rdf.setBox(bondBox[0], bondBox[1], bondBox[2]);
+      std::cout << "Periodic box " << bondBox[0] << " x " << bondBox[1] << " x "
+                << bondBox[2] << " A\n";
+    }
+    analysisChanged = true;
+  };
+  adoptScene(scene);
+  g_cam.distance = 30.0f; // tweak
 
-  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-  glBufferSubData(GL_ARRAY_BUFFER,
-                  0,
-                  instances.size() * sizeof(Instance),
-                  instances.data()
-                  );
-
+  // Playback follows wall-clock time at clock.rate frames per second, over
+  // the whole trajectory or, in GPU playback, over the window of frames held
+  // in a texture buffer. playTime is the clock's position in that window.
+  PlaybackClock clock;
+  clock.setRange(0, pipeline->frameCount());
+  clock.play(glfwGetTime());
+  GpuTrajectory gpuTrajectory;
+  bool gpuPlayback = false;
+  // The window is decoded and quantized on a worker; playback switches to
+  // the GPU once it is uploaded.
+  std::future<QuantizedFrames> gpuJob;
+  double playTime = 0.0;
+  const size_t gpuBudgetBytes = size_t(64) << 20;
+  GLint maxTexels = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+
+  SceneViews views;
+  views.reset(pipeline, g_cam.target);
+
+  // step is the frame that should be on screen, shownFrame the one that is.
   size_t step = 0;
+  size_t shownFrame = 0;
+  double prepareMs = 0.0;
+  double timeToFirstFrameMs = -1.0;
   double lastTime = glfwGetTime();
   int frameCount = 0;
 
+  if (headless) {
+    renderLast = std::min(renderLast, pipeline->frameCount() - 1);
+    step = std::min(renderFirst, renderLast);
+    std::cout << "Rendering frames " << step << "-" << renderLast << " at "
+              << renderWidth << "x" << renderHeight << " to " << renderDir << "\n";
+  }
+
   while (glfwWindowShouldClose(window) == 0) {
+    profiler.beginFrame();
+
+    // ---------- Swap in a finished load ----------
+    // Everything heavy was built by the loader; this is moves and resets.
+    if (std::unique_ptr<LoadedScene> loaded = loader.poll()) {
+      if (gpuPlayback) {
+        gpuTrajectory.release();
+        gpuPlayback = false;
+      }
+      retire(gpuJob);
+      std::shared_ptr<FramePipeline> old = std::move(pipeline);
+      pipeline = std::make_shared<FramePipeline>(std::move(loaded->source), loaded->mol);
+      pipeline->configure(analysis);
+      views.reset(pipeline, loaded->center);
+      retiring.push_back(std::async(std::launch::async,
+                                    [old = std::move(old)]() mutable { old.reset(); }));
+      path = loaded->path;
+      mol = std::move(loaded->mol);
+      step = 0;
+      shownFrame = 0;
+      playTime = 0.0;
+      clock.setRange(0, pipeline->frameCount());
+      clock.seek(0);
+      clock.resetPacing();
+
+      const size_t streamAtoms = std::min<size_t>(mol.size(), kOctreeAtoms);
+      if (mol.size() > kOctreeAtoms) {
+        spheres.mode = SphereOctree;
+      } else if (spheres.mode == SphereOctree) {
+        spheres.mode = SphereMeshLod;
+      }
+      spheres.replaceInstances(std::move(loaded->instances), std::move(loaded->octree), streamAtoms);
+      picker.reset(std::move(loaded->bvh));
+
+      bondInstances.clear();
+      bondStats = {};
+      bondsDirty = true;
+      hbondSegments.clear();
+      hbondStats = {};
+      hbondHistory.clear();
+      hbondsDirty = true;
+      rdf.reset(pipeline->frameCount());
+
+      adoptScene(*loaded);
+      std::cout << "Loaded " << path << ": " << mol.size() << " atoms, "
+                << pipeline->frameCount() << " frames\n";
+    }
+    std::erase_if(retiring, [](std::future<void>& f) {
+      return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+    if (headless) {
+      offscreen->bind();
+    }
     glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // ---------- ImGui begin frame (MUST be before any ImGui calls) ----------
+    profiler.beginCpu("ImGui build");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     if (ImGui::BeginMainMenuBar()) {
       if (ImGui::BeginMenu("File")) {
         if (ImGui::MenuItem("Open...", "Ctrl+O")) {
-          
+          openRequested = true;
         }
         if (ImGui::MenuItem("Save Screenshot", "Ctrl+S")) {
-          
+          screenshotRequested = true;
         }
         ImGui::Separator();
         if (ImGui::MenuItem("Quit", "Alt+F4")) {
@@ -591,13 +525,60 @@ auto main() -> int {
         }
         ImGui::EndMenu();
       }
+      if (ImGui::BeginMenu("View")) {
+        ImGui::MenuItem("Profiler", nullptr, &showProfiler);
+        ImGui::MenuItem("Radial distribution", nullptr, &rdf.open);
+        ImGui::Separator();
+        if (ImGui::MenuItem("New view", nullptr, false, !headless)) {
+          views.add(g_cam, (int)step);
+        }
+        ImGui::EndMenu();
+      }
 
       ImGui::EndMainMenuBar();
     }
 
+    if (!headless && !io.WantCaptureKeyboard && io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_O, false)) {
+      openRequested = true;
+    }
+    if (openRequested) {
+      openRequested = false;
+      openListing = listFiles();
+      std::snprintf(openPath, sizeof(openPath), "%s", path.c_str());
+      ImGui::OpenPopup("Open file");
+    }
+    if (ImGui::BeginPopupModal("Open file", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+      bool open = ImGui::InputText("Path", openPath, sizeof(openPath),
+                                   ImGuiInputTextFlags_EnterReturnsTrue);
+      ImGui::TextDisabled("XYZ, PDB, binary trajectory, or DCD / XTC with a PDB of the same name");
+      if (ImGui::BeginListBox("##files", ImVec2(500, 200))) {
+        for (const std::string& name : openListing) {
+          if (ImGui::Selectable(name.c_str(), name == openPath,
+                                ImGuiSelectableFlags_AllowDoubleClick)) {
+            std::snprintf(openPath, sizeof(openPath), "%s", name.c_str());
+            open |= ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left);
+          }
+        }
+        ImGui::EndListBox();
+      }
+      open |= ImGui::Button("Open");
+      ImGui::SameLine();
+      if (ImGui::Button("Cancel")) {
+        ImGui::CloseCurrentPopup();
+      }
+      if (open && openPath[0] != '\0') {
+        loader.start(openPath, kOctreeAtoms);
+        ImGui::CloseCurrentPopup();
+      }
+      ImGui::EndPopup();
+    }
+
     static bool dragging = false;
     static double lastX = 0.0, lastY = 0.0;
+    static double pressX = 0.0, pressY = 0.0;
 
+    // A press and release without moving selects the atom under the cursor.
+    bool clicked = false;
     if (!io.WantCaptureMouse) {
       if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
         double x, y;
@@ -607,6 +588,8 @@ auto main() -> int {
           dragging = true;
           lastX = x;
           lastY = y;
+          pressX = x;
+          pressY = y;
         } else {
           float dx = float(x - lastX);
           float dy = float(y - lastY);
@@ -621,6 +604,9 @@ auto main() -> int {
           g_cam.pitch = glm::clamp(g_cam.pitch, -limit, limit);
         }
       } else {
+        if (dragging && std::abs(lastX - pressX) + std::abs(lastY - pressY) < 4.0) {
+          clicked = true;
+        }
         dragging = false;
       }
     }
@@ -671,56 +657,438 @@ auto main() -> int {
     // ---------- Your docked windows ----------
     ImGui::Begin("LeftPanel");
     ImGui::Text("Controls go here");
+    if (loader.busy()) {
+      const LoadProgress& progress = loader.progress();
+      ImGui::Text("Loading %s", loader.path().c_str());
+      ImGui::ProgressBar(progress.fraction(), ImVec2(-1.0f, 0.0f), progress.stage.load());
+      if (ImGui::Button("Cancel loading")) {
+        loader.cancel();
+      }
+    } else if (!loader.error().empty()) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Open failed: %s", loader.error().c_str());
+    }
     ImGui::Text("Step: %zu", step);
+    ImGui::Text("Time to first frame: %.1f ms", timeToFirstFrameMs);
+    int scrub = (int)step;
+    if (ImGui::SliderInt("Frame", &scrub, 0, (int)pipeline->frameCount() - 1)) {
+      // GPU playback stays within its window
+      clock.seek((size_t)scrub);
+      step = clock.frame();
+    }
+    bool playing = clock.playing();
+    if (ImGui::Checkbox("Play", &playing)) {
+      if (playing) {
+        clock.play(glfwGetTime());
+      } else {
+        clock.pause();
+      }
+    }
+    ImGui::SliderFloat("Rate (frames/s)", &clock.rate, 0.1f, 240.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+    bool gpuRequested = gpuPlayback || gpuJob.valid();
+    if (ImGui::Checkbox("GPU playback", &gpuRequested)) {
+      if (gpuRequested) {
+        // Fetched through the pipeline's streamer, which keeps its position;
+        // like a pin job, the worker drops its pipeline reference itself.
+        size_t atoms = std::max<size_t>(mol.size(), 1);
+        size_t window = gpuBudgetBytes / (atoms * 4 * sizeof(uint16_t));
+        window = std::min(window, (size_t)maxTexels / atoms);
+        gpuJob = std::async(std::launch::async, [shared = pipeline, first = step,
+                                                 count = std::max<size_t>(window, 1)]() mutable {
+          std::shared_ptr<FramePipeline> frames = std::move(shared);
+          return quantizeFrames(*frames, first, count);
+        });
+      } else if (gpuJob.valid()) {
+        retire(gpuJob);
+      } else {
+        gpuPlayback = false;
+        clock.setRange(0, pipeline->frameCount());
+        step = clock.frame();
+        gpuTrajectory.release();
+        views.repin();
+      }
+    }
+    if (gpuJob.valid()) {
+      if (gpuJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        try {
+          gpuTrajectory.upload(gpuJob.get());
+          gpuPlayback = true;
+          clock.setRange(gpuTrajectory.first(), gpuTrajectory.frameCount());
+          clock.seek(step);
+          playTime = 0.0;
+        } catch (const std::exception& e) {
+          std::cerr << "GPU playback: " << e.what();
+        }
+      } else {
+        ImGui::TextDisabled("Preparing the GPU window...");
+      }
+    }
+    if (gpuPlayback) {
+      ImGui::Text("Window: %zu frames from %zu (%.1f MB)", gpuTrajectory.frameCount(),
+                  gpuTrajectory.first(), gpuTrajectory.bytes() / 1048576.0);
+    }
+    PlaybackClock::Pacing pacing = clock.pacing();
+    ImGui::Text("Shown: %zu  Skipped: %zu  Late: %zu", pacing.presented, pacing.skipped,
+                pacing.late);
+    ImGui::Text("Interval: %.1f ms (p95 %.1f, max %.1f, jitter %.1f)", pacing.meanMs,
+                pacing.p95Ms, pacing.maxMs, pacing.jitterMs);
+    if (!clock.intervals().empty()) {
+      ImGui::PlotLines("Interval (ms)", clock.intervals().data(), (int)clock.intervals().size(),
+                       0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+    }
+    if (!gpuPlayback) {
+      ImGui::Text("Prepare: %.2f ms per frame (worker)", prepareMs);
+    }
+    ImGui::Separator();
+    const char* sphereModes[] = {"Mesh (LOD)", "Impostor", "Octree (large systems)"};
+    ImGui::Combo("Spheres", &spheres.mode, sphereModes, 3);
+    if (spheres.mode == SphereMeshLod) {
+      ImGui::SliderFloat("LOD bias", &spheres.lodBias, 0.25f, 4.0f);
+      for (size_t l = 0; l < kSphereLodCount; l++) {
+        ImGui::Text("LOD %zu (%dx%d): %zu", l, kSphereLods[l].sectors,
+                    kSphereLods[l].stacks, spheres.buckets().count[l]);
+      }
+    } else if (spheres.mode == SphereOctree) {
+      ImGui::SliderFloat("LOD bias", &spheres.lodBias, 0.25f, 4.0f);
+      ImGui::SliderFloat("Aggregate below (px)", &spheres.aggregatePixels, 0.5f, 16.0f);
+      ImGui::SliderFloat("Spheres above (px)", &spheres.spherePixels, 1.0f, 32.0f);
+      const OctreeSelection& sel = spheres.octreeSelection();
+      ImGui::Text("Nodes: %zu visited of %zu", sel.nodesVisited, spheres.atomOctree().nodeCount());
+      ImGui::Text("Spheres: %zu  Points: %zu in %zu ranges", sel.spheres.size(), sel.points,
+                  sel.pointFirst.size());
+      ImGui::Text("Aggregates: %zu", sel.aggregates.size());
+      if (gpuPlayback) {
+        ImGui::TextDisabled("GPU playback draws impostors");
+      }
+    }
+    ImGui::Checkbox("Frustum culling", &spheres.frustumCulling);
+    ImGui::Text("Drawn: %zu  Culled: %zu", spheres.drawnCount(),
+                spheres.atomCount() - spheres.drawnCount());
+    ImGui::Text("Triangles/frame: %.3fM", trianglesPerFrame / 1.0e6);
+    const char* uploadModes[] = {"Orphan", "Fenced ring", "Persistent"};
+    int uploadMode = spheres.uploadMode();
+    if (ImGui::Combo("Upload", &uploadMode, uploadModes, 3)) {
+      spheres.setUploadMode((StreamBuffer::Mode)uploadMode);
+    }
+    ImGui::Text("Upload: %.1f KB/frame, %.3f ms", spheres.uploadBytes() / 1024.0, spheres.uploadMs());
+    ImGui::Separator();
+    analysisChanged |= ImGui::Checkbox("Bonds", &showBonds);
+    if (gpuPlayback) {
+      ImGui::TextDisabled("Bonds are hidden during GPU playback");
+    }
+    ImGui::SliderFloat("Bond radius", &bondRenderer.radius, 0.02f, 0.3f);
+    bool boxChanged = ImGui::Checkbox("Periodic box", &periodicBonds);
+    if (periodicBonds) {
+      boxChanged |= ImGui::InputFloat3("Box (A)", bondBox);
+      analysisChanged |= ImGui::Checkbox("Make molecules whole", &imagePeriodic);
+      if (imagePeriodic) {
+        ImGui::Checkbox("Recenter on selection", &recenterOnSelection);
+        if (gpuPlayback) {
+          ImGui::TextDisabled("GPU playback shows the stored coordinates");
+        }
+      }
+    }
+    if (boxChanged) {
+      if (periodicBonds) {
+        rdf.setBox(bondBox[0], bondBox[1], bondBox[2]);
+      } else {
+        rdf.setBox(0.0f, 0.0f, 0.0f);
+      }
+      analysisChanged = true;
+      hbondHistory.clear();
+    }
+    ImGui::Text("Bonds: %zu (%zu/%zu cells updated)", bondStats.bonds,
+                bondStats.cellsRecomputed, bondStats.cells);
+    ImGui::Separator();
+    analysisChanged |= ImGui::Checkbox("Hydrogen bonds", &showHBonds);
+    if (showHBonds) {
+      bool criteriaChanged = ImGui::SliderFloat("D-A distance (A)", &analysis.hbondDistance, 2.5f, 4.0f);
+      criteriaChanged |= ImGui::SliderFloat("H-D-A angle (deg)", &analysis.hbondAngle, 10.0f, 60.0f);
+      criteriaChanged |= ImGui::SliderFloat("List skin (A)", &analysis.hbondSkin, 0.0f, 2.0f);
+      if (criteriaChanged) {
+        hbondHistory.clear();
+        analysisChanged = true;
+      }
+      const HBondStats& hs = hbondStats;
+      ImGui::Text("H-bonds: %zu (%.2f per N/O/F)", hs.bonds,
+                  hs.acceptors ? (double)hs.bonds / (double)hs.acceptors : 0.0);
+      ImGui::Text("Formed: %zu  Broken: %zu", hs.formed, hs.broken);
+      ImGui::Text("Mean lifetime: %.2f frames (%zu ended)", hs.meanLifetime,
+                  hs.lifetimesRecorded);
+      if (hs.lifetimeResolution > 1 || hs.trackingRestarts > 0) {
+        ImGui::TextDisabled("Sampled every %zu frames or less; restarted %zu times by seeking",
+                            hs.lifetimeResolution, hs.trackingRestarts);
+      }
+      ImGui::Text("List rebuilds: %zu of %zu frames", hs.listRebuilds, hs.framesProcessed);
+      if (!hbondHistory.empty()) {
+        ImGui::PlotLines("Count", hbondHistory.data(), (int)hbondHistory.size(), 0, nullptr,
+                         0.0f, FLT_MAX, ImVec2(0, 60));
+      }
+    }
+    ImGui::Separator();
+    auto atomInfo = [&](const char* label, uint32_t atom) {
+      if (atom >= mol.size()) {
+        ImGui::Text("%s: none", label);
+        return;
+      }
+      std::string_view sym = mol.symbol(atom);
+      ImGui::Text("%s: %.*s #%u (%.3f, %.3f, %.3f)", label, (int)sym.size(), sym.data(),
+                  atom, mol.x[atom], mol.y[atom], mol.z[atom]);
+    };
+    atomInfo("Hovered", picker.hovered);
+    atomInfo("Selected", picker.selected);
+    if (picker.selected < mol.size()) {
+      const uint32_t selected = picker.selected;
+      glm::vec3 p(mol.x[selected], mol.y[selected], mol.z[selected]);
+      auto dist = [&](uint32_t i) {
+        return glm::length(glm::vec3(mol.x[i], mol.y[i], mol.z[i]) - p);
+      };
+      picker.neighbors(spheres.instances(), selected, 3.5f, neighbors);
+      ImGui::Text("Neighbors within 3.5 A: %zu", neighbors.size());
+      for (size_t k = 0; k < std::min<size_t>(neighbors.size(), 8); k++) {
+        std::string_view sym = mol.symbol(neighbors[k]);
+        ImGui::Text("  %.*s #%u: %.3f A", (int)sym.size(), sym.data(), neighbors[k],
+                    dist(neighbors[k]));
+      }
+      if (ImGui::Button("Clear selection")) {
+        picker.selected = AtomPicker::kNone;
+      }
+    }
     ImGui::End();
 
+    if (showProfiler) {
+      profiler.drawWindow(&showProfiler);
+    }
+
+    rdf.draw();
+    views.update(gpuPlayback);
+    // GPU playback can only show frames of its window
+    int viewFirst = gpuPlayback ? (int)gpuTrajectory.first() : 0;
+    int viewLast = gpuPlayback ? viewFirst + (int)gpuTrajectory.frameCount() - 1
+                               : (int)pipeline->frameCount() - 1;
+    views.drawWindows(gpuPlayback, viewFirst, viewLast);
+    profiler.endCpu();
+
     // ---------- Your OpenGL draw ----------
     glEnable(GL_DEPTH_TEST);
 
 
     
 
-    glUseProgram(program);
-
     int w, h;
-    glfwGetFramebufferSize(window, &w, &h);
+    if (headless) {
+      w = offscreen->width();
+      h = offscreen->height();
+    } else {
+      glfwGetFramebufferSize(window, &w, &h);
+    }
     float aspect = (h > 0) ? (float)w / (float)h : 1.0f;
 
     glm::mat4 view = g_cam.view();
     glm::mat4 proj = g_cam.projection(aspect);
 
-    glUniformMatrix4fv(
-      glGetUniformLocation(program, "uView"),
-      1, GL_FALSE, glm::value_ptr(view)
-    );
 
-    glUniformMatrix4fv(
-      glGetUniformLocation(program, "uProj"),
-      1, GL_FALSE, glm::value_ptr(proj)
-    );
+    // ---------- Playback ----------
+    // The clock says which frame belongs on screen; the pipeline prepares it
+    // on its workers, and whichever packet finished last is swapped in here.
+    // Until one has, the previous frame stays up. Batch rendering ignores the
+    // clock and waits for every frame in turn.
+    uint32_t recenterAtom = PeriodicImager::kNone;
+    if (periodicBonds && imagePeriodic && recenterOnSelection && picker.selected < mol.size()) {
+      recenterAtom = picker.selected;
+    }
+    analysisChanged |= recenterAtom != analysis.recenterAtom;
+    if (analysisChanged) {
+      analysis.bonds = showBonds;
+      analysis.hbonds = showHBonds;
+      for (int a = 0; a < 3; a++) {
+        analysis.box[a] = periodicBonds ? bondBox[a] : 0.0f;
+      }
+      analysis.image = periodicBonds && imagePeriodic;
+      analysis.recenterAtom = recenterAtom;
+      pipeline->configure(analysis);
+      analysisChanged = false;
+    }
 
+    double now = glfwGetTime();
+    bool presented = false;
+    if (!headless) {
+      clock.tick(now);
+      step = clock.frame();
+    }
+    if (gpuPlayback) {
+      playTime = clock.position() - (double)gpuTrajectory.first();
+      clock.present(step, now);
+    } else {
+      pipeline->request(step);
+      if (std::unique_ptr<FramePacket> packet = pipeline->take()) {
+        shownFrame = packet->frame;
+        spheres.swapInstances(packet->instances);
+        std::swap(mol, packet->mol);
+        if (packet->hasBonds) {
+          bondInstances.swap(packet->bonds);
+          bondStats = packet->bondStats;
+          bondsDirty = true;
+        }
+        if (packet->hasHBonds) {
+          hbondSegments.swap(packet->hbonds);
+          hbondStats = packet->hbondStats;
+          if (hbondHistory.size() == 256) {
+            hbondHistory.erase(hbondHistory.begin());
+          }
+          hbondHistory.push_back((float)hbondStats.bonds);
+          hbondsDirty = true;
+        }
+        prepareMs = packet->prepareMs;
+        picker.moved();
+        presented = true;
+        clock.present(shownFrame, now);
+        pipeline->recycle(std::move(packet));
+      }
+    }
 
-    glBindVertexArray(VAO);
+    // ---------- RDF ----------
+    rdf.poll();
+    if (presented) {
+      rdf.offer(shownFrame, mol);
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    0,
-                    steps[step].size() * sizeof(Instance),
-                    steps[step].data());
+    // ---------- Picking ----------
+    // During GPU playback this picks against the last CPU frame.
+    bool hoverScene = !headless && !io.WantCaptureMouse;
+    picker.hovered = AtomPicker::kNone;
+    if (hoverScene) {
+      CpuScope scope(profiler, "Picking");
+      double mx, my;
+      int ww, wh;
+      glfwGetCursorPos(window, &mx, &my);
+      glfwGetWindowSize(window, &ww, &wh);
+      float ndcX = 2.0f * float(mx) / float(std::max(ww, 1)) - 1.0f;
+      float ndcY = 1.0f - 2.0f * float(my) / float(std::max(wh, 1));
+      picker.hovered = picker.pick(spheres.instances(), proj * view, ndcX, ndcY);
+      if (clicked) {
+        picker.selected = picker.hovered;
+      }
+    }
+    spheres.setHighlight(picker.selected == AtomPicker::kNone ? SphereRenderer::kNoHighlight
+                                                              : picker.selected);
+
+    if (queryIssued[queryIndex]) {
+      GLuint available = 0;
+      glGetQueryObjectuiv(primitiveQueries[queryIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available) {
+        glGetQueryObjectui64v(primitiveQueries[queryIndex], GL_QUERY_RESULT, &trianglesPerFrame);
+      }
+    }
+    glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[queryIndex]);
+
+    spheres.setGpuTrajectory(gpuPlayback ? &gpuTrajectory : nullptr, playTime);
+    camera.update(view, proj, h);
+    spheres.setView(view, proj, h, g_cam.distance);
+    spheres.prepare(&profiler);
+
+    profiler.beginCpu("Spheres");
+    profiler.beginGpu("Spheres");
+    spheres.draw();
+    profiler.endGpu();
+    profiler.endCpu();
+
+    // Bond perception needs CPU positions, which GPU playback never produces.
+    if (showBonds && !gpuPlayback) {
+      if (bondsDirty) {
+        CpuScope scope(profiler, "Bond upload");
+        bondRenderer.uploadBonds(bondInstances);
+        bondsDirty = false;
+      }
 
-    glDrawElementsInstanced(GL_TRIANGLES,
-                            (GLsizei)sphere.indices.size(),
-                            GL_UNSIGNED_INT,
-                            0,
-                            (GLsizei)mol.atoms.size());
+      profiler.beginGpu("Bonds");
+      bondRenderer.drawBonds();
+      profiler.endGpu();
+    }
+
+    if (showHBonds && !gpuPlayback) {
+      if (hbondsDirty) {
+        CpuScope scope(profiler, "H-bond upload");
+        bondRenderer.uploadHBonds(hbondSegments);
+        hbondsDirty = false;
+      }
+
+      profiler.beginGpu("H-bonds");
+      bondRenderer.drawHBonds();
+      profiler.endGpu();
+    }
+
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    queryIssued[queryIndex] = true;
+    queryIndex ^= 1;
+
+    // ---------- Extra views ----------
+    // After the main view, whose upload views that don't depend on the
+    // camera draw from.
+    if (!views.empty()) {
+      profiler.beginCpu("Views");
+      profiler.beginGpu("Views");
+      views.render(spheres, camera, bondRenderer, showBonds, showHBonds,
+                   gpuPlayback ? &gpuTrajectory : nullptr, playTime);
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glViewport(0, 0, w, h);
+      profiler.endGpu();
+      profiler.endCpu();
+    }
+
+    // ---------- Capture (before the UI is drawn) ----------
+    profiler.beginCpu("Capture");
+    if (headless && presented && shownFrame == step) {
+      char name[32];
+      std::snprintf(name, sizeof(name), "/frame_%06zu.", step);
+      frameCapture.capture(w, h, renderDir + name + renderFormat);
+    }
+    if (!io.WantCaptureKeyboard && io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S, false)) {
+      screenshotRequested = true;
+    }
+    if (screenshotRequested && !headless) {
+      char name[64];
+      std::time_t now = std::time(nullptr);
+      std::strftime(name, sizeof(name), "screenshot-%Y%m%d-%H%M%S.png", std::localtime(&now));
+      glReadBuffer(GL_BACK);
+      frameCapture.capture(w, h, name);
+      std::cout << "Saving " << name << "\n";
+      screenshotRequested = false;
+    }
+    frameCapture.poll();
+    profiler.endCpu();
 
     // ---------- Render ImGui on top ----------
+    profiler.beginCpu("ImGui render");
+    profiler.beginGpu("ImGui render");
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (!headless) {
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+    // windows dragged out of the main one, each with its own context
+    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+      GLFWwindow* context = glfwGetCurrentContext();
+      ImGui::UpdatePlatformWindows();
+      ImGui::RenderPlatformWindowsDefault();
+      glfwMakeContextCurrent(context);
+    }
+    profiler.endGpu();
+    profiler.endCpu();
 
     // ---------- Events / swap ----------
+    profiler.beginCpu("Swap");
     glfwPollEvents();
-    glfwSwapBuffers(window);
+    if (!headless) {
+      glfwSwapBuffers(window);
+    }
+    profiler.endCpu();
+
+    // Counted up to the swap that first shows a frame from the pipeline, so it
+    // covers loading, the first decode and the first analysis.
+    if (timeToFirstFrameMs < 0.0 && presented) {
+      timeToFirstFrameMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+      std::cout << "Time to first frame: " << timeToFirstFrameMs << " ms\n";
+    }
 
     // ---------- FPS + RAM (once per second) ----------
     frameCount++;
@@ -735,11 +1103,46 @@ auto main() -> int {
       lastTime = currentTime;
     }
 
-    step = (step + 1) % steps.size();
+    // Frames that are not prepared yet are simply waited for next iteration,
+    // unless the trajectory failed and they never will be.
+    if (headless && !pipeline->error().empty()) {
+      glfwSetWindowShouldClose(window, 1);
+    } else if (headless && presented && shownFrame == step) {
+      if (step >= renderLast) {
+        glfwSetWindowShouldClose(window, 1);
+      } else {
+        step++;
+      }
+    }
+    profiler.endFrame();
   }
 
+  frameCapture.release();
+  if (headless) {
+    std::cout << "Wrote " << frameCapture.written() << " images\n";
+  }
+  int status = 0;
+  if (!frameCapture.error().empty()) {
+    std::cerr << "Capture error: " << frameCapture.error();
+    status = 1;
+  }
+
+  if (!pipeline->error().empty()) {
+    std::cerr << "Trajectory error: " << pipeline->error();
+    status = 1;
+  }
+
+  // GL objects owned by these must go before the context does.
+  offscreen.reset();
+  profiler.release();
+  gpuTrajectory.release();
+  views.release();
+  bondRenderer.release();
+  spheres.release();
+  camera.release();
+
   glViewport(0, 0, 800, 600);
 
   glfwTerminate();
-  return 0;
+  return status;
 }
@@ -0,0 +1,37 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + filename + "\n");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Failed to stat file: " + filename + "\n");
+  }
+  length = (size_t)st.st_size;
+
+  if (length > 0) {
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Failed to map file: " + filename + "\n");
+    }
+    bytes = static_cast<const char*>(p);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (bytes != nullptr) {
+    munmap(const_cast<char*>(bytes), length);
+  }
+}
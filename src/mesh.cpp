@@ -0,0 +1,92 @@
+#include "mesh.hpp"
+
+#include <cmath>
+
+Mesh createSphere(float radius, int sectorCount, int stackCount) {
+  Mesh mesh;
+  const float pi = M_PI;
+
+  float x, y, z, xy;
+  float sectorStep = 2 * pi / sectorCount;
+  float stackStep = pi / stackCount;
+  float sectorAngle, stackAngle;
+
+  for (int i = 0; i <= stackCount; i++) {
+    stackAngle = pi / 2 - i * stackStep;
+    xy = radius * cosf(stackAngle);
+    y = radius * sinf(stackAngle);
+
+    for (int j = 0; j <= sectorCount; j++) {
+      sectorAngle = j * sectorStep;
+
+      x = xy * cosf(sectorAngle);
+      z = xy * sinf(sectorAngle);
+
+      mesh.vertices.push_back(x);
+      mesh.vertices.push_back(y);
+      mesh.vertices.push_back(z);
+
+      mesh.vertices.push_back(x / radius);
+      mesh.vertices.push_back(y / radius);
+      mesh.vertices.push_back(z / radius);
+    }
+  }
+
+  int k1, k2;
+  for (int i = 0; i < stackCount; i++) {
+    k1 = i * (sectorCount + 1);
+    k2 = k1 + sectorCount + 1;
+
+    for (int j = 0; j < sectorCount; j++, k1++, k2++) {
+      if (i != 0) {
+        mesh.indices.push_back(k1);
+        mesh.indices.push_back(k2);
+        mesh.indices.push_back(k1 + 1);
+      }
+
+      if (i != (stackCount - 1)) {
+        mesh.indices.push_back(k1 + 1);
+        mesh.indices.push_back(k2);
+        mesh.indices.push_back(k2 + 1);
+      }
+    }
+  }
+
+  return mesh;
+}
+
+Mesh createCylinder(int sectorCount) {
+  Mesh mesh;
+  const float pi = M_PI;
+  float sectorStep = 2 * pi / sectorCount;
+
+  for (int i = 0; i <= 1; i++) {
+    for (int j = 0; j <= sectorCount; j++) {
+      float sectorAngle = j * sectorStep;
+      float x = cosf(sectorAngle);
+      float z = sinf(sectorAngle);
+
+      mesh.vertices.push_back(x);
+      mesh.vertices.push_back((float)i);
+      mesh.vertices.push_back(z);
+
+      mesh.vertices.push_back(x);
+      mesh.vertices.push_back(0.0f);
+      mesh.vertices.push_back(z);
+    }
+  }
+
+  for (int j = 0; j < sectorCount; j++) {
+    unsigned int k1 = j;
+    unsigned int k2 = j + sectorCount + 1;
+    mesh.indices.push_back(k1);
+    mesh.indices.push_back(k1 + 1);
+    mesh.indices.push_back(k2);
+
+    mesh.indices.push_back(k1 + 1);
+    mesh.indices.push_back(k2 + 1);
+    mesh.indices.push_back(k2);
+  }
+
+  return mesh;
+}
@@ -0,0 +1,82 @@
+#include "molecule.hpp"
+
+#include <charconv>
+#include <iostream>
+#include <stdexcept>
+
+#include "elements.hpp"
+#include "mapped_file.hpp"
+#include "xyz_parser.hpp"
+
+void Molecule::resize(size_t n) {
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  atomicNumbers.resize(n);
+}
+
+void Molecule::addAtom(int atomicNumber, float ax, float ay, float az) {
+  x.push_back(ax);
+  y.push_back(ay);
+  z.push_back(az);
+  atomicNumbers.push_back((uint8_t)atomicNumber);
+}
+
+std::string_view Molecule::symbol(size_t i) const {
+  return kElements[atomicNumbers[i]].symbol;
+}
+
+void Molecule::setPositions(std::span<const Instance> frame) {
+  for (size_t i = 0; i < frame.size(); i++) {
+    x[i] = frame[i].x;
+    y[i] = frame[i].y;
+    z[i] = frame[i].z;
+  }
+}
+
+int atomicNumber(std::string_view element) {
+  int z = elementFromSymbol(element);
+  if (z == 0 && !element.empty() && element[0] >= '0' && element[0] <= '9') {
+    // some writers emit the atomic number instead of the symbol
+    auto [ptr, ec] = std::from_chars(element.data(), element.data() + element.size(), z);
+    if (ec != std::errc() || ptr != element.data() + element.size() || z > kMaxAtomicNumber) {
+      z = 0;
+    }
+  }
+  if (z == 0) {
+    std::cerr << "Unknown atom: " << element << "\n";
+    throw std::runtime_error("Unknown atom: " + std::string(element) + "\n");
+  }
+  return z;
+}
+
+const char* elementSymbol(int atomicNumber) {
+  if (atomicNumber < 0 || atomicNumber > kMaxAtomicNumber) {
+    atomicNumber = 0;
+  }
+  return kElements[(size_t)atomicNumber].symbol;
+}
+
+Molecule read_xyz(std::string filename) {
+  MappedFile file(filename);
+
+  // Only the first frame is read; trajectories are streamed by XyzTrajectory.
+  size_t natoms = 0;
+  std::vector<size_t> offsets = indexXyzFrames(file.data(), file.size(), natoms, 1);
+
+  Molecule mol;
+  parseXyzFrame(file.data(), file.size(), offsets[0], natoms, mol);
+  return mol;
+}
+
+void toDraw(const Molecule& mol, std::span<Instance> out) {
+  const float* x = mol.x.data();
+  const float* y = mol.y.data();
+  const float* z = mol.z.data();
+  const uint8_t* elements = mol.atomicNumbers.data();
+
+  for (size_t i = 0; i < out.size(); i++) {
+    const ElementStyle& s = kElementStyles[elements[i]];
+    out[i] = {x[i], y[i], z[i], s.radius, s.r, s.g, s.b};
+  }
+}
@@ -0,0 +1,275 @@
+#include "octree.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// Round-to-nearest float to IEEE half for positive radii; values too small
+// for a normal half flush to zero and values too large clamp.
+static uint16_t toHalf(float f) {
+  uint32_t bits = std::bit_cast<uint32_t>(f);
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  int exponent = (int)((bits >> 23) & 0xffu) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffffu;
+  if (exponent <= 0) {
+    return (uint16_t)sign;
+  }
+  if (exponent >= 31) {
+    return (uint16_t)(sign | 0x7bffu);
+  }
+  // a carry out of the mantissa correctly bumps the exponent
+  return (uint16_t)(sign | (((uint32_t)exponent << 10) + ((mantissa + 0x1000u) >> 13)));
+}
+
+static uint8_t toUnorm8(float v) {
+  return (uint8_t)(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Spreads the low 10 bits of v so there are two zero bits between each.
+static uint32_t spreadBits(uint32_t v) {
+  v = (v | (v << 16)) & 0x030000ffu;
+  v = (v | (v << 8)) & 0x0300f00fu;
+  v = (v | (v << 4)) & 0x030c30c3u;
+  v = (v | (v << 2)) & 0x09249249u;
+  return v;
+}
+
+void OctreeSelection::clear() {
+  pointFirst.clear();
+  pointCount.clear();
+  aggregates.clear();
+  spheres.clear();
+  points = 0;
+  nodesVisited = 0;
+}
+
+PackedInstance AtomOctree::pack(const Instance& a) const {
+  const float p[3] = {a.x, a.y, a.z};
+  uint16_t q[3];
+  for (int k = 0; k < 3; k++) {
+    q[k] = (uint16_t)std::clamp((p[k] - lo[k]) * scale[k] + 0.5f, 0.0f, 65535.0f);
+  }
+  return {q[0], q[1], q[2], toHalf(a.radius), toUnorm8(a.r), toUnorm8(a.g), toUnorm8(a.b), 255};
+}
+
+void AtomOctree::build(std::span<const Instance> atoms) {
+  const size_t n = atoms.size();
+  rebuilds++;
+  nodes.clear();
+  order.resize(n);
+  packedAtoms.resize(n);
+  if (n == 0) {
+    return;
+  }
+
+  // quantization bounds: the atom centres plus a margin for later frames
+  float mn[3], mx[3];
+  for (int k = 0; k < 3; k++) {
+    mn[k] = INFINITY;
+    mx[k] = -INFINITY;
+  }
+  for (const Instance& a : atoms) {
+    const float p[3] = {a.x, a.y, a.z};
+    for (int k = 0; k < 3; k++) {
+      mn[k] = std::min(mn[k], p[k]);
+      mx[k] = std::max(mx[k], p[k]);
+    }
+  }
+  float span = std::max({mx[0] - mn[0], mx[1] - mn[1], mx[2] - mn[2]});
+  float margin = 0.05f * span + 1.0f;
+  for (int k = 0; k < 3; k++) {
+    lo[k] = mn[k] - margin;
+    size[k] = mx[k] - mn[k] + 2.0f * margin;
+    scale[k] = 65535.0f / size[k];
+  }
+
+  // ---------- Morton order ----------
+  // keys are code << 32 | atom, sorted by three 10-bit LSD radix passes
+  std::vector<uint64_t> keys(n), scratch(n);
+  for (size_t i = 0; i < n; i++) {
+    const float p[3] = {atoms[i].x, atoms[i].y, atoms[i].z};
+    uint32_t code = 0;
+    for (int k = 0; k < 3; k++) {
+      uint32_t q = (uint32_t)std::clamp((p[k] - lo[k]) / size[k] * 1024.0f, 0.0f, 1023.0f);
+      code |= spreadBits(q) << k;
+    }
+    keys[i] = (uint64_t)code << 32 | i;
+  }
+  for (int pass = 0; pass < 3; pass++) {
+    const int shift = 32 + 10 * pass;
+    size_t start[1025] = {};
+    for (uint64_t key : keys) {
+      start[((key >> shift) & 1023u) + 1]++;
+    }
+    for (int b = 0; b < 1024; b++) {
+      start[b + 1] += start[b];
+    }
+    for (uint64_t key : keys) {
+      scratch[start[(key >> shift) & 1023u]++] = key;
+    }
+    std::swap(keys, scratch);
+  }
+  for (size_t k = 0; k < n; k++) {
+    order[k] = (uint32_t)keys[k];
+  }
+
+  // ---------- Nodes, breadth first ----------
+  // A node at depth d splits on the d-th octal digit of the code; within its
+  // range the higher digits are equal, so each child is one sorted run.
+  std::vector<uint8_t> depth;
+  nodes.push_back({});
+  nodes[0].first = 0;
+  nodes[0].count = (uint32_t)n;
+  depth.push_back(0);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const uint32_t first = nodes[i].first, end = first + nodes[i].count;
+    const int d = depth[i];
+    if (nodes[i].count <= kLeafSize || d == kMaxDepth) {
+      continue;
+    }
+    const int shift = 32 + 3 * (kMaxDepth - 1 - d);
+    const uint32_t firstChild = (uint32_t)nodes.size();
+    for (uint32_t begin = first; begin < end;) {
+      const uint64_t digit = (keys[begin] >> shift) & 7u;
+      uint32_t stop = (uint32_t)(std::partition_point(
+                                     keys.begin() + begin, keys.begin() + end,
+                                     [&](uint64_t key) { return ((key >> shift) & 7u) <= digit; }) -
+                                 keys.begin());
+      Node child{};
+      child.first = begin;
+      child.count = stop - begin;
+      nodes.push_back(child);
+      depth.push_back((uint8_t)(d + 1));
+      begin = stop;
+    }
+    nodes[i].firstChild = firstChild;
+    nodes[i].childCount = (uint32_t)nodes.size() - firstChild;
+  }
+
+  repack(atoms);
+}
+
+void AtomOctree::refit(std::span<const Instance> atoms) {
+  if (atoms.size() != order.size() || !repack(atoms)) {
+    build(atoms);
+  }
+}
+
+bool AtomOctree::repack(std::span<const Instance> atoms) {
+  const float hi[3] = {lo[0] + size[0], lo[1] + size[1], lo[2] + size[2]};
+  bool inside = true;
+  for (size_t k = 0; k < order.size(); k++) {
+    const Instance& a = atoms[order[k]];
+    inside &= a.x >= lo[0] && a.x <= hi[0] && a.y >= lo[1] && a.y <= hi[1] &&
+              a.z >= lo[2] && a.z <= hi[2];
+    packedAtoms[k] = pack(a);
+  }
+  if (!inside) {
+    return false;
+  }
+
+  // children are stored after their parent, so a reverse sweep is bottom-up
+  for (size_t i = nodes.size(); i-- > 0;) {
+    Node& node = nodes[i];
+    float color[3] = {0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < 3; k++) {
+      node.lo[k] = INFINITY;
+      node.hi[k] = -INFINITY;
+    }
+    node.maxRadius = 0.0f;
+    if (node.childCount == 0) {
+      for (uint32_t k = node.first; k < node.first + node.count; k++) {
+        const Instance& a = atoms[order[k]];
+        const float p[3] = {a.x, a.y, a.z};
+        for (int c = 0; c < 3; c++) {
+          node.lo[c] = std::min(node.lo[c], p[c] - a.radius);
+          node.hi[c] = std::max(node.hi[c], p[c] + a.radius);
+        }
+        node.maxRadius = std::max(node.maxRadius, a.radius);
+        color[0] += a.r;
+        color[1] += a.g;
+        color[2] += a.b;
+      }
+      for (float& c : color) {
+        c /= (float)node.count;
+      }
+    } else {
+      for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+        const Node& child = nodes[c];
+        for (int k = 0; k < 3; k++) {
+          node.lo[k] = std::min(node.lo[k], child.lo[k]);
+          node.hi[k] = std::max(node.hi[k], child.hi[k]);
+        }
+        node.maxRadius = std::max(node.maxRadius, child.maxRadius);
+        float weight = (float)child.count / (float)node.count;
+        color[0] += weight * (float)child.aggregate.r / 255.0f;
+        color[1] += weight * (float)child.aggregate.g / 255.0f;
+        color[2] += weight * (float)child.aggregate.b / 255.0f;
+      }
+    }
+    // the sprite covers the node's bounds, in its mean color
+    float radius = 0.5f * std::max({node.hi[0] - node.lo[0], node.hi[1] - node.lo[1],
+                                    node.hi[2] - node.lo[2]});
+    node.aggregate = pack({0.5f * (node.lo[0] + node.hi[0]), 0.5f * (node.lo[1] + node.hi[1]),
+                           0.5f * (node.lo[2] + node.hi[2]), radius, color[0], color[1], color[2]});
+  }
+  return true;
+}
+
+void AtomOctree::select(std::span<const Instance> atoms, const OctreeQuery& query,
+                        OctreeSelection& out) const {
+  out.clear();
+  if (nodes.empty()) {
+    return;
+  }
+  const Frustum& f = query.frustum;
+  // at most 8 children are pushed per level
+  uint32_t stack[8 * (kMaxDepth + 1) + 1];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = nodes[stack[--top]];
+    out.nodesVisited++;
+
+    glm::vec3 center(0.5f * (node.lo[0] + node.hi[0]), 0.5f * (node.lo[1] + node.hi[1]),
+                     0.5f * (node.lo[2] + node.hi[2]));
+    float radius = 0.5f * glm::length(glm::vec3(node.hi[0] - node.lo[0], node.hi[1] - node.lo[1],
+                                                 node.hi[2] - node.lo[2]));
+    if (query.cull) {
+      bool inside = true;
+      for (int p = 0; p < 6; p++) {
+        inside &= f.a[p] * center.x + f.b[p] * center.y + f.c[p] * center.z + f.d[p] > -radius;
+      }
+      if (!inside) {
+        continue;
+      }
+    }
+
+    // distance to the nearest point of the bounding sphere
+    float distance = std::max(glm::length(center - query.eye) - radius, 1e-3f);
+    if (radius * query.pixelScale / distance < query.aggregatePixels) {
+      out.aggregates.push_back(node.aggregate);
+      continue;
+    }
+    if (node.childCount > 0) {
+      // reversed so children pop in Morton order and point ranges merge
+      for (uint32_t c = node.firstChild + node.childCount; c-- > node.firstChild;) {
+        stack[top++] = c;
+      }
+      continue;
+    }
+    if (node.maxRadius * query.pixelScale / distance >= query.spherePixels) {
+      for (uint32_t k = node.first; k < node.first + node.count; k++) {
+        out.spheres.push_back(atoms[order[k]]);
+      }
+    } else if (!out.pointFirst.empty() &&
+               (uint32_t)(out.pointFirst.back() + out.pointCount.back()) == node.first) {
+      out.pointCount.back() += (int32_t)node.count;
+      out.points += node.count;
+    } else {
+      out.pointFirst.push_back((int32_t)node.first);
+      out.pointCount.push_back((int32_t)node.count);
+      out.points += node.count;
+    }
+  }
+}
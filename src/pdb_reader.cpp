@@ -0,0 +1,107 @@
+#include "pdb_reader.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+
+#include "elements.hpp"
+#include "mapped_file.hpp"
+
+bool isPdbFile(const std::string& filename) {
+  std::string ext = std::filesystem::path(filename).extension().string();
+  for (char& c : ext) {
+    c = (char)std::tolower((unsigned char)c);
+  }
+  return ext == ".pdb" || ext == ".ent";
+}
+
+// Fixed-width field [first, first + width) of `line` without its padding;
+// empty if the line is shorter.
+static std::string_view column(std::string_view line, size_t first, size_t width) {
+  if (line.size() <= first) {
+    return {};
+  }
+  std::string_view field = line.substr(first, width);
+  while (!field.empty() && (field.front() == ' ' || field.front() == '\r')) {
+    field.remove_prefix(1);
+  }
+  while (!field.empty() && (field.back() == ' ' || field.back() == '\r')) {
+    field.remove_suffix(1);
+  }
+  return field;
+}
+
+// The atom name is aligned so that a one-letter element sits in column 14:
+// " CA " is an alpha carbon, "CA  " calcium. Digits (hydrogen counts such as
+// "1HB ") are not part of the element. Hydrogen names too long for that
+// alignment ("HG21", "HD11") fill all four columns instead, so they start in
+// column 13 like Hg or Hd would.
+static int elementFromName(std::string_view line) {
+  if (line.size() < 14) {
+    return 0;
+  }
+  char a = line[12], b = line[13];
+  bool letterA = (a >= 'A' && a <= 'Z') || (a >= 'a' && a <= 'z');
+  if (!letterA) {
+    return elementFromSymbol(std::string_view(&line[13], 1));
+  }
+  if ((a == 'H' || a == 'h') && column(line, 12, 4).size() == 4) {
+    return 1;
+  }
+  char pair[2] = {a, b};
+  int z = elementFromSymbol(std::string_view(pair, 2));
+  return z != 0 ? z : elementFromSymbol(std::string_view(&line[12], 1));
+}
+
+Molecule read_pdb(const std::string& filename) {
+  MappedFile file(filename);
+  const char* p = file.data();
+  const char* end = p + file.size();
+
+  Molecule mol;
+  size_t lineNumber = 0;
+  while (p < end) {
+    const void* nl = std::memchr(p, '\n', (size_t)(end - p));
+    const char* next = nl != nullptr ? static_cast<const char*>(nl) + 1 : end;
+    std::string_view line(p, (size_t)(next - p) - (nl != nullptr ? 1 : 0));
+    p = next;
+    lineNumber++;
+
+    if (line.starts_with("ENDMDL") || line.starts_with("END ") || line == "END" ||
+        line.starts_with("END\r")) {
+      break;
+    }
+    if (!line.starts_with("ATOM  ") && !line.starts_with("HETATM")) {
+      continue;
+    }
+
+    float pos[3];
+    for (int k = 0; k < 3; k++) {
+      std::string_view field = column(line, 30 + 8 * (size_t)k, 8);
+      if (field.starts_with('+')) {
+        field.remove_prefix(1);
+      }
+      auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), pos[k]);
+      if (field.empty() || ec != std::errc() || ptr != field.data() + field.size()) {
+        throw std::runtime_error("Bad coordinates on line " + std::to_string(lineNumber) +
+                                 " of " + filename + "\n");
+      }
+    }
+
+    std::string_view element = column(line, 76, 2);
+    int z = element.empty() ? elementFromName(line) : elementFromSymbol(element);
+    if (z == 0) {
+      // fall back to the same lookup (and error) as XYZ files
+      z = atomicNumber(element.empty() ? column(line, 12, 4) : element);
+    }
+    mol.addAtom(z, pos[0], pos[1], pos[2]);
+  }
+
+  if (mol.size() == 0) {
+    throw std::runtime_error("No atoms in PDB file: " + filename + "\n");
+  }
+  return mol;
+}
@@ -0,0 +1,232 @@
+#include "periodic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Below this many atoms a single thread is faster than waking the pool.
+static constexpr size_t kParallelAtoms = size_t(1) << 18;
+
+// Atoms per block of the unwrap; the block's coordinates are still in L1
+// when its instances are written.
+static constexpr size_t kBlock = 1024;
+
+// floor() and round-half-away through truncating int32 conversions, which
+// vectorize without SSE4.1. Coordinates in box lengths stay far inside int32.
+static float floorFast(float t) {
+  float i = (float)(int32_t)t;
+  return i > t ? i - 1.0f : i;
+}
+
+static float roundFast(float t) {
+  return (float)(int32_t)(t + (t < 0.0f ? -0.5f : 0.5f));
+}
+
+void boundsCenter(const Molecule& mol, float center[3]) {
+  const std::span<const float> axes[3] = {mol.xs(), mol.ys(), mol.zs()};
+  for (int a = 0; a < 3; a++) {
+    std::span<const float> v = axes[a];
+    if (v.empty()) {
+      center[a] = 0.0f;
+      continue;
+    }
+    float lo = v[0], hi = v[0];
+    for (float p : v) {
+      lo = std::min(lo, p);
+      hi = std::max(hi, p);
+    }
+    center[a] = 0.5f * (lo + hi);
+  }
+}
+
+bool orthorhombicLengths(const float cell[9], float box[3]) {
+  const float scale = std::max({cell[0], cell[4], cell[8]});
+  if (std::min({cell[0], cell[4], cell[8]}) <= 0.0f) {
+    return false;
+  }
+  // files print the off-diagonal terms as zeros, up to rounding (or the
+  // cosine of a 90 degree angle)
+  for (int k : {1, 2, 3, 5, 6, 7}) {
+    if (std::fabs(cell[k]) > 1e-5f * scale) {
+      return false;
+    }
+  }
+  box[0] = cell[0];
+  box[1] = cell[4];
+  box[2] = cell[8];
+  return true;
+}
+
+PeriodicImager::PeriodicImager(unsigned threads) : pool(threads) {}
+
+void PeriodicImager::setBox(const float lengths[3]) {
+  enabled = lengths[0] > 0.0f && lengths[1] > 0.0f && lengths[2] > 0.0f;
+  for (int a = 0; a < 3; a++) {
+    box[a] = enabled ? lengths[a] : 0.0f;
+    inverse[a] = enabled ? 1.0f / lengths[a] : 0.0f;
+  }
+}
+
+void PeriodicImager::setCenter(const float c[3]) {
+  std::copy(c, c + 3, center);
+}
+
+void PeriodicImager::setMolecules(size_t atomCount, std::span<const Bond> bonds) {
+  // union-find with the smallest index as the representative, so molecules
+  // are numbered in the order of their first atoms
+  std::vector<uint32_t> root(atomCount);
+  std::iota(root.begin(), root.end(), 0u);
+  auto find = [&](uint32_t i) {
+    while (root[i] != i) {
+      root[i] = root[root[i]];
+      i = root[i];
+    }
+    return i;
+  };
+  for (const Bond& b : bonds) {
+    uint32_t ra = find(b.a);
+    uint32_t rb = find(b.b);
+    if (ra < rb) {
+      root[rb] = ra;
+    } else if (rb < ra) {
+      root[ra] = rb;
+    }
+  }
+
+  moleculeOf.resize(atomCount);
+  firstAtom.clear();
+  for (uint32_t i = 0; i < (uint32_t)atomCount; i++) {
+    // a root precedes its atoms, so its molecule is already numbered
+    uint32_t r = root[root[i]];
+    root[i] = r;
+    if (r == i) {
+      moleculeOf[i] = (uint32_t)firstAtom.size();
+      firstAtom.push_back(i);
+    } else {
+      moleculeOf[i] = moleculeOf[r];
+    }
+  }
+  const size_t molecules = firstAtom.size();
+  anchorX.resize(molecules);
+  anchorY.resize(molecules);
+  anchorZ.resize(molecules);
+  placedX.resize(molecules);
+  placedY.resize(molecules);
+  placedZ.resize(molecules);
+  selection.clear();
+}
+
+void PeriodicImager::recenterOn(uint32_t atom) {
+  selection.clear();
+  if (atom >= moleculeOf.size()) {
+    return;
+  }
+  for (uint32_t i = 0; i < (uint32_t)moleculeOf.size(); i++) {
+    if (moleculeOf[i] == moleculeOf[atom]) {
+      selection.push_back(i);
+    }
+  }
+}
+
+void PeriodicImager::selectionCentroid(const Molecule& mol, float out[3]) const {
+  // relative to the first selected atom, so a molecule split by the
+  // boundary still averages to its middle
+  const uint32_t ref = selection[0];
+  const float* axes[3] = {mol.x.data(), mol.y.data(), mol.z.data()};
+  for (int a = 0; a < 3; a++) {
+    const float* p = axes[a];
+    float sum = 0.0f;
+    for (uint32_t i : selection) {
+      float d = p[i] - p[ref];
+      sum += d - box[a] * roundFast(d * inverse[a]);
+    }
+    out[a] = p[ref] + sum / (float)selection.size();
+  }
+}
+
+void PeriodicImager::apply(Molecule& mol, std::span<Instance> out) {
+  const size_t n = mol.size();
+  if (!enabled || n != moleculeOf.size() || n == 0) {
+    return;
+  }
+  float offset[3] = {0.0f, 0.0f, 0.0f};
+  if (!selection.empty()) {
+    float c[3];
+    selectionCentroid(mol, c);
+    for (int a = 0; a < 3; a++) {
+      offset[a] = center[a] - c[a];
+    }
+  }
+  float lo[3];
+  for (int a = 0; a < 3; a++) {
+    lo[a] = center[a] - 0.5f * box[a];
+  }
+
+  const float* x = mol.x.data();
+  const float* y = mol.y.data();
+  const float* z = mol.z.data();
+  const float lx = box[0], ly = box[1], lz = box[2];
+  const float ix = inverse[0], iy = inverse[1], iz = inverse[2];
+
+  // The wrap: each molecule's first atom goes to its image inside the box.
+  auto place = [&](size_t begin, size_t end) {
+    for (size_t m = begin; m < end; m++) {
+      const uint32_t k = firstAtom[m];
+      const float ax = x[k], ay = y[k], az = z[k];
+      const float sx = ax + offset[0], sy = ay + offset[1], sz = az + offset[2];
+      anchorX[m] = ax;
+      anchorY[m] = ay;
+      anchorZ[m] = az;
+      placedX[m] = sx - lx * floorFast((sx - lo[0]) * ix);
+      placedY[m] = sy - ly * floorFast((sy - lo[1]) * iy);
+      placedZ[m] = sz - lz * floorFast((sz - lo[2]) * iz);
+    }
+  };
+
+  // The unwrap: every atom goes to the image nearest its molecule's first
+  // atom, next to where that atom was placed. Instances are copied per block
+  // while it is in cache, so the coordinate loop has no strided stores.
+  auto unwrap = [&, lx, ly, lz, ix, iy, iz](size_t begin, size_t end) {
+    float* __restrict x = mol.x.data();
+    float* __restrict y = mol.y.data();
+    float* __restrict z = mol.z.data();
+    const uint32_t* __restrict molecule = moleculeOf.data();
+    const float* __restrict ax = anchorX.data();
+    const float* __restrict ay = anchorY.data();
+    const float* __restrict az = anchorZ.data();
+    const float* __restrict px = placedX.data();
+    const float* __restrict py = placedY.data();
+    const float* __restrict pz = placedZ.data();
+    for (size_t b = begin; b < end; b += kBlock) {
+      const size_t blockEnd = std::min(end, b + kBlock);
+      for (size_t i = b; i < blockEnd; i++) {
+        const uint32_t m = molecule[i];
+        float dx = x[i] - ax[m];
+        float dy = y[i] - ay[m];
+        float dz = z[i] - az[m];
+        x[i] = px[m] + dx - lx * roundFast(dx * ix);
+        y[i] = py[m] + dy - ly * roundFast(dy * iy);
+        z[i] = pz[m] + dz - lz * roundFast(dz * iz);
+      }
+      for (size_t i = b; i < blockEnd && !out.empty(); i++) {
+        out[i].x = x[i];
+        out[i].y = y[i];
+        out[i].z = z[i];
+      }
+    }
+  };
+
+  const size_t molecules = firstAtom.size();
+  const unsigned workers = n < kParallelAtoms ? 1u : pool.size();
+  if (workers == 1) {
+    place(0, molecules);
+    unwrap(0, n);
+    return;
+  }
+  // all first atoms are read before any atom moves
+  auto parallel = [&](size_t count, auto&& work) {
+    pool.run(workers, [&](unsigned t) { work(count * t / workers, count * (t + 1) / workers); });
+  };
+  parallel(molecules, place);
+  parallel(n, unwrap);
+}
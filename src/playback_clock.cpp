@@ -0,0 +1,97 @@
+#include "playback_clock.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void PlaybackClock::setRange(size_t first, size_t count) {
+  rangeFirst = first;
+  rangeCount = std::max<size_t>(count, 1);
+  pos = std::clamp(pos, (double)rangeFirst, (double)(rangeFirst + rangeCount) - 1e-6);
+}
+
+void PlaybackClock::play(double now) {
+  running = true;
+  lastTick = now;
+}
+
+void PlaybackClock::pause() {
+  running = false;
+}
+
+void PlaybackClock::seek(size_t frame) {
+  frame = std::clamp(frame, rangeFirst, rangeFirst + rangeCount - 1);
+  pos = (double)frame;
+}
+
+void PlaybackClock::tick(double now) {
+  double dt = now - lastTick;
+  lastTick = now;
+  if (!running || dt <= 0.0) {
+    return;
+  }
+  double offset = std::fmod(pos - (double)rangeFirst + rate * dt, (double)rangeCount);
+  pos = (double)rangeFirst + std::max(offset, 0.0);
+}
+
+// Frames from `from` forward to `to` around a loop of `n`.
+static size_t forwardDistance(size_t from, size_t to, size_t n) {
+  long long d = ((long long)to - (long long)from) % (long long)n;
+  return (size_t)(d < 0 ? d + (long long)n : d);
+}
+
+void PlaybackClock::present(size_t shown, double now) {
+  if (lastPresent >= 0.0) {
+    if (history.size() == kHistory) {
+      history.erase(history.begin());
+    }
+    history.push_back((float)((now - lastPresent) * 1000.0));
+
+    // going backwards (or most of the way round) is a seek, not a skip
+    size_t forward = forwardDistance(lastShown, shown, rangeCount);
+    if (running && forward > 1 && forward <= rangeCount / 2) {
+      skipped += forward - 1;
+    }
+  }
+  // A frame requested on one tick arrives on a later one, so being a single
+  // frame behind is the pipeline working as intended.
+  size_t behind = forwardDistance(shown, frame(), rangeCount);
+  if (running && behind > 1 && behind <= rangeCount / 2) {
+    late++;
+  }
+  presented++;
+  lastShown = shown;
+  lastPresent = now;
+}
+
+PlaybackClock::Pacing PlaybackClock::pacing() const {
+  Pacing p;
+  p.presented = presented;
+  p.skipped = skipped;
+  p.late = late;
+  if (history.empty()) {
+    return p;
+  }
+  double sum = 0.0, sumSq = 0.0;
+  for (float ms : history) {
+    sum += ms;
+    sumSq += (double)ms * ms;
+  }
+  double n = (double)history.size();
+  p.meanMs = sum / n;
+  p.jitterMs = std::sqrt(std::max(sumSq / n - p.meanMs * p.meanMs, 0.0));
+
+  std::vector<float> sorted = history;
+  size_t k = std::min(sorted.size() - 1, (size_t)(0.95 * n));
+  std::nth_element(sorted.begin(), sorted.begin() + (ptrdiff_t)k, sorted.end());
+  p.p95Ms = sorted[k];
+  p.maxMs = *std::max_element(history.begin(), history.end());
+  return p;
+}
+
+void PlaybackClock::resetPacing() {
+  presented = 0;
+  skipped = 0;
+  late = 0;
+  lastPresent = -1.0;
+  history.clear();
+}
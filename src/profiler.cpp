@@ -0,0 +1,257 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include <imgui.h>
+
+FrameProfiler::FrameProfiler() : epoch(std::chrono::steady_clock::now()) {
+}
+
+FrameProfiler::~FrameProfiler() {
+  release();
+}
+
+void FrameProfiler::release() {
+  for (std::vector<PendingQuery>& slot : pending) {
+    for (const PendingQuery& q : slot) {
+      freeQueries.push_back(q.query);
+    }
+    slot.clear();
+  }
+  if (!freeQueries.empty()) {
+    glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+    freeQueries.clear();
+  }
+}
+
+double FrameProfiler::nowUs() const {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint32_t FrameProfiler::sectionIndex(const char* name) {
+  for (uint32_t i = 0; i < sections.size(); i++) {
+    if (sections[i].name == name) {
+      return i;
+    }
+  }
+  sections.push_back(Section{name});
+  return uint32_t(sections.size() - 1);
+}
+
+void FrameProfiler::beginFrame() {
+  // Queries from kLatency frames ago are normally done by now; any that are
+  // not are dropped rather than waited on.
+  collectQueries(pending[frame % kLatency]);
+
+  size_t slot = frame % kHistory;
+  for (Section& s : sections) {
+    s.cpuMs[slot] = 0.0f;
+    s.gpuMs[slot] = 0.0f;
+  }
+
+  // Keep the event log to the frames still in the history.
+  if (frame >= kHistory) {
+    uint64_t oldest = frame - kHistory + 1;
+    auto stale = std::remove_if(events.begin(), events.end(),
+                                [&](const Event& e) { return e.frame < oldest; });
+    events.erase(stale, events.end());
+  }
+
+  frameStartUs = nowUs();
+}
+
+void FrameProfiler::endFrame() {
+  frameMs[frame % kHistory] = float((nowUs() - frameStartUs) / 1000.0);
+  recorded = std::min(recorded + 1, kHistory);
+  frame++;
+}
+
+void FrameProfiler::beginCpu(const char* name) {
+  cpuStack.emplace_back(sectionIndex(name), nowUs());
+}
+
+void FrameProfiler::endCpu() {
+  if (cpuStack.empty()) {
+    return;
+  }
+  auto [section, start] = cpuStack.back();
+  cpuStack.pop_back();
+  double duration = nowUs() - start;
+  sections[section].cpuMs[frame % kHistory] += float(duration / 1000.0);
+  events.push_back({section, false, frame, start, duration});
+}
+
+void FrameProfiler::beginGpu(const char* name) {
+  if (gpuActive) {
+    return;
+  }
+  GLuint query;
+  if (freeQueries.empty()) {
+    glGenQueries(1, &query);
+  } else {
+    query = freeQueries.back();
+    freeQueries.pop_back();
+  }
+  activeQuery = {query, sectionIndex(name), frame, nowUs()};
+  glBeginQuery(GL_TIME_ELAPSED, query);
+  gpuActive = true;
+}
+
+void FrameProfiler::endGpu() {
+  if (!gpuActive) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  pending[frame % kLatency].push_back(activeQuery);
+  gpuActive = false;
+}
+
+void FrameProfiler::collectQueries(std::vector<PendingQuery>& slot) {
+  for (const PendingQuery& q : slot) {
+    GLint available = 0;
+    glGetQueryObjectiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint64 ns = 0;
+      glGetQueryObjectui64v(q.query, GL_QUERY_RESULT, &ns);
+      if (frame - q.frame < kHistory) {
+        sections[q.section].gpuMs[q.frame % kHistory] += float(ns / 1.0e6);
+      }
+      events.push_back({q.section, true, q.frame, q.startUs, ns / 1000.0});
+      freeQueries.push_back(q.query);
+    } else {
+      // Still in use by the GPU; retire it instead of reusing it.
+      glDeleteQueries(1, &q.query);
+    }
+  }
+  slot.clear();
+}
+
+static float percentile(std::vector<float> values, float p) {
+  if (values.empty()) {
+    return 0.0f;
+  }
+  size_t k = std::min(values.size() - 1, size_t(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+void FrameProfiler::drawWindow(bool* open) {
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  // History slots in chronological order, oldest first.
+  std::vector<size_t> order;
+  for (size_t i = recorded; i > 0; i--) {
+    order.push_back((frame - i) % kHistory);
+  }
+
+  std::vector<float> frames;
+  for (size_t slot : order) {
+    frames.push_back(frameMs[slot]);
+  }
+  float p50 = percentile(frames, 0.50f);
+  float p95 = percentile(frames, 0.95f);
+  float p99 = percentile(frames, 0.99f);
+
+  char overlay[96];
+  std::snprintf(overlay, sizeof(overlay), "p50 %.2f  p95 %.2f  p99 %.2f ms", p50, p95, p99);
+  ImGui::PlotLines("Frame (ms)", frames.data(), (int)frames.size(), 0, overlay,
+                   0.0f, std::max(p99 * 1.5f, 1.0f), ImVec2(0, 80));
+
+  std::vector<float> gpuTotal(order.size(), 0.0f);
+  for (const Section& s : sections) {
+    for (size_t i = 0; i < order.size(); i++) {
+      gpuTotal[i] += s.gpuMs[order[i]];
+    }
+  }
+  ImGui::PlotLines("GPU (ms)", gpuTotal.data(), (int)gpuTotal.size(), 0, nullptr,
+                   0.0f, std::max(percentile(gpuTotal, 0.99f) * 1.5f, 1.0f), ImVec2(0, 60));
+
+  if (ImGui::BeginTable("sections", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Phase");
+    ImGui::TableSetupColumn("CPU p50");
+    ImGui::TableSetupColumn("CPU p95");
+    ImGui::TableSetupColumn("GPU p50");
+    ImGui::TableSetupColumn("GPU p95");
+    ImGui::TableHeadersRow();
+
+    std::vector<float> cpu, gpu;
+    for (const Section& s : sections) {
+      cpu.clear();
+      gpu.clear();
+      for (size_t slot : order) {
+        cpu.push_back(s.cpuMs[slot]);
+        gpu.push_back(s.gpuMs[slot]);
+      }
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(s.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", percentile(cpu, 0.50f));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", percentile(cpu, 0.95f));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", percentile(gpu, 0.50f));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", percentile(gpu, 0.95f));
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Export Chrome trace")) {
+    char name[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(name, sizeof(name), "chemviz-trace-%Y%m%d-%H%M%S.json", std::localtime(&now));
+    try {
+      writeChromeTrace(name);
+      std::cout << "Wrote " << name << "\n";
+    } catch (const std::exception& e) {
+      std::cerr << e.what();
+    }
+  }
+  ImGui::End();
+}
+
+static void writeJsonString(std::ofstream& out, const std::string& s) {
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+void FrameProfiler::writeChromeTrace(const std::string& path) const {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Failed to open file: " + path + "\n");
+  }
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+  out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+  for (const Event& e : events) {
+    out << ",\n{\"name\":";
+    writeJsonString(out, sections[e.section].name);
+    out << ",\"cat\":\"" << (e.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\""
+        << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs
+        << ",\"pid\":1,\"tid\":" << (e.gpu ? 2 : 1)
+        << ",\"args\":{\"frame\":" << e.frame << "}}";
+  }
+  out << "\n]}\n";
+
+  if (!out) {
+    throw std::runtime_error("Failed to write file: " + path + "\n");
+  }
+}
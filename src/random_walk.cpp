@@ -0,0 +1,139 @@
+#include "random_walk.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+// Below this many coordinate updates a single thread is faster than
+// waking the pool.
+static constexpr size_t kParallelWork = size_t(1) << 18;
+
+// Atoms per block; 16 floats is one cache line, so no two threads write the
+// same line and every block starts at the same alignment.
+static constexpr size_t kBlock = 16;
+
+// The key is hashed before it meets the counter: added directly, keys that
+// differ by a multiple of three would give shifted copies of one stream.
+static void walkAtoms(float* __restrict x, float* __restrict y, float* __restrict z,
+                      size_t begin, size_t end, uint32_t key, float scale) {
+  const uint32_t k = mixBits(key);
+  for (size_t i = begin; i < end; i++) {
+    uint32_t c = (uint32_t)i * 3u;
+    x[i] += (float)(int32_t)mixBits(k ^ c) * scale;
+    y[i] += (float)(int32_t)mixBits(k ^ (c + 1u)) * scale;
+    z[i] += (float)(int32_t)mixBits(k ^ (c + 2u)) * scale;
+  }
+}
+
+RandomWalkGenerator::RandomWalkGenerator(const Molecule& start, uint64_t seed, float stepSize,
+                                         unsigned threads, size_t checkpointBytes)
+  : start(start), positions(start), seed(seed), stepSize(stepSize), pool(threads),
+    checkpointBytes(checkpointBytes) {}
+
+const Molecule& RandomWalkGenerator::seek(size_t frame) {
+  // resume from the last checkpoint at or before the target when going
+  // backwards, or when it is closer than the current frame
+  auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), frame,
+                                [](size_t f, const Checkpoint& c) { return f < c.frame; });
+  size_t from = after == checkpoints.begin() ? 0 : std::prev(after)->frame;
+  if (frame < current || from > current) {
+    if (after == checkpoints.begin()) {
+      positions = start;
+    } else {
+      const Checkpoint& c = *std::prev(after);
+      std::copy(c.x.begin(), c.x.end(), positions.x.begin());
+      std::copy(c.y.begin(), c.y.end(), positions.y.begin());
+      std::copy(c.z.begin(), c.z.end(), positions.z.begin());
+    }
+    current = from;
+  }
+  advance(frame - current, nullptr);
+  return positions;
+}
+
+std::vector<Molecule> RandomWalkGenerator::generate(size_t first, size_t count) {
+  seek(first);
+  std::vector<Molecule> frames(count);
+  if (count > 0) {
+    frames[0] = positions;
+    for (size_t f = 1; f < count; f++) {
+      frames[f].resize(positions.size());
+      std::copy(positions.atomicNumbers.begin(), positions.atomicNumbers.end(),
+                frames[f].atomicNumbers.begin());
+    }
+    advance(count - 1, frames.data() + 1);
+  }
+  return frames;
+}
+
+void RandomWalkGenerator::advance(size_t steps, Molecule* frames) {
+  // walk to each checkpoint boundary in turn so the frames on it are kept
+  while (steps > 0) {
+    size_t run = std::min(steps, (current / interval + 1) * interval - current);
+    walk(run, frames);
+    if (frames != nullptr) {
+      frames += run;
+    }
+    steps -= run;
+    if (current % interval == 0) {
+      checkpoint();
+    }
+  }
+}
+
+void RandomWalkGenerator::checkpoint() {
+  const size_t bytes = positions.size() * 3 * sizeof(float);
+  if (bytes == 0 || bytes > checkpointBytes) {
+    return;
+  }
+  auto at = std::lower_bound(checkpoints.begin(), checkpoints.end(), current,
+                             [](const Checkpoint& c, size_t f) { return c.frame < f; });
+  if (at != checkpoints.end() && at->frame == current) {
+    return;
+  }
+  if ((checkpoints.size() + 1) * bytes > checkpointBytes) {
+    // thin out to every other checkpoint
+    interval *= 2;
+    std::erase_if(checkpoints, [&](const Checkpoint& c) { return c.frame % interval != 0; });
+    if (current % interval != 0) {
+      return;
+    }
+    at = std::lower_bound(checkpoints.begin(), checkpoints.end(), current,
+                          [](const Checkpoint& c, size_t f) { return c.frame < f; });
+  }
+  checkpoints.insert(at, Checkpoint{current, positions.x, positions.y, positions.z});
+}
+
+void RandomWalkGenerator::walk(size_t steps, Molecule* frames) {
+  const size_t n = positions.size();
+  if (steps == 0 || n == 0) {
+    current += steps;
+    return;
+  }
+  // int32 * scale covers [-stepSize, stepSize)
+  const float scale = stepSize / 2147483648.0f;
+  const size_t base = current;
+
+  size_t blocks = (n + kBlock - 1) / kBlock;
+  unsigned workers = (unsigned)std::min<size_t>(pool.size(), blocks);
+  if (n * 3 * steps < kParallelWork) {
+    workers = 1;
+  }
+
+  pool.run(workers, [&](unsigned t) {
+    size_t begin = std::min(n, blocks * t / workers * kBlock);
+    size_t end = std::min(n, blocks * (t + 1) / workers * kBlock);
+    float* x = positions.x.data();
+    float* y = positions.y.data();
+    float* z = positions.z.data();
+    for (size_t s = 0; s < steps; s++) {
+      walkAtoms(x, y, z, begin, end, walkStepKey(seed, base + s), scale);
+      if (frames != nullptr) {
+        std::copy(x + begin, x + end, frames[s].x.data() + begin);
+        std::copy(y + begin, y + end, frames[s].y.data() + begin);
+        std::copy(z + begin, z + end, frames[s].z.data() + begin);
+      }
+    }
+  });
+  current += steps;
+  stepped += steps;
+}
@@ -0,0 +1,264 @@
+#include "rdf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+// Squared distances from one atom to a run of atoms in a neighbor cell.
+static void squaredDistances(const float* __restrict x, const float* __restrict y,
+                             const float* __restrict z, size_t count,
+                             float ox, float oy, float oz, float* __restrict out) {
+  for (size_t j = 0; j < count; j++) {
+    float dx = x[j] - ox;
+    float dy = y[j] - oy;
+    float dz = z[j] - oz;
+    out[j] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+RdfAccumulator::RdfAccumulator(float cutoff, size_t bins, unsigned threads)
+  : rMax(cutoff), bins(std::max<size_t>(bins, 1)), threads(threads) {
+  if (this->threads == 0) {
+    this->threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  reset();
+}
+
+void RdfAccumulator::setBox(float lx, float ly, float lz) {
+  box[0] = lx;
+  box[1] = ly;
+  box[2] = lz;
+  periodic = lx > 0.0f && ly > 0.0f && lz > 0.0f;
+  reset();
+}
+
+void RdfAccumulator::setRange(float cutoff, size_t binCount) {
+  rMax = cutoff;
+  bins = std::max<size_t>(binCount, 1);
+  reset();
+}
+
+void RdfAccumulator::reset() {
+  kinds.clear();
+  pairList.clear();
+  counts.clear();
+  pairDensity.clear();
+  frameCount = 0;
+  std::fill(std::begin(kindOf), std::end(kindOf), 0xff);
+}
+
+void RdfAccumulator::chooseKinds(const Molecule& mol) {
+  std::array<size_t, 256> population{};
+  for (uint8_t z : mol.elements()) {
+    population[z]++;
+  }
+  for (int z = 0; z < 256; z++) {
+    if (population[z] > 0) {
+      kinds.push_back(z);
+    }
+  }
+  std::stable_sort(kinds.begin(), kinds.end(),
+                   [&](int a, int b) { return population[a] > population[b]; });
+  if (kinds.size() > kMaxKinds) {
+    kinds.resize(kMaxKinds);
+  }
+  for (size_t k = 0; k < kinds.size(); k++) {
+    kindOf[kinds[k]] = (uint8_t)k;
+    for (size_t l = k; l < kinds.size(); l++) {
+      pairList.emplace_back(kinds[k], kinds[l]);
+    }
+  }
+  counts.assign(pairList.size() * bins, 0);
+  pairDensity.assign(pairList.size(), 0.0);
+}
+
+void RdfAccumulator::accumulate(const Molecule& mol) {
+  const size_t n = mol.size();
+  if (n == 0) {
+    return;
+  }
+  if (kinds.empty()) {
+    chooseKinds(mol);
+  }
+
+  // ---------- Cell list ----------
+  float lo[3] = {0.0f, 0.0f, 0.0f};
+  float len[3] = {box[0], box[1], box[2]};
+  if (!periodic) {
+    const std::span<const float> p[3] = {mol.xs(), mol.ys(), mol.zs()};
+    for (int a = 0; a < 3; a++) {
+      auto [mn, mx] = std::minmax_element(p[a].begin(), p[a].end());
+      lo[a] = *mn;
+      len[a] = std::max(*mx - *mn, 1e-3f);
+    }
+  }
+  int dims[3];
+  for (int a = 0; a < 3; a++) {
+    dims[a] = std::clamp((int)(len[a] / rMax), 1, 1024);
+  }
+  const size_t cells = (size_t)dims[0] * dims[1] * dims[2];
+
+  auto wrap = [&](float v, int a) {
+    v -= lo[a];
+    if (periodic) {
+      v -= len[a] * std::floor(v / len[a]);
+    }
+    return v;
+  };
+  auto cellOf = [&](float x, float y, float z) {
+    const float v[3] = {x, y, z};
+    int c[3];
+    for (int a = 0; a < 3; a++) {
+      c[a] = std::clamp((int)(v[a] / len[a] * (float)dims[a]), 0, dims[a] - 1);
+    }
+    return (uint32_t)((c[2] * dims[1] + c[1]) * dims[0] + c[0]);
+  };
+
+  atomCell.resize(n);
+  cellStart.assign(cells + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    atomCell[i] = cellOf(wrap(mol.x[i], 0), wrap(mol.y[i], 1), wrap(mol.z[i], 2));
+    cellStart[atomCell[i] + 1]++;
+  }
+  for (size_t c = 0; c < cells; c++) {
+    cellStart[c + 1] += cellStart[c];
+  }
+  sx.resize(n);
+  sy.resize(n);
+  sz.resize(n);
+  skind.resize(n);
+  {
+    std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+      uint32_t k = cursor[atomCell[i]]++;
+      sx[k] = wrap(mol.x[i], 0);
+      sy[k] = wrap(mol.y[i], 1);
+      sz[k] = wrap(mol.z[i], 2);
+      skind[k] = kindOf[mol.atomicNumbers[i]];
+    }
+  }
+
+  int pairOf[kMaxKinds][kMaxKinds] = {};
+  for (size_t p = 0; p < pairList.size(); p++) {
+    int a = kindOf[pairList[p].first], b = kindOf[pairList[p].second];
+    pairOf[a][b] = pairOf[b][a] = (int)p;
+  }
+
+  // ---------- Pair histogram ----------
+  const float r2Max = rMax * rMax;
+  const float invDr = (float)bins / rMax;
+  const size_t histSize = pairList.size() * bins;
+
+  unsigned workers = (unsigned)std::min<size_t>(threads, cells);
+  if (n < 4096) {
+    workers = 1;
+  }
+  // home cells split so each worker gets about the same number of atoms
+  std::vector<size_t> split(workers + 1, cells);
+  for (unsigned t = 0; t < workers; t++) {
+    split[t] = (size_t)(std::lower_bound(cellStart.begin(), cellStart.end(),
+                                         (uint32_t)(n * t / workers)) - cellStart.begin());
+  }
+  split[0] = 0;
+
+  std::vector<std::vector<uint64_t>> local(workers, std::vector<uint64_t>(histSize, 0));
+  auto work = [&](unsigned t) {
+    std::vector<uint64_t>& hist = local[t];
+    std::vector<float> r2;
+    for (size_t c = split[t]; c < split[t + 1]; c++) {
+      const int home[3] = {(int)(c % dims[0]), (int)(c / dims[0] % dims[1]),
+                           (int)(c / ((size_t)dims[0] * dims[1]))};
+      for (int d = 0; d < 27; d++) {
+        const int offset[3] = {d % 3 - 1, d / 3 % 3 - 1, d / 9 - 1};
+        int nc[3];
+        float shift[3];
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+          nc[a] = home[a] + offset[a];
+          shift[a] = 0.0f;
+          if (nc[a] < 0 || nc[a] >= dims[a]) {
+            if (!periodic) {
+              inside = false;
+              break;
+            }
+            shift[a] = nc[a] < 0 ? -len[a] : len[a];
+            nc[a] -= nc[a] < 0 ? -dims[a] : dims[a];
+          }
+        }
+        if (!inside) {
+          continue;
+        }
+        size_t neighbor = ((size_t)nc[2] * dims[1] + nc[1]) * dims[0] + nc[0];
+        size_t js = cellStart[neighbor], je = cellStart[neighbor + 1];
+
+        // each pair (and periodic image) is counted from its lower index only
+        for (size_t i = cellStart[c]; i < cellStart[c + 1]; i++) {
+          size_t jb = std::max(js, i + 1);
+          if (skind[i] == 0xff || jb >= je) {
+            continue;
+          }
+          size_t count = je - jb;
+          if (r2.size() < count) {
+            r2.resize(count);
+          }
+          squaredDistances(&sx[jb], &sy[jb], &sz[jb], count,
+                           sx[i] - shift[0], sy[i] - shift[1], sz[i] - shift[2], r2.data());
+          const int* slots = pairOf[skind[i]];
+          for (size_t k = 0; k < count; k++) {
+            uint8_t kj = skind[jb + k];
+            if (r2[k] < r2Max && kj != 0xff) {
+              size_t bin = std::min((size_t)(std::sqrt(r2[k]) * invDr), bins - 1);
+              hist[(size_t)slots[kj] * bins + bin]++;
+            }
+          }
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < workers; t++) {
+    pool.emplace_back(work, t);
+  }
+  work(0);
+  for (std::thread& th : pool) {
+    th.join();
+  }
+  for (const std::vector<uint64_t>& hist : local) {
+    for (size_t b = 0; b < histSize; b++) {
+      counts[b] += hist[b];
+    }
+  }
+
+  // ---------- Normalization ----------
+  std::array<double, kMaxKinds> population{};
+  for (uint8_t k : skind) {
+    if (k != 0xff) {
+      population[k]++;
+    }
+  }
+  const double volume = (double)len[0] * len[1] * len[2];
+  for (size_t p = 0; p < pairList.size(); p++) {
+    double na = population[kindOf[pairList[p].first]];
+    double nb = population[kindOf[pairList[p].second]];
+    double pairsInFrame = pairList[p].first == pairList[p].second ? na * (na - 1.0) / 2.0 : na * nb;
+    pairDensity[p] += pairsInFrame / volume;
+  }
+  frameCount++;
+}
+
+std::vector<float> RdfAccumulator::g(size_t p) const {
+  std::vector<float> out(bins, 0.0f);
+  if (p >= pairList.size() || pairDensity[p] <= 0.0) {
+    return out;
+  }
+  const double dr = rMax / (double)bins;
+  const double pi = 3.14159265358979323846;
+  for (size_t b = 0; b < bins; b++) {
+    double r0 = dr * (double)b, r1 = dr * (double)(b + 1);
+    double shell = 4.0 / 3.0 * pi * (r1 * r1 * r1 - r0 * r0 * r0);
+    out[b] = (float)((double)counts[p * bins + b] / (pairDensity[p] * shell));
+  }
+  return out;
+}
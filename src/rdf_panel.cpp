@@ -0,0 +1,92 @@
+#include "rdf_panel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <imgui.h>
+
+RdfPanel::RdfPanel(size_t frameCount)
+  : cutoff(rdf.cutoff()), bins((int)rdf.binCount()), counted(frameCount, 0) {}
+
+void RdfPanel::restart() {
+  if (job.valid()) {
+    job.get();
+  }
+  std::fill(counted.begin(), counted.end(), 0);
+  curves.clear();
+  frames = 0;
+}
+
+void RdfPanel::reset(size_t frameCount) {
+  restart();
+  rdf.reset();
+  counted.assign(frameCount, 0);
+}
+
+void RdfPanel::setBox(float lx, float ly, float lz) {
+  restart();
+  box[0] = lx;
+  box[1] = ly;
+  box[2] = lz;
+  rdf.setBox(lx, ly, lz);
+}
+
+void RdfPanel::offer(size_t shown, const Molecule& mol) {
+  if (!open || shown >= counted.size() || counted[shown] || job.valid()) {
+    return;
+  }
+  counted[shown] = 1;
+  frame = mol;
+  job = std::async(std::launch::async, [this] { rdf.accumulate(frame); });
+}
+
+void RdfPanel::poll() {
+  if (!job.valid() || job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+  job.get();
+  frames = rdf.frames();
+  curves.resize(rdf.pairs().size());
+  for (size_t p = 0; p < curves.size(); p++) {
+    curves[p] = rdf.g(p);
+  }
+}
+
+void RdfPanel::draw() {
+  if (!open) {
+    return;
+  }
+  ImGui::Begin("Radial distribution", &open);
+  ImGui::Text("Frames: %zu of %zu%s", frames, counted.size(),
+              job.valid() ? " (accumulating)" : "");
+  if (box[0] > 0.0f && box[1] > 0.0f && box[2] > 0.0f) {
+    ImGui::Text("Periodic box %.2f x %.2f x %.2f A", box[0], box[1], box[2]);
+  } else {
+    ImGui::TextDisabled("No periodic box: normalized by the bounding box");
+  }
+  ImGui::SliderFloat("Cutoff (A)", &cutoff, 2.0f, 15.0f);
+  bool rangeChanged = ImGui::IsItemDeactivatedAfterEdit();
+  ImGui::SliderInt("Bins", &bins, 20, 400);
+  rangeChanged |= ImGui::IsItemDeactivatedAfterEdit();
+  if (rangeChanged) {
+    restart();
+    rdf.setRange(cutoff, (size_t)bins);
+  }
+  if (ImGui::Button("Reset")) {
+    restart();
+    rdf.reset();
+  }
+  for (size_t p = 0; p < curves.size(); p++) {
+    const std::vector<float>& curve = curves[p];
+    char label[32];
+    std::snprintf(label, sizeof(label), "g(r) %s-%s", elementSymbol(rdf.pairs()[p].first),
+                  elementSymbol(rdf.pairs()[p].second));
+    float peak = curve.empty() ? 0.0f : *std::max_element(curve.begin(), curve.end());
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "0-%.1f A, max %.2f", rdf.cutoff(), peak);
+    ImGui::PlotLines(label, curve.data(), (int)curve.size(), 0, overlay, 0.0f,
+                     std::max(peak, 1.0f) * 1.1f, ImVec2(0, 100));
+  }
+  ImGui::End();
+}
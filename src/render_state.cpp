@@ -0,0 +1,63 @@
+#include "render_state.hpp"
+
+// std140 layout of the Camera block below.
+struct CameraBlock {
+  glm::mat4 view;
+  glm::mat4 proj;
+  glm::vec4 light;
+  float pixelScale;
+  float pad[3];
+};
+static_assert(sizeof(CameraBlock) == 160, "CameraBlock must match the std140 layout");
+
+static const char* cameraGlsl = R"(
+  layout(std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec4 uLight;        // view-space direction toward the light, ambient in w
+    float uPixelScale;  // pixels per unit size at unit view distance
+  };
+
+  // Lambert term on top of the ambient level.
+  vec3 shade(vec3 color, vec3 N) {
+    float diff = max(dot(N, uLight.xyz), 0.0);
+    return color * (uLight.w + (1.0 - uLight.w) * diff);
+  }
+)";
+
+std::string withCameraBlock(const char* src) {
+  std::string s = src;
+  s.insert(s.find('\n') + 1, cameraGlsl);
+  return s;
+}
+
+CameraUniforms::CameraUniforms() {
+  glGenBuffers(1, &ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+CameraUniforms::~CameraUniforms() {
+  release();
+}
+
+void CameraUniforms::update(const glm::mat4& view, const glm::mat4& proj, int height) {
+  CameraBlock block{};
+  block.view = view;
+  block.proj = proj;
+  block.light = glm::vec4(glm::normalize(lightDir), ambient);
+  block.pixelScale = proj[1][1] * 0.5f * (float)height;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, kCameraBinding, ubo);
+}
+
+void CameraUniforms::release() {
+  if (ubo != 0) {
+    glDeleteBuffers(1, &ubo);
+    ubo = 0;
+  }
+}
@@ -0,0 +1,154 @@
+#include "scene_loader.hpp"
+
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#include "binary_trajectory.hpp"
+#include "dcd_trajectory.hpp"
+#include "pdb_reader.hpp"
+#include "periodic.hpp"
+#include "xtc_trajectory.hpp"
+
+// DCD and XTC carry no elements; they come from the PDB file of the same
+// name next to the trajectory (run.xtc -> run.pdb).
+static Molecule readTopology(const std::string& path) {
+  std::filesystem::path pdb = std::filesystem::path(path).replace_extension(".pdb");
+  std::error_code ec;
+  if (!std::filesystem::exists(pdb, ec)) {
+    throw std::runtime_error("No topology for " + path + ": expected " + pdb.string() + "\n");
+  }
+  return read_pdb(pdb.string());
+}
+
+std::unique_ptr<FrameSource> openFrameSource(const std::string& path, Molecule& mol,
+                                             LoadProgress* progress) {
+  if (isBinaryTrajectory(path)) {
+    auto binary = std::make_unique<BinaryTrajectory>(path);
+    mol = binary->molecule(0);
+    return binary;
+  }
+  const bool dcd = isDcdFile(path);
+  if (dcd || isXtcFile(path)) {
+    if (progress != nullptr) {
+      progress->begin("Reading topology", 1);
+    }
+    Molecule topology = readTopology(path);
+    std::unique_ptr<FrameSource> source;
+    if (dcd) {
+      source = std::make_unique<DcdTrajectory>(path, topology);
+    } else {
+      source = std::make_unique<XtcTrajectory>(path, topology, progress);
+    }
+    std::vector<Instance> frame;
+    source->readFrame(0, frame);
+    mol = std::move(topology);
+    mol.setPositions(frame);
+    return source;
+  }
+  if (isPdbFile(path)) {
+    mol = read_pdb(path);
+    return std::make_unique<RandomWalkSource>(mol, 50000);
+  }
+  auto xyz = std::make_unique<XyzTrajectory>(path, progress);
+  xyz->readMolecule(0, mol, progress);
+  std::unique_ptr<FrameSource> source = std::move(xyz);
+  if (source->frameCount() == 1) {
+    auto walk = std::make_unique<RandomWalkSource>(mol, 50000);
+    float cell[9];
+    if (source->unitCell(cell)) {
+      walk->setUnitCell(cell);
+    }
+    source = std::move(walk);
+  }
+  return source;
+}
+
+LoadedScene loadScene(const std::string& path, size_t octreeAtoms, LoadProgress* progress) {
+  LoadedScene scene;
+  scene.path = path;
+  scene.source = openFrameSource(path, scene.mol, progress);
+
+  const size_t n = scene.mol.size();
+  scene.instances.resize(n);
+  toDraw(scene.mol, scene.instances);
+
+  // the trees are built in one go, so cancelling is only checked between them
+  if (progress != nullptr) {
+    progress->begin("Building picking BVH", 1);
+  }
+  scene.bvh.build(scene.instances);
+  if (n > octreeAtoms) {
+    if (progress != nullptr) {
+      progress->begin("Building octree", 1);
+    }
+    scene.octree.build(scene.instances);
+  }
+  if (progress != nullptr) {
+    progress->advance(1);
+  }
+
+  float center[3];
+  boundsCenter(scene.mol, center);
+  scene.center = glm::vec3(center[0], center[1], center[2]);
+  scene.periodic = scene.source->periodicBox(scene.box);
+  float cell[9];
+  if (!scene.periodic && scene.source->unitCell(cell)) {
+    // PeriodicImager works in orthorhombic boxes only
+    std::cerr << "Triclinic unit cell in " << path << ": periodic imaging is disabled\n";
+  }
+  return scene;
+}
+
+SceneLoader::~SceneLoader() {
+  cancel();
+  reap(true);
+}
+
+void SceneLoader::start(const std::string& path, size_t octreeAtoms) {
+  cancel();
+  failure.clear();
+
+  current = std::make_unique<Job>();
+  current->path = path;
+  Job* job = current.get();
+  job->thread = std::thread([job, octreeAtoms] {
+    try {
+      job->scene = std::make_unique<LoadedScene>(loadScene(job->path, octreeAtoms, &job->progress));
+    } catch (const std::exception& e) {
+      job->failure = e.what();
+    }
+    job->finished.store(true, std::memory_order_release);
+  });
+}
+
+void SceneLoader::cancel() {
+  if (current != nullptr) {
+    current->progress.cancel = true;
+    cancelled.push_back(std::move(current));
+  }
+}
+
+std::unique_ptr<LoadedScene> SceneLoader::poll() {
+  reap(false);
+  if (current == nullptr || !current->finished.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  current->thread.join();
+  std::unique_ptr<LoadedScene> scene = std::move(current->scene);
+  failure = current->failure;
+  current.reset();
+  return scene;
+}
+
+void SceneLoader::reap(bool wait) {
+  for (size_t i = 0; i < cancelled.size();) {
+    if (wait || cancelled[i]->finished.load(std::memory_order_acquire)) {
+      cancelled[i]->thread.join();
+      cancelled.erase(cancelled.begin() + i);
+    } else {
+      i++;
+    }
+  }
+}
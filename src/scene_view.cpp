@@ -0,0 +1,190 @@
+#include "scene_view.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+#include <imgui.h>
+
+static bool ready(const std::future<std::vector<Instance>>& job) {
+  return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void SceneViews::add(const OrbitCamera& cam, int frame) {
+  auto sv = std::make_unique<SceneView>();
+  sv->id = nextId++;
+  sv->cam = cam;
+  sv->frame = frame;
+  views.push_back(std::move(sv));
+}
+
+void SceneViews::reset(std::shared_ptr<FramePipeline> frames, const glm::vec3& target) {
+  pipeline = std::move(frames);
+  for (auto& sv : views) {
+    sv->follow = true;
+    sv->spheres.followFrame();
+    abandon(sv->pinJob);
+    sv->repin = false;
+    sv->cam.target = target;
+  }
+}
+
+void SceneViews::repin() {
+  for (auto& sv : views) {
+    if (!sv->follow) {
+      pin(*sv);
+    }
+  }
+}
+
+void SceneViews::abandon(std::future<std::vector<Instance>>& job) {
+  if (job.valid()) {
+    abandoned.push_back(std::move(job));
+  }
+}
+
+// A frame the streamer has not cached is decoded on the calling thread (for
+// a random walk, replayed from a checkpoint), so it is fetched on a worker;
+// one fetch runs per view at a time. The job drops its pipeline reference
+// before it finishes, so a replaced pipeline is never destroyed (joining its
+// threads) with the future on the render thread.
+void SceneViews::pin(SceneView& sv) {
+  if (sv.pinJob.valid()) {
+    sv.repin = true;
+    return;
+  }
+  sv.repin = false;
+  sv.pinJob = std::async(std::launch::async, [shared = pipeline, frame = sv.frame]() mutable {
+    std::shared_ptr<FramePipeline> frames = std::move(shared);
+    std::vector<Instance> instances;
+    frames->fetch((size_t)std::clamp(frame, 0, (int)frames->frameCount() - 1), instances);
+    return instances;
+  });
+}
+
+void SceneViews::update(bool gpuPlayback) {
+  std::erase_if(abandoned, [](std::future<std::vector<Instance>>& job) { return ready(job); });
+  std::erase_if(views, [&](std::unique_ptr<SceneView>& sv) {
+    if (!sv->open) {
+      sv->spheres.release();
+      abandon(sv->pinJob);
+    }
+    return !sv->open;
+  });
+  for (auto& sv : views) {
+    if (!sv->pinJob.valid() || !ready(sv->pinJob)) {
+      continue;
+    }
+    try {
+      std::vector<Instance> instances = sv->pinJob.get();
+      if (!sv->follow && !gpuPlayback) {
+        sv->spheres.pinFrame(std::move(instances));
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "View " << sv->id << ": " << e.what();
+      sv->follow = true;
+      sv->spheres.followFrame();
+      sv->repin = false;
+    }
+    if (sv->repin && !sv->follow && !gpuPlayback) {
+      pin(*sv);
+    }
+    sv->repin = false;
+  }
+}
+
+void SceneViews::drawWindows(bool gpuPlayback, int first, int last) {
+  const ImGuiIO& io = ImGui::GetIO();
+  for (auto& sv : views) {
+    char title[32];
+    std::snprintf(title, sizeof(title), "View %d###view%d", sv->id, sv->id);
+    ImGui::SetNextWindowSize(ImVec2(480, 400), ImGuiCond_FirstUseEver);
+    sv->visible = ImGui::Begin(title, &sv->open);
+    if (!sv->visible) {
+      ImGui::End();
+      continue;
+    }
+    if (ImGui::Checkbox("Follow playhead", &sv->follow)) {
+      if (sv->follow) {
+        sv->spheres.followFrame();
+      } else if (!gpuPlayback) {
+        pin(*sv);
+      }
+    }
+    if (!sv->follow) {
+      sv->frame = std::clamp(sv->frame, first, last);
+      ImGui::SameLine();
+      ImGui::SetNextItemWidth(-1.0f);
+      ImGui::SliderInt("##frame", &sv->frame, first, last, "Frame %d");
+      if (ImGui::IsItemDeactivatedAfterEdit() && !gpuPlayback) {
+        pin(*sv);
+      }
+    }
+    ImGui::TextDisabled("Drawn: %zu  Upload: %.1f KB", sv->spheres.drawnCount(),
+                        sv->spheres.uploadBytes() / 1024.0);
+
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    size.x = std::max(size.x, 1.0f);
+    size.y = std::max(size.y, 1.0f);
+    int tw = std::max(1, (int)(size.x * io.DisplayFramebufferScale.x));
+    int th = std::max(1, (int)(size.y * io.DisplayFramebufferScale.y));
+    if (!sv->target || sv->target->width() != tw || sv->target->height() != th) {
+      sv->target = std::make_unique<OffscreenTarget>(tw, th, true);
+    }
+    // drawn by render(), before the UI is rendered; GL rows run bottom-up
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::Image((ImTextureID)(intptr_t)sv->target->colorTexture(), size,
+                 ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+    ImGui::SetCursorScreenPos(origin);
+    ImGui::InvisibleButton("##orbit", size);
+    if (ImGui::IsItemActive()) {
+      const float limit = glm::radians(89.0f);
+      sv->cam.yaw -= io.MouseDelta.x * 0.005f;
+      sv->cam.pitch = glm::clamp(sv->cam.pitch + io.MouseDelta.y * 0.005f, -limit, limit);
+    }
+    if (ImGui::IsItemHovered()) {
+      sv->cam.distance = glm::clamp(sv->cam.distance * std::exp(-0.1f * io.MouseWheel), 0.2f, 500.0f);
+    }
+    ImGui::End();
+  }
+}
+
+void SceneViews::render(SphereRenderer& spheres, CameraUniforms& camera, const BondRenderer& bonds,
+                        bool showBonds, bool showHBonds, const GpuTrajectory* gpu, double playTime) {
+  for (auto& sv : views) {
+    if (!sv->visible) {
+      continue;
+    }
+    const OffscreenTarget& target = *sv->target;
+    target.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glm::mat4 viewMatrix = sv->cam.view();
+    glm::mat4 projMatrix = sv->cam.projection((float)target.width() / (float)target.height());
+    camera.update(viewMatrix, projMatrix, target.height());
+    sv->spheres.setView(viewMatrix, projMatrix, target.height(), sv->cam.distance);
+    if (gpu != nullptr) {
+      sv->spheres.setGpuTime(sv->follow ? playTime : double(sv->frame - (int)gpu->first()));
+    }
+    spheres.prepare(sv->spheres);
+    spheres.draw(sv->spheres);
+    // bond perception needs CPU positions, which GPU playback never produces
+    if (sv->follow && gpu == nullptr) {
+      if (showBonds) {
+        bonds.drawBonds();
+      }
+      if (showHBonds) {
+        bonds.drawHBonds();
+      }
+    }
+  }
+}
+
+void SceneViews::release() {
+  for (auto& sv : views) {
+    sv->spheres.release();
+    sv->target.reset();
+  }
+}
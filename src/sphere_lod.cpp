@@ -0,0 +1,41 @@
+#include "sphere_lod.hpp"
+
+LodBuckets SphereLodSorter::sort(std::span<const Instance> in, const glm::mat4& view,
+                                 float pixelScale, float bias, std::vector<Instance>& out) {
+  LodBuckets buckets;
+  level.resize(in.size());
+
+  // View-space depth is -(row 2 of the view matrix) . (x, y, z, 1).
+  const float vx = view[0][2], vy = view[1][2], vz = view[2][2], vw = view[3][2];
+  const float scale = pixelScale * bias;
+
+  for (size_t i = 0; i < in.size(); i++) {
+    const Instance& s = in[i];
+    float depth = -(vx * s.x + vy * s.y + vz * s.z + vw);
+
+    // Spheres behind the eye are clipped anyway; give them the cheapest mesh.
+    uint8_t l = kSphereLodCount - 1;
+    if (depth > s.radius) {
+      float pixels = s.radius * scale / depth;
+      l = 0;
+      while (pixels < kSphereLods[l].minPixels) {
+        l++;
+      }
+    }
+    level[i] = l;
+    buckets.count[l]++;
+  }
+
+  size_t offset = 0;
+  for (size_t l = 0; l < kSphereLodCount; l++) {
+    buckets.first[l] = offset;
+    offset += buckets.count[l];
+  }
+
+  out.resize(in.size());
+  std::array<size_t, kSphereLodCount> cursor = buckets.first;
+  for (size_t i = 0; i < in.size(); i++) {
+    out[cursor[level[i]]++] = in[i];
+  }
+  return buckets;
+}
@@ -0,0 +1,677 @@
+#include "sphere_renderer.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "culling.hpp"
+#include "gl_util.hpp"
+#include "gpu_trajectory.hpp"
+#include "mesh.hpp"
+#include "profiler.hpp"
+#include "render_state.hpp"
+
+// Position lookup shared by the sphere vertex shaders. With a GPU-resident
+// trajectory the instance position is ignored and the atom (gl_InstanceID,
+// instances in atom order) is interpolated between frames floor(t) and
+// floor(t) + 1 of the quantized window.
+static const char* trajectoryGlsl = R"(
+  uniform bool uGpuTrajectory;
+  uniform samplerBuffer uFrames;
+  uniform float uTime;
+  uniform int uFrameCount;
+  uniform int uAtomCount;
+  uniform vec3 uOrigin;
+  uniform vec3 uExtent;
+
+  vec3 atomPosition(vec3 instancePos) {
+    if (!uGpuTrajectory) return instancePos;
+    float f = floor(uTime);
+    int f0 = int(f);
+    int f1 = min(f0 + 1, uFrameCount - 1);
+    vec3 a = texelFetch(uFrames, f0 * uAtomCount + gl_InstanceID).xyz;
+    vec3 b = texelFetch(uFrames, f1 * uAtomCount + gl_InstanceID).xyz;
+    return uOrigin + mix(a, b, uTime - f) * uExtent;
+  }
+)";
+
+// Inserts trajectoryGlsl after the #version line of `src`.
+static std::string withTrajectoryFetch(const char* src) {
+  std::string s = src;
+  s.insert(s.find('\n') + 1, trajectoryGlsl);
+  return s;
+}
+
+static const char* vsSrc = R"(#version 330 core
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aNrm;
+
+layout(location=2) in vec3 iPos;
+layout(location=3) in float iRadius;
+layout(location=4) in vec3 iColor;
+
+out vec3 vNrmVS;
+out vec3 vColor;
+
+void main() {
+  vec3 worldPos = (aPos * iRadius) + atomPosition(iPos);
+
+  vNrmVS = mat3(uView) * aNrm;
+  vColor = iColor;
+
+  gl_Position = uProj * uView * vec4(worldPos, 1.0);
+}
+)";
+
+static const char* fsSrc = R"(#version 330 core
+in vec3 vNrmVS;
+in vec3 vColor;
+out vec4 FragColor;
+
+void main() {
+  FragColor = vec4(shade(vColor, normalize(vNrmVS)), 1.0);
+}
+)";
+
+
+static const char* impostorVsSrc = R"(#version 330 core
+layout(location=0) in vec2 aCorner;
+
+layout(location=2) in vec3 iPos;
+layout(location=3) in float iRadius;
+layout(location=4) in vec3 iColor;
+
+out vec3 vPosVS;
+flat out vec3 vCenterVS;
+flat out float vRadius;
+flat out vec3 vColor;
+
+void main() {
+  vec3 center = (uView * vec4(atomPosition(iPos), 1.0)).xyz;
+
+  // The quad faces the eye and is sized to the sphere's silhouette cone.
+  float d = length(center);
+  float extent = iRadius * d / sqrt(max(d * d - iRadius * iRadius, 1e-6));
+  extent = min(extent, 4.0 * iRadius);
+
+  vec3 w = center / max(d, 1e-6);
+  vec3 helper = abs(w.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+  vec3 u = normalize(cross(helper, w));
+  vec3 v = cross(w, u);
+
+  vPosVS = center + (u * aCorner.x + v * aCorner.y) * extent;
+  vCenterVS = center;
+  vRadius = iRadius;
+  vColor = iColor;
+
+  gl_Position = uProj * vec4(vPosVS, 1.0);
+}
+)";
+
+static const char* impostorFsSrc = R"(#version 330 core
+in vec3 vPosVS;
+flat in vec3 vCenterVS;
+flat in float vRadius;
+flat in vec3 vColor;
+out vec4 FragColor;
+
+void main() {
+  vec3 rd = normalize(vPosVS);
+  float b = dot(rd, vCenterVS);
+  float c = dot(vCenterVS, vCenterVS) - vRadius * vRadius;
+  float h = b * b - c;
+  if (h < 0.0) discard;
+
+  vec3 hit = rd * (b - sqrt(h));
+  vec3 N = (hit - vCenterVS) / vRadius;
+
+  vec4 clip = uProj * vec4(hit, 1.0);
+  gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+
+  FragColor = vec4(shade(vColor, N), 1.0);
+}
+)";
+
+// Packed atoms and octree aggregates as round point sprites, shaded like a
+// sphere seen head-on. Positions are 16-bit normalized over the octree bounds.
+static const char* pointVsSrc = R"(#version 330 core
+layout(location=0) in vec3 aPos;
+layout(location=1) in float aRadius;
+layout(location=2) in vec4 aColor;
+
+out vec3 vColor;
+
+uniform vec3 uOrigin;
+uniform vec3 uExtent;
+
+void main() {
+  vec4 posVS = uView * vec4(uOrigin + aPos * uExtent, 1.0);
+  gl_Position = uProj * posVS;
+  gl_PointSize = max(2.0 * aRadius * uPixelScale / max(-posVS.z, 1e-3), 1.0);
+  vColor = aColor.rgb;
+}
+)";
+
+static const char* pointFsSrc = R"(#version 330 core
+in vec3 vColor;
+out vec4 FragColor;
+
+void main() {
+  vec2 p = gl_PointCoord * 2.0 - 1.0;
+  float r2 = dot(p, p);
+  if (r2 > 1.0) discard;
+  // point coordinates run downward
+  vec3 N = vec3(p.x, -p.y, sqrt(1.0 - r2));
+  FragColor = vec4(shade(vColor, N), 1.0);
+}
+)";
+
+// Attribute layout of PackedInstance for the bound GL_ARRAY_BUFFER.
+static void bindPackedAttribs() {
+  glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedInstance),
+                        (void*)offsetof(PackedInstance, x));
+  glVertexAttribPointer(1, 1, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedInstance),
+                        (void*)offsetof(PackedInstance, radius));
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedInstance),
+                        (void*)offsetof(PackedInstance, r));
+  for (GLuint k = 0; k < 3; k++) {
+    glEnableVertexAttribArray(k);
+  }
+}
+
+// ---------- SphereView ----------
+
+SphereView::SphereView(size_t atomCapacity)
+    : stream(atomCapacity * sizeof(Instance),
+             StreamBuffer::persistentSupported() ? StreamBuffer::Persistent
+                                                 : StreamBuffer::FencedRing) {
+  glGenBuffers(1, &aggregateVBO);
+}
+
+void SphereView::setView(const glm::mat4& v, const glm::mat4& p, int h, float focus) {
+  view = v;
+  proj = p;
+  height = h;
+  focusDistance = focus;
+}
+
+void SphereView::pinFrame(std::vector<Instance>&& instances) {
+  frame = std::move(instances);
+  isPinned = true;
+  instancesChanged = true;
+}
+
+void SphereView::followFrame() {
+  frame = {};
+  isPinned = false;
+  instancesChanged = true;
+}
+
+void SphereView::setUploadMode(StreamBuffer::Mode m) {
+  stream.setMode(m);
+  instancesChanged = true;
+}
+
+void SphereView::release() {
+  stream.release();
+  if (aggregateVBO != 0) {
+    glDeleteBuffers(1, &aggregateVBO);
+    aggregateVBO = 0;
+  }
+}
+
+// ---------- SphereRenderer ----------
+
+SphereRenderer::SphereRenderer(size_t atomCapacity) : primary(atomCapacity) {
+  meshProgram = createProgram(withCameraBlock(withTrajectoryFetch(vsSrc).c_str()).c_str(),
+                              withCameraBlock(fsSrc).c_str());
+  impostorProgram = createProgram(
+      withCameraBlock(withTrajectoryFetch(impostorVsSrc).c_str()).c_str(),
+      withCameraBlock(impostorFsSrc).c_str());
+  meshUniforms = resolveTrajectoryUniforms(meshProgram);
+  impostorUniforms = resolveTrajectoryUniforms(impostorProgram);
+
+  // All LOD levels share one VBO/EBO; indices are pre-offset per level.
+  Mesh sphere;
+  for (size_t l = 0; l < kSphereLodCount; l++) {
+    Mesh level = createSphere(1.0f, kSphereLods[l].sectors, kSphereLods[l].stacks);
+    unsigned int base = (unsigned int)(sphere.vertices.size() / 6);
+    lodIndexFirst[l] = sphere.indices.size();
+    lodIndexCount[l] = level.indices.size();
+    sphere.vertices.insert(sphere.vertices.end(), level.vertices.begin(), level.vertices.end());
+    for (unsigned int index : level.indices) {
+      sphere.indices.push_back(base + index);
+    }
+  }
+
+  glGenVertexArrays(1, &meshVAO);
+  glGenBuffers(1, &meshVBO);
+  glGenBuffers(1, &meshEBO);
+
+  glBindVertexArray(meshVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+  glBufferData(GL_ARRAY_BUFFER,
+               sphere.vertices.size() * sizeof(float),
+               sphere.vertices.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               sphere.indices.size() * sizeof(unsigned int),
+               sphere.indices.data(),
+               GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, primary.stream.buffer());
+  bindInstanceAttribs(0);
+  for (GLuint k = 2; k <= 4; k++) {
+    glEnableVertexAttribArray(k);
+    glVertexAttribDivisor(k, 1);
+  }
+
+  const float quadCorners[8] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+
+  glGenVertexArrays(1, &impostorVAO);
+  glGenBuffers(1, &quadVBO);
+
+  glBindVertexArray(impostorVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quadCorners), quadCorners, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, primary.stream.buffer());
+  bindInstanceAttribs(0);
+  for (GLuint k = 2; k <= 4; k++) {
+    glEnableVertexAttribArray(k);
+    glVertexAttribDivisor(k, 1);
+  }
+
+  pointProgram = createProgram(withCameraBlock(pointVsSrc).c_str(), withCameraBlock(pointFsSrc).c_str());
+  pointOrigin = glGetUniformLocation(pointProgram, "uOrigin");
+  pointExtent = glGetUniformLocation(pointProgram, "uExtent");
+  glGenVertexArrays(1, &packedVAO);
+  glGenBuffers(1, &packedVBO);
+  glBindVertexArray(packedVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, packedVBO);
+  bindPackedAttribs();
+
+  // each view streams its own aggregates; drawOctree() points this at them
+  glGenVertexArrays(1, &aggregateVAO);
+  glBindVertexArray(aggregateVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, primary.aggregateVBO);
+  bindPackedAttribs();
+  glBindVertexArray(0);
+}
+
+void SphereRenderer::release() {
+  primary.release();
+  if (meshVAO != 0) {
+    GLuint arrays[4] = {meshVAO, impostorVAO, packedVAO, aggregateVAO};
+    glDeleteVertexArrays(4, arrays);
+    GLuint buffers[4] = {meshVBO, meshEBO, quadVBO, packedVBO};
+    glDeleteBuffers(4, buffers);
+    glDeleteProgram(meshProgram);
+    glDeleteProgram(impostorProgram);
+    glDeleteProgram(pointProgram);
+    meshVAO = 0;
+  }
+}
+
+// Points the per-instance attributes of the bound VAO at byte offset `base`
+// of the buffer bound to GL_ARRAY_BUFFER. GL 3.3 has no base-instance draws,
+// so stream regions and LOD buckets are selected this way.
+void SphereRenderer::bindInstanceAttribs(size_t base) const {
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                        (void*)(base + offsetof(Instance, x)));
+  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                        (void*)(base + offsetof(Instance, radius)));
+  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                        (void*)(base + offsetof(Instance, r)));
+}
+
+void SphereRenderer::setInstances(std::span<const Instance> instances) {
+  shown.assign(instances.begin(), instances.end());
+  applyHighlight();
+  frameVersion++;
+  octreeStale = true;
+}
+
+void SphereRenderer::swapInstances(std::vector<Instance>& instances) {
+  shown.swap(instances);
+  applyHighlight();
+  frameVersion++;
+  octreeStale = true;
+}
+
+void SphereRenderer::replaceInstances(std::vector<Instance>&& instances, AtomOctree&& built,
+                                      size_t atomCapacity) {
+  highlight = kNoHighlight;
+  shown = std::move(instances);
+  // an octree built from these instances only needs its packed copy uploaded
+  octree = std::move(built);
+  octreeStale = octree.atomCount() != shown.size();
+  packedStale = true;
+  primary.selection.clear();
+  primary.visible = {};
+  primary.lodInstances = {};
+  primary.stream.resize(atomCapacity * sizeof(Instance));
+  sharedVersion = 0;
+  frameVersion++;
+}
+
+void SphereRenderer::setHighlight(size_t index) {
+  if (index == highlight) {
+    return;
+  }
+  if (highlight < shown.size()) {
+    Instance& s = shown[highlight];
+    s.r = highlightSaved[0];
+    s.g = highlightSaved[1];
+    s.b = highlightSaved[2];
+  }
+  highlight = index;
+  applyHighlight();
+  frameVersion++;
+  octreeStale = true;
+}
+
+void SphereRenderer::applyHighlight() {
+  if (highlight >= shown.size()) {
+    return;
+  }
+  Instance& s = shown[highlight];
+  highlightSaved[0] = s.r;
+  highlightSaved[1] = s.g;
+  highlightSaved[2] = s.b;
+  s.r = 1.0f;
+  s.g = 0.85f;
+  s.b = 0.1f;
+}
+
+void SphereRenderer::setGpuTrajectory(const GpuTrajectory* trajectory, double time) {
+  gpuTrajectory = trajectory;
+  primary.gpuTime = time;
+}
+
+void SphereRenderer::prepare(SphereView& v, FrameProfiler* profiler) {
+  const bool gpu = gpuTrajectory != nullptr;
+  const bool isPrimary = &v == &primary;
+  glm::mat4 viewProj = v.proj * v.view;
+  bool cameraChanged = std::memcmp(glm::value_ptr(viewProj), glm::value_ptr(v.lastViewProj),
+                                   sizeof(glm::mat4)) != 0 ||
+                       v.height != v.lastHeight;
+  // GPU playback needs instances in atom order: no culling or LOD sorting.
+  // A pinned frame has no octree and is drawn as culled impostors instead.
+  const bool octreeMode = mode == SphereOctree && !gpu && !v.isPinned;
+  const bool culling = frustumCulling || (mode == SphereOctree && v.isPinned);
+  bool viewDependent = !gpu && (culling || mode == SphereMeshLod || octreeMode);
+  bool settingsChanged = mode != v.lastMode ||
+                         gpu != v.lastGpu ||
+                         culling != v.lastCulling ||
+                         std::bit_cast<uint32_t>(lodBias) != std::bit_cast<uint32_t>(v.lastLodBias) ||
+                         std::bit_cast<uint32_t>(aggregatePixels) != std::bit_cast<uint32_t>(v.lastAggregatePixels) ||
+                         std::bit_cast<uint32_t>(spherePixels) != std::bit_cast<uint32_t>(v.lastSpherePixels);
+  bool instancesChanged = v.instancesChanged || (!v.isPinned && v.lastFrameVersion != frameVersion);
+
+  v.lastViewProj = viewProj;
+  v.lastHeight = v.height;
+  v.lastMode = mode;
+  v.lastGpu = gpu;
+  v.lastCulling = culling;
+  v.lastLodBias = lodBias;
+  v.lastAggregatePixels = aggregatePixels;
+  v.lastSpherePixels = spherePixels;
+  v.lastFrameVersion = frameVersion;
+  v.lastUploadBytes = 0;
+  v.lastUploadMs = 0.0;
+
+  // Atom-order instances are the same for every camera, so other views
+  // following the frame draw the primary view's upload.
+  if (!viewDependent && !v.isPinned && !isPrimary) {
+    v.shared = true;
+    v.drawn = shown.size();
+    if (sharedVersion != frameVersion) {
+      uploadFrame(primary);
+    }
+    return;
+  }
+  v.shared = false;
+
+  if (!instancesChanged && !settingsChanged && !(viewDependent && cameraChanged)) {
+    return;
+  }
+  v.instancesChanged = false;
+
+  if (octreeMode) {
+    if (isPrimary) {
+      sharedVersion = 0;
+    }
+    prepareOctree(v, viewProj, profiler);
+    return;
+  }
+  if (!viewDependent && isPrimary) {
+    uploadFrame(v);
+    return;
+  }
+  if (isPrimary) {
+    sharedVersion = 0;
+  }
+
+  if (profiler != nullptr) {
+    profiler->beginCpu("Cull + LOD");
+  }
+  std::span<const Instance> spheres = v.isPinned ? v.frame : shown;
+  if (!gpu && culling) {
+    v.drawn = cullSpheres(spheres, frustumFromMatrix(viewProj), v.visible);
+    spheres = v.visible;
+  } else {
+    v.drawn = spheres.size();
+  }
+
+  if (mode == SphereMeshLod && !gpu) {
+    float pixelScale = v.proj[1][1] * 0.5f * (float)v.height;
+    v.lodBuckets = v.lodSorter.sort(spheres, v.view, pixelScale, lodBias, v.lodInstances);
+    spheres = v.lodInstances;
+  }
+  if (profiler != nullptr) {
+    profiler->endCpu();
+    profiler->beginCpu("Instance upload");
+  }
+
+  v.instanceOffset = v.stream.upload(spheres.data(), spheres.size() * sizeof(Instance));
+  v.lastUploadBytes = v.stream.bytesUploaded();
+  v.lastUploadMs = v.stream.uploadSeconds() * 1000.0;
+  v.stream.resetStats();
+
+  if (profiler != nullptr) {
+    profiler->endCpu();
+  }
+}
+
+// Uploads the current frame in atom order to the primary stream, where every
+// view that doesn't depend on the camera draws it from.
+void SphereRenderer::uploadFrame(SphereView& v) {
+  primary.instanceOffset = primary.stream.upload(shown.data(), shown.size() * sizeof(Instance));
+  primary.drawn = shown.size();
+  sharedVersion = frameVersion;
+  v.lastUploadBytes = primary.stream.bytesUploaded();
+  v.lastUploadMs = primary.stream.uploadSeconds() * 1000.0;
+  primary.stream.resetStats();
+}
+
+void SphereRenderer::prepareOctree(SphereView& v, const glm::mat4& viewProj,
+                                   FrameProfiler* profiler) {
+  size_t bytes = 0;
+  double seconds = 0.0;
+  if (octreeStale || packedStale) {
+    if (profiler != nullptr) {
+      profiler->beginCpu("Octree refit");
+    }
+    if (octreeStale) {
+      octree.refit(shown);
+    }
+    octreeStale = false;
+    packedStale = false;
+    // the packed atoms only change with the frame, so they are specified
+    // once per frame rather than streamed per view
+    auto start = std::chrono::steady_clock::now();
+    std::span<const PackedInstance> packed = octree.packed();
+    glBindBuffer(GL_ARRAY_BUFFER, packedVBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size_bytes(), packed.data(), GL_STATIC_DRAW);
+    bytes += packed.size_bytes();
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (profiler != nullptr) {
+      profiler->endCpu();
+    }
+  }
+
+  if (profiler != nullptr) {
+    profiler->beginCpu("Octree select");
+  }
+  OctreeQuery query;
+  query.frustum = frustumFromMatrix(viewProj);
+  query.cull = frustumCulling;
+  query.eye = glm::vec3(glm::inverse(v.view)[3]);
+  query.pixelScale = v.proj[1][1] * 0.5f * (float)v.height * lodBias;
+  query.aggregatePixels = aggregatePixels;
+  query.spherePixels = spherePixels;
+  OctreeSelection& selection = v.selection;
+  octree.select(shown, query, selection);
+  v.drawn = selection.points + selection.spheres.size();
+  if (profiler != nullptr) {
+    profiler->endCpu();
+    profiler->beginCpu("Instance upload");
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  glBindBuffer(GL_ARRAY_BUFFER, v.aggregateVBO);
+  glBufferData(GL_ARRAY_BUFFER, selection.aggregates.size() * sizeof(PackedInstance),
+               selection.aggregates.data(), GL_STREAM_DRAW);
+  bytes += selection.aggregates.size() * sizeof(PackedInstance);
+  seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  v.instanceOffset = v.stream.upload(selection.spheres.data(),
+                                     selection.spheres.size() * sizeof(Instance));
+  v.lastUploadBytes = bytes + v.stream.bytesUploaded();
+  v.lastUploadMs = (seconds + v.stream.uploadSeconds()) * 1000.0;
+  v.stream.resetStats();
+
+  if (profiler != nullptr) {
+    profiler->endCpu();
+  }
+}
+
+SphereRenderer::TrajectoryUniforms SphereRenderer::resolveTrajectoryUniforms(GLuint program) {
+  TrajectoryUniforms u;
+  u.gpu = glGetUniformLocation(program, "uGpuTrajectory");
+  u.time = glGetUniformLocation(program, "uTime");
+  u.frameCount = glGetUniformLocation(program, "uFrameCount");
+  u.atomCount = glGetUniformLocation(program, "uAtomCount");
+  u.origin = glGetUniformLocation(program, "uOrigin");
+  u.extent = glGetUniformLocation(program, "uExtent");
+  // the frames always come from texture unit 1
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "uFrames"), 1);
+  glUseProgram(0);
+  return u;
+}
+
+void SphereRenderer::setTrajectoryUniforms(const TrajectoryUniforms& u, double time) const {
+  const bool gpu = gpuTrajectory != nullptr;
+  glUniform1i(u.gpu, gpu ? 1 : 0);
+  if (!gpu) {
+    return;
+  }
+  gpuTrajectory->bind(GL_TEXTURE1);
+  glUniform1f(u.time, (float)time);
+  glUniform1i(u.frameCount, (GLint)gpuTrajectory->frameCount());
+  glUniform1i(u.atomCount, (GLint)gpuTrajectory->atomCount());
+  glUniform3fv(u.origin, 1, gpuTrajectory->origin());
+  glUniform3fv(u.extent, 1, gpuTrajectory->extent());
+}
+
+void SphereRenderer::draw(SphereView& v) {
+  if (mode == SphereOctree && gpuTrajectory == nullptr && !v.isPinned) {
+    drawOctree(v);
+    return;
+  }
+  glUseProgram(mode == SphereMeshLod ? meshProgram : impostorProgram);
+  setTrajectoryUniforms(mode == SphereMeshLod ? meshUniforms : impostorUniforms, v.gpuTime);
+
+  SphereView& source = v.shared ? primary : v;
+  const size_t instanceOffset = source.instanceOffset;
+  glBindBuffer(GL_ARRAY_BUFFER, source.stream.buffer());
+  if (mode == SphereMeshLod && gpuTrajectory != nullptr) {
+    // One level for the whole system, picked for a typical atom at the
+    // orbit target, since per-atom positions only exist on the GPU.
+    float pixels = 0.2f * lodBias * v.proj[1][1] * 0.5f * (float)v.height / v.focusDistance;
+    size_t l = 0;
+    while (pixels < kSphereLods[l].minPixels) {
+      l++;
+    }
+    glBindVertexArray(meshVAO);
+    bindInstanceAttribs(instanceOffset);
+    glDrawElementsInstanced(GL_TRIANGLES,
+                            (GLsizei)lodIndexCount[l],
+                            GL_UNSIGNED_INT,
+                            (void*)(lodIndexFirst[l] * sizeof(unsigned int)),
+                            (GLsizei)v.drawn);
+  } else if (mode == SphereMeshLod) {
+    glBindVertexArray(meshVAO);
+    for (size_t l = 0; l < kSphereLodCount; l++) {
+      if (v.lodBuckets.count[l] == 0) {
+        continue;
+      }
+      bindInstanceAttribs(instanceOffset + v.lodBuckets.first[l] * sizeof(Instance));
+      glDrawElementsInstanced(GL_TRIANGLES,
+                              (GLsizei)lodIndexCount[l],
+                              GL_UNSIGNED_INT,
+                              (void*)(lodIndexFirst[l] * sizeof(unsigned int)),
+                              (GLsizei)v.lodBuckets.count[l]);
+    }
+  } else {
+    glBindVertexArray(impostorVAO);
+    bindInstanceAttribs(instanceOffset);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)v.drawn);
+  }
+  glBindVertexArray(0);
+  source.stream.fence();
+}
+
+void SphereRenderer::drawOctree(SphereView& v) {
+  const OctreeSelection& selection = v.selection;
+  // near leaves as impostors
+  glUseProgram(impostorProgram);
+  setTrajectoryUniforms(impostorUniforms, v.gpuTime);
+  if (!selection.spheres.empty()) {
+    glBindBuffer(GL_ARRAY_BUFFER, v.stream.buffer());
+    glBindVertexArray(impostorVAO);
+    bindInstanceAttribs(v.instanceOffset);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)selection.spheres.size());
+  }
+
+  // everything else as point sprites
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  glUseProgram(pointProgram);
+  glUniform3fv(pointOrigin, 1, octree.origin());
+  glUniform3fv(pointExtent, 1, octree.extent());
+  if (!selection.pointFirst.empty()) {
+    glBindVertexArray(packedVAO);
+    glMultiDrawArrays(GL_POINTS, selection.pointFirst.data(), selection.pointCount.data(),
+                      (GLsizei)selection.pointFirst.size());
+  }
+  if (!selection.aggregates.empty()) {
+    glBindVertexArray(aggregateVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, v.aggregateVBO);
+    bindPackedAttribs();
+    glDrawArrays(GL_POINTS, 0, (GLsizei)selection.aggregates.size());
+  }
+  glDisable(GL_PROGRAM_POINT_SIZE);
+  glBindVertexArray(0);
+  v.stream.fence();
+}
@@ -0,0 +1,144 @@
+#include "stream_buffer.hpp"
+
+#include <chrono>
+#include <cstring>
+
+static constexpr size_t kAlignment = 256;
+
+static size_t alignUp(size_t n) {
+  return (n + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+static void waitAndDelete(GLsync& sync) {
+  if (sync == nullptr) {
+    return;
+  }
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  for (;;) {
+    GLenum r = glClientWaitSync(sync, flags, 1000000);
+    if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED || r == GL_WAIT_FAILED) {
+      break;
+    }
+    flags = 0;
+  }
+  glDeleteSync(sync);
+  sync = nullptr;
+}
+
+StreamBuffer::StreamBuffer(size_t capacity, Mode mode)
+    : current(mode), regionSize(alignUp(capacity > 0 ? capacity : 1)) {
+  if (current == Persistent && !persistentSupported()) {
+    current = FencedRing;
+  }
+  create();
+}
+
+StreamBuffer::~StreamBuffer() {
+  release();
+}
+
+bool StreamBuffer::persistentSupported() {
+  return GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr;
+}
+
+void StreamBuffer::create() {
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  region = 0;
+
+  if (current == Orphan) {
+    glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+  } else if (current == FencedRing) {
+    glBufferData(GL_ARRAY_BUFFER, regionSize * kRegions, nullptr, GL_STREAM_DRAW);
+  } else {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, regionSize * kRegions, nullptr, flags);
+    mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * kRegions, flags);
+  }
+}
+
+void StreamBuffer::release() {
+  for (GLsync& sync : fences) {
+    waitAndDelete(sync);
+  }
+  if (vbo != 0) {
+    if (mapped != nullptr) {
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+      mapped = nullptr;
+    }
+    glDeleteBuffers(1, &vbo);
+    vbo = 0;
+  }
+}
+
+void StreamBuffer::setMode(Mode mode) {
+  if (mode == Persistent && !persistentSupported()) {
+    mode = FencedRing;
+  }
+  if (mode == current) {
+    return;
+  }
+  release();
+  current = mode;
+  create();
+}
+
+size_t StreamBuffer::upload(const void* data, size_t n) {
+  auto start = std::chrono::steady_clock::now();
+
+  if (n > regionSize) {
+    release();
+    regionSize = alignUp(n + n / 2);
+    create();
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+  size_t offset = 0;
+  if (current == Orphan) {
+    glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, n, data);
+  } else {
+    region = (region + 1) % kRegions;
+    waitAndDelete(fences[region]);
+    offset = region * regionSize;
+
+    if (current == Persistent) {
+      std::memcpy(mapped + offset, data, n);
+    } else if (n > 0) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+      void* dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, n, flags);
+      std::memcpy(dst, data, n);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+  }
+
+  bytes += n;
+  seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return offset;
+}
+
+void StreamBuffer::resize(size_t capacity) {
+  size_t size = alignUp(capacity > 0 ? capacity : 1);
+  if (size == regionSize) {
+    return;
+  }
+  release();
+  regionSize = size;
+  create();
+}
+
+void StreamBuffer::fence() {
+  if (current == Orphan) {
+    return;
+  }
+  if (fences[region] != nullptr) {
+    glDeleteSync(fences[region]);
+  }
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamBuffer::resetStats() {
+  bytes = 0;
+  seconds = 0.0;
+}
@@ -0,0 +1,206 @@
+#include "trajectory.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "periodic.hpp"
+#include "xyz_parser.hpp"
+
+bool FrameSource::periodicBox(float box[3]) const {
+  float cell[9];
+  return unitCell(cell) && orthorhombicLengths(cell, box);
+}
+
+XyzTrajectory::XyzTrajectory(const std::string& filename, LoadProgress* progress)
+  : file(filename) {
+  offsets = indexXyzFrames(file.data(), file.size(), natoms, SIZE_MAX, progress);
+  hasLattice = parseXyzLattice(file.data(), file.size(), offsets[0], lattice);
+}
+
+bool XyzTrajectory::unitCell(float cell[9]) const {
+  if (hasLattice) {
+    std::copy(lattice, lattice + 9, cell);
+  }
+  return hasLattice;
+}
+
+void XyzTrajectory::readMolecule(size_t index, Molecule& out, LoadProgress* progress) {
+  parseXyzFrame(file.data(), file.size(), offsets.at(index), natoms, out, progress);
+}
+
+void XyzTrajectory::readFrame(size_t index, std::vector<Instance>& out) {
+  readMolecule(index, frame);
+
+  out.resize(natoms);
+  toDraw(frame, out);
+}
+
+RandomWalkSource::RandomWalkSource(const Molecule& mol, size_t frames, uint64_t seed,
+                                   unsigned threads)
+  : walk(mol, seed, 0.05f, threads), frames(frames) {}
+
+void RandomWalkSource::readFrame(size_t index, std::vector<Instance>& out) {
+  const Molecule& current = walk.seek(index);
+  out.resize(current.size());
+  toDraw(current, out);
+}
+
+void RandomWalkSource::setUnitCell(const float cell[9]) {
+  std::copy(cell, cell + 9, lattice);
+  hasLattice = true;
+}
+
+bool RandomWalkSource::unitCell(float cell[9]) const {
+  if (hasLattice) {
+    std::copy(lattice, lattice + 9, cell);
+  }
+  return hasLattice;
+}
+
+TrajectoryStreamer::TrajectoryStreamer(std::unique_ptr<FrameSource> source, size_t capacity,
+                                       size_t cacheBytes)
+  : source(std::move(source)) {
+  count = this->source->frameCount();
+  if (count == 0) {
+    throw std::runtime_error("Trajectory has no frames.\n");
+  }
+  ahead = std::max<size_t>(1, std::min(capacity, count));
+  size_t frameBytes = std::max<size_t>(1, this->source->atomCount() * sizeof(Instance));
+  size_t cached = std::min({cacheBytes / frameBytes, count - ahead, kMaxCachedFrames});
+  slots.resize(ahead + cached);
+  resident.reserve(slots.size());
+  for (size_t i = slots.size(); i-- > 0;) {
+    empty.push_back(i);
+  }
+  worker = std::thread(&TrajectoryStreamer::run, this);
+}
+
+TrajectoryStreamer::~TrajectoryStreamer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+bool TrajectoryStreamer::inWindow(size_t frame) const {
+  // the window [playhead, playhead + slots) wraps around for looping
+  return (frame + count - playhead) % count < ahead;
+}
+
+// Moves the playhead to `frame` and looks it up; the mutex must be held.
+const std::vector<Instance>* TrajectoryStreamer::find(size_t frame) {
+  if (frame != playhead) {
+    playhead = frame;
+    wake.notify_one();
+  }
+  auto it = resident.find(frame);
+  if (it == resident.end() || slots[it->second].state != SlotState::Ready) {
+    return nullptr;
+  }
+  Slot& s = slots[it->second];
+  recent.splice(recent.begin(), recent, s.use);
+  return &s.instances;
+}
+
+const std::vector<Instance>* TrajectoryStreamer::acquire(size_t frame) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return find(frame % count);
+}
+
+const std::vector<Instance>* TrajectoryStreamer::acquire(size_t frame,
+                                                         std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  frame %= count;
+  const std::vector<Instance>* instances = nullptr;
+  decoded.wait_for(lock, timeout, [&] {
+    instances = find(frame);
+    return instances != nullptr || !failure.empty();
+  });
+  return instances;
+}
+
+void TrajectoryStreamer::fetch(size_t frame, std::vector<Instance>& out) {
+  frame %= count;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = resident.find(frame);
+    if (it != resident.end() && slots[it->second].state == SlotState::Ready) {
+      Slot& s = slots[it->second];
+      recent.splice(recent.begin(), recent, s.use);
+      out = s.instances;
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> reading(sourceMutex);
+  source->readFrame(frame, out);
+}
+
+std::string TrajectoryStreamer::error() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return failure;
+}
+
+void TrajectoryStreamer::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    // nearest frame ahead of the playhead that no slot holds yet
+    size_t frame = 0;
+    bool missing = false;
+    for (size_t k = 0; k < ahead && !missing; k++) {
+      frame = (playhead + k) % count;
+      missing = !resident.contains(frame);
+    }
+
+    // an empty slot, else the least recently used frame behind the window;
+    // at most `ahead` Ready frames are in the window, so the walk is short
+    size_t victim = slots.size();
+    if (missing) {
+      if (!empty.empty()) {
+        victim = empty.back();
+        empty.pop_back();
+      } else {
+        for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+          if (!inWindow(slots[*it].frame)) {
+            victim = *it;
+            recent.erase(std::next(it).base());
+            resident.erase(slots[victim].frame);
+            break;
+          }
+        }
+      }
+    }
+    if (victim == slots.size()) {
+      wake.wait(lock);
+      continue;
+    }
+
+    // The victim is out of `recent` and no longer maps to its old frame, and
+    // it is not the playhead's frame, the only one a caller may still hold
+    // from acquire(). It can be refilled without holding the lock.
+    Slot& slot = slots[victim];
+    slot.frame = frame;
+    slot.state = SlotState::Filling;
+    resident[frame] = victim;
+    lock.unlock();
+    try {
+      std::lock_guard<std::mutex> reading(sourceMutex);
+      source->readFrame(frame, slot.instances);
+    } catch (const std::exception& e) {
+      lock.lock();
+      slot.state = SlotState::Empty;
+      resident.erase(frame);
+      empty.push_back(victim);
+      failure = e.what();
+      decoded.notify_all();
+      return;
+    }
+    lock.lock();
+    slot.state = SlotState::Ready;
+    recent.push_front(victim);
+    slot.use = recent.begin();
+    decoded.notify_all();
+  }
+}
@@ -0,0 +1,67 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned threads) : threads(threads) {
+  if (this->threads == 0) {
+    this->threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start.notify_all();
+  for (std::thread& t : workers) {
+    t.join();
+  }
+}
+
+void WorkerPool::run(unsigned count, const std::function<void(unsigned)>& task) {
+  count = std::min(count, threads);
+  if (count <= 1) {
+    if (count == 1) {
+      task(0);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned t = (unsigned)workers.size() + 1; t < threads; t++) {
+      workers.emplace_back(&WorkerPool::work, this, t);
+    }
+    current = &task;
+    active = count;
+    pending = count - 1;
+    generation++;
+  }
+  start.notify_all();
+  task(0);
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&] { return pending == 0; });
+  current = nullptr;
+}
+
+void WorkerPool::work(unsigned index) {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    start.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping) {
+      return;
+    }
+    seen = generation;
+    if (index >= active) {
+      continue;
+    }
+    const std::function<void(unsigned)>* task = current;
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+    if (--pending == 0) {
+      done.notify_one();
+    }
+  }
+}
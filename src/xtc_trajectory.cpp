@@ -0,0 +1,403 @@
+#include "xtc_trajectory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+// XDR is big-endian.
+static uint32_t loadBE(const char* p) {
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+  return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | (uint32_t)b[3];
+}
+
+static float loadFloatBE(const char* p) {
+  return std::bit_cast<float>(loadBE(p));
+}
+
+static constexpr uint32_t kXtcMagic = 1995;
+
+// magic, natoms, step, time, box[9], natoms again
+static constexpr size_t kFrameHeader = 56;
+// precision, minint[3], maxint[3], smallidx, byte count
+static constexpr size_t kCompressedHeader = 36;
+// Up to this many atoms the coordinates are stored as plain floats.
+static constexpr size_t kUncompressedAtoms = 9;
+
+// Sizes of the small-difference ranges; a range's index is also the bit
+// count of three values in it.
+static constexpr int kMagicInts[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 10, 12, 16, 20, 25, 32, 40, 50, 64,
+  80, 101, 128, 161, 203, 256, 322, 406, 512, 645, 812, 1024, 1290,
+  1625, 2048, 2580, 3250, 4096, 5060, 6501, 8192, 10321, 13003,
+  16384, 20642, 26007, 32768, 41285, 52015, 65536, 82570, 104031,
+  131072, 165140, 208063, 262144, 330280, 416127, 524287, 660561,
+  832255, 1048576, 1321122, 1664510, 2097152, 2642245, 3329021,
+  4194304, 5284491, 6658042, 8388607, 10568983, 13316085, 16777216
+};
+static constexpr int kFirstIdx = 9;
+static constexpr int kLastIdx = (int)(sizeof(kMagicInts) / sizeof(kMagicInts[0]));
+
+struct XtcIndexHeader {
+  char magic[8];
+  uint64_t fileSize;
+  int64_t mtime;
+  uint64_t natoms;
+  uint64_t nframes;
+};
+
+constexpr char kXtcIndexMagic[8] = {'C', 'K', 'X', 'T', 'C', 'I', 'D', 'X'};
+
+static std::runtime_error corruptFrame() {
+  return std::runtime_error("Corrupt XTC frame\n");
+}
+
+// Most-significant-bit-first reader over the compressed bytes of one frame.
+class BitReader {
+public:
+  BitReader(const unsigned char* data, size_t size) : p(data), end(data + size) {}
+
+  // 0 <= bits <= 32
+  uint32_t read(int bits) {
+    if (count < bits) {
+      while (count <= 56 && p < end) {
+        buffer = buffer << 8 | *p++;
+        count += 8;
+      }
+      if (count < bits) {
+        throw corruptFrame();
+      }
+    }
+    count -= bits;
+    return (uint32_t)((buffer >> count) & ((uint64_t(1) << bits) - 1));
+  }
+
+private:
+  const unsigned char* p;
+  const unsigned char* end;
+  uint64_t buffer = 0;
+  int count = 0;
+};
+
+// Bits needed for values in [0, size).
+static int bitsFor(uint32_t size) {
+  int bits = 0;
+  uint64_t num = 1;
+  while (size >= num && bits < 32) {
+    bits++;
+    num <<= 1;
+  }
+  return bits;
+}
+
+// Bits needed for the mixed-radix number of three values in [0, sizes[k]).
+static int bitsForProduct(const uint32_t sizes[3]) {
+  uint8_t bytes[16] = {1};
+  int count = 1;
+  for (int k = 0; k < 3; k++) {
+    uint64_t carry = 0;
+    for (int b = 0; b < count; b++) {
+      carry += (uint64_t)bytes[b] * sizes[k];
+      bytes[b] = (uint8_t)carry;
+      carry >>= 8;
+    }
+    for (; carry != 0; carry >>= 8) {
+      bytes[count++] = (uint8_t)carry;
+    }
+  }
+  int bits = 0;
+  for (unsigned num = 1; bytes[count - 1] >= num; num *= 2) {
+    bits++;
+  }
+  return bits + (count - 1) * 8;
+}
+
+// Reads three values packed as one mixed-radix number of `bits` bits, sent
+// least significant byte first.
+static void readInts(BitReader& in, int bits, const uint32_t sizes[3], int32_t out[3]) {
+  uint8_t bytes[16] = {};
+  int count = 0;
+  for (; bits > 8; bits -= 8) {
+    bytes[count++] = (uint8_t)in.read(8);
+  }
+  if (bits > 0) {
+    bytes[count++] = (uint8_t)in.read(bits);
+  }
+
+  if (count <= 8) {
+    uint64_t v = 0;
+    for (int b = 0; b < count; b++) {
+      v |= (uint64_t)bytes[b] << (8 * b);
+    }
+    out[2] = (int32_t)(v % sizes[2]);
+    v /= sizes[2];
+    out[1] = (int32_t)(v % sizes[1]);
+    out[0] = (int32_t)(v / sizes[1]);
+    return;
+  }
+  // wider than 64 bits: long division on the bytes
+  for (int k = 2; k > 0; k--) {
+    uint64_t rem = 0;
+    for (int b = count - 1; b >= 0; b--) {
+      rem = rem << 8 | bytes[b];
+      bytes[b] = (uint8_t)(rem / sizes[k]);
+      rem %= sizes[k];
+    }
+    out[k] = (int32_t)rem;
+  }
+  out[0] = (int32_t)(bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+}
+
+bool isXtcFile(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  char head[8] = {};
+  in.read(head, sizeof(head));
+  return in && loadBE(head) == kXtcMagic && loadBE(head + 4) > 0;
+}
+
+XtcTrajectory::XtcTrajectory(const std::string& filename, const Molecule& topology,
+                             LoadProgress* progress)
+  : file(filename), name(filename) {
+  if (file.size() < kFrameHeader || loadBE(file.data()) != kXtcMagic) {
+    throw std::runtime_error("Not an XTC file: " + filename + "\n");
+  }
+  natoms = loadBE(file.data() + 4);
+  if (natoms != topology.size()) {
+    throw std::runtime_error("Topology has " + std::to_string(topology.size()) +
+                             " atoms but " + filename + " has " + std::to_string(natoms) + "\n");
+  }
+
+  std::error_code ec;
+  int64_t mtime = (int64_t)std::filesystem::last_write_time(filename, ec).time_since_epoch().count();
+  const std::string indexPath = filename + ".ckidx";
+  cached = loadIndex(indexPath, mtime);
+  if (!cached) {
+    buildIndex(progress);
+    saveIndex(indexPath, mtime);
+  }
+  if (offsets.empty()) {
+    throw std::runtime_error("Truncated XTC file: " + filename + "\n");
+  }
+
+  style.resize(natoms);
+  toDraw(topology, style);
+}
+
+bool XtcTrajectory::loadIndex(const std::string& indexPath, int64_t mtime) {
+  std::ifstream in(indexPath, std::ios::binary);
+  XtcIndexHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    return false;
+  }
+  if (std::memcmp(header.magic, kXtcIndexMagic, sizeof(header.magic)) != 0 ||
+      header.fileSize != file.size() || header.mtime != mtime || header.natoms != natoms ||
+      header.nframes > file.size() / kFrameHeader) {
+    return false;
+  }
+  offsets.resize(header.nframes);
+  if (!in.read(reinterpret_cast<char*>(offsets.data()),
+               (std::streamsize)(offsets.size() * sizeof(uint64_t)))) {
+    offsets.clear();
+    return false;
+  }
+  return true;
+}
+
+// Written to a temporary name and renamed, so a concurrent open never reads
+// half an index. Failure (e.g. a read-only directory) only costs the rescan.
+void XtcTrajectory::saveIndex(const std::string& indexPath, int64_t mtime) const {
+  XtcIndexHeader header;
+  std::memcpy(header.magic, kXtcIndexMagic, sizeof(header.magic));
+  header.fileSize = file.size();
+  header.mtime = mtime;
+  header.natoms = natoms;
+  header.nframes = offsets.size();
+
+  const std::string tmpPath = indexPath + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(offsets.data()),
+              (std::streamsize)(offsets.size() * sizeof(uint64_t)));
+    if (!out) {
+      std::error_code ec;
+      std::filesystem::remove(tmpPath, ec);
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, indexPath, ec);
+}
+
+// Only the headers are read: the byte count of each frame's compressed data
+// leads to the next one.
+void XtcTrajectory::buildIndex(LoadProgress* progress) {
+  const char* data = file.data();
+  const size_t size = file.size();
+  if (progress != nullptr) {
+    progress->begin("Indexing frames", size);
+  }
+
+  size_t pos = 0;
+  while (pos + kFrameHeader <= size) {
+    if (loadBE(data + pos) != kXtcMagic || loadBE(data + pos + 4) != natoms ||
+        loadBE(data + pos + kFrameHeader - 4) != natoms) {
+      throw std::runtime_error("Corrupt XTC frame " + std::to_string(offsets.size()) + " in " +
+                               name + "\n");
+    }
+    size_t bytes;
+    if (natoms <= kUncompressedAtoms) {
+      bytes = kFrameHeader + 12 * natoms;
+    } else {
+      if (pos + kFrameHeader + kCompressedHeader > size) {
+        break;
+      }
+      size_t compressed = loadBE(data + pos + kFrameHeader + kCompressedHeader - 4);
+      bytes = kFrameHeader + kCompressedHeader + (compressed + 3) / 4 * 4;
+    }
+    // the last frame of an interrupted run may be partial
+    if (pos + bytes > size) {
+      break;
+    }
+    offsets.push_back(pos);
+    pos += bytes;
+    if (progress != nullptr && offsets.size() % 1024 == 0) {
+      progress->advance(pos);
+    }
+  }
+}
+
+bool XtcTrajectory::unitCell(float cell[9]) const {
+  // magic, natoms, step, time, then the box vectors in nm
+  const char* box = file.data() + offsets[0] + 16;
+  bool any = false;
+  for (int k = 0; k < 9; k++) {
+    cell[k] = 10.0f * loadFloatBE(box + 4 * k);
+    any |= std::fabs(cell[k]) > 0.0f;
+  }
+  return any;
+}
+
+void XtcTrajectory::readFrame(size_t index, std::vector<Instance>& out) {
+  if (index >= offsets.size()) {
+    throw std::out_of_range("XTC frame " + std::to_string(index) + " out of range\n");
+  }
+  if (out.size() != natoms) {
+    out = style;
+  }
+  const char* frame = file.data() + offsets[index];
+  const char* p = frame + kFrameHeader;
+
+  // nm to Angstrom
+  if (natoms <= kUncompressedAtoms) {
+    for (size_t i = 0; i < natoms; i++) {
+      out[i].x = 10.0f * loadFloatBE(p + 12 * i);
+      out[i].y = 10.0f * loadFloatBE(p + 12 * i + 4);
+      out[i].z = 10.0f * loadFloatBE(p + 12 * i + 8);
+    }
+    return;
+  }
+
+  const float scale = 10.0f / loadFloatBE(p);
+  int32_t minint[3];
+  uint32_t sizeint[3];
+  for (int k = 0; k < 3; k++) {
+    minint[k] = (int32_t)loadBE(p + 4 + 4 * k);
+    sizeint[k] = loadBE(p + 16 + 4 * k) - (uint32_t)minint[k] + 1;
+  }
+  // ranges too wide to multiply are sent as three separate fields
+  int bitsize = 0;
+  int bitsizeint[3] = {0, 0, 0};
+  if ((sizeint[0] | sizeint[1] | sizeint[2]) > 0xffffff) {
+    for (int k = 0; k < 3; k++) {
+      bitsizeint[k] = bitsFor(sizeint[k]);
+    }
+  } else {
+    bitsize = bitsForProduct(sizeint);
+  }
+
+  int smallidx = (int32_t)loadBE(p + 28);
+  if (smallidx < kFirstIdx || smallidx >= kLastIdx) {
+    throw corruptFrame();
+  }
+  int smaller = kMagicInts[std::max(kFirstIdx, smallidx - 1)] / 2;
+  int smallnum = kMagicInts[smallidx] / 2;
+  uint32_t sizesmall[3];
+  std::fill(sizesmall, sizesmall + 3, (uint32_t)kMagicInts[smallidx]);
+
+  const size_t compressed = loadBE(p + 32);
+  BitReader in(reinterpret_cast<const unsigned char*>(p + kCompressedHeader), compressed);
+
+  size_t written = 0;
+  auto emit = [&](const int32_t c[3]) {
+    if (written == natoms) {
+      throw corruptFrame();
+    }
+    Instance& a = out[written++];
+    a.x = (float)c[0] * scale;
+    a.y = (float)c[1] * scale;
+    a.z = (float)c[2] * scale;
+  };
+
+  // Each step is one full-range atom, optionally followed by a run of atoms
+  // stored as small differences from their predecessor. The run length only
+  // appears in the stream when it changes.
+  int run = 0;
+  while (written < natoms) {
+    int32_t prev[3];
+    if (bitsize == 0) {
+      for (int k = 0; k < 3; k++) {
+        prev[k] = (int32_t)in.read(bitsizeint[k]);
+      }
+    } else {
+      readInts(in, bitsize, sizeint, prev);
+    }
+    for (int k = 0; k < 3; k++) {
+      prev[k] = (int32_t)((uint32_t)prev[k] + (uint32_t)minint[k]);
+    }
+
+    int isSmaller = 0;
+    if (in.read(1) == 1) {
+      run = (int)in.read(5);
+      isSmaller = run % 3;
+      run -= isSmaller;
+      isSmaller--;
+    }
+
+    if (run == 0) {
+      emit(prev);
+    }
+    for (int k = 0; k < run; k += 3) {
+      int32_t c[3];
+      readInts(in, smallidx, sizesmall, c);
+      for (int d = 0; d < 3; d++) {
+        c[d] += prev[d] - smallnum;
+      }
+      if (k == 0) {
+        // the writer swaps the first two atoms of a run (water O and H), so
+        // the full-range atom is the second one
+        emit(c);
+        emit(prev);
+      } else {
+        emit(c);
+      }
+      std::copy(c, c + 3, prev);
+    }
+
+    smallidx += isSmaller;
+    if (smallidx < kFirstIdx || smallidx >= kLastIdx) {
+      throw corruptFrame();
+    }
+    if (isSmaller < 0) {
+      smallnum = smaller;
+      smaller = smallidx > kFirstIdx ? kMagicInts[smallidx - 1] / 2 : 0;
+    } else if (isSmaller > 0) {
+      smaller = smallnum;
+      smallnum = kMagicInts[smallidx] / 2;
+    }
+    std::fill(sizesmall, sizesmall + 3, (uint32_t)kMagicInts[smallidx]);
+  }
+}
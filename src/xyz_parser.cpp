@@ -0,0 +1,203 @@
+#include "xyz_parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string_view>
+#include <strings.h>
+#include <thread>
+
+#include "mapped_file.hpp"
+
+static const char* skipSpaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+static const char* nextLine(const char* p, const char* end) {
+  const void* nl = std::memchr(p, '\n', (size_t)(end - p));
+  return nl != nullptr ? static_cast<const char*>(nl) + 1 : end;
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+  p = skipSpaces(p, end);
+  if (p < end && *p == '+') {
+    p++;
+  }
+  auto [ptr, ec] = std::from_chars(p, end, value);
+  return ec == std::errc() ? ptr : nullptr;
+}
+
+static std::runtime_error atomCountMismatch(size_t natoms, size_t found) {
+  return std::runtime_error(
+    "Number of atoms not equal to mol.atoms: " + std::to_string(natoms) + " : " + std::to_string(found)
+  );
+}
+
+// Atoms between progress reports within one frame.
+static constexpr size_t kProgressAtoms = 1 << 16;
+
+std::vector<size_t> indexXyzFrames(const char* data, size_t size, size_t& natoms, size_t maxFrames,
+                                   LoadProgress* progress) {
+  const char* p = data;
+  const char* end = data + size;
+  std::vector<size_t> offsets;
+  if (progress != nullptr) {
+    progress->begin("Indexing frames", size);
+  }
+
+  while (offsets.size() < maxFrames) {
+    // blank lines between frames are tolerated
+    const char* q = skipSpaces(p, end);
+    while (q < end && *q == '\n') {
+      p = q + 1;
+      q = skipSpaces(p, end);
+    }
+    if (q == end) {
+      break;
+    }
+
+    size_t n = 0;
+    auto [ptr, ec] = std::from_chars(q, end, n);
+    if (ec != std::errc()) {
+      throw std::runtime_error("Failed to read atom count.\n");
+    }
+    if (offsets.empty()) {
+      natoms = n;
+    } else if (n != natoms) {
+      throw std::runtime_error(
+        "Frame " + std::to_string(offsets.size()) + " atom count differs from first frame: "
+        + std::to_string(n) + " : " + std::to_string(natoms)
+      );
+    }
+    offsets.push_back((size_t)(p - data));
+
+    // comment line + one line per atom
+    p = nextLine(ptr, end);
+    for (size_t i = 0; i <= n; i++) {
+      if (p == end) {
+        throw atomCountMismatch(n, i == 0 ? 0 : i - 1);
+      }
+      p = nextLine(p, end);
+      if (progress != nullptr && i % kProgressAtoms == kProgressAtoms - 1) {
+        progress->advance((size_t)(p - data));
+      }
+    }
+    if (progress != nullptr) {
+      progress->advance((size_t)(p - data));
+    }
+  }
+
+  if (offsets.empty()) {
+    throw std::runtime_error("Failed to read atom count.\n");
+  }
+  return offsets;
+}
+
+void parseXyzFrame(const char* data, size_t size, size_t offset, size_t natoms, Molecule& out,
+                   LoadProgress* progress) {
+  const char* end = data + size;
+  const char* p = nextLine(data + offset, end);
+  p = nextLine(p, end);
+  if (progress != nullptr) {
+    progress->begin("Parsing atoms", natoms);
+  }
+
+  out.resize(natoms);
+  for (size_t i = 0; i < natoms; i++) {
+    if (progress != nullptr && i % kProgressAtoms == 0) {
+      progress->advance(i);
+    }
+    const char* line = nextLine(p, end);
+
+    const char* sym = skipSpaces(p, line);
+    const char* symEnd = sym;
+    while (symEnd < line && *symEnd != ' ' && *symEnd != '\t' && *symEnd != '\r' && *symEnd != '\n') {
+      symEnd++;
+    }
+
+    const char* q = symEnd;
+    if (sym == symEnd
+        || (q = parseFloat(q, line, out.x[i])) == nullptr
+        || (q = parseFloat(q, line, out.y[i])) == nullptr
+        || (q = parseFloat(q, line, out.z[i])) == nullptr) {
+      throw atomCountMismatch(natoms, i);
+    }
+    out.atomicNumbers[i] = (uint8_t)atomicNumber(std::string_view(sym, (size_t)(symEnd - sym)));
+
+    p = line;
+  }
+}
+
+bool parseXyzLattice(const char* data, size_t size, size_t offset, float cell[9]) {
+  const char* end = data + size;
+  const char* comment = nextLine(data + offset, end);
+  std::string_view line(comment, (size_t)(nextLine(comment, end) - comment));
+
+  // the key is case-insensitive in the extended XYZ specification
+  size_t key = std::string_view::npos;
+  for (size_t i = 0; i + 9 <= line.size(); i++) {
+    if (strncasecmp(line.data() + i, "Lattice=\"", 9) == 0) {
+      key = i;
+      break;
+    }
+  }
+  if (key == std::string_view::npos) {
+    return false;
+  }
+  const char* p = line.data() + key + 9;
+  const char* close = line.data() + line.size();
+  float parsed[9];
+  for (float& v : parsed) {
+    if ((p = parseFloat(p, close, v)) == nullptr) {
+      return false;
+    }
+  }
+  std::copy(parsed, parsed + 9, cell);
+  return true;
+}
+
+std::vector<Molecule> read_xyz_frames(const std::string& filename, unsigned threads) {
+  MappedFile file(filename);
+  size_t natoms = 0;
+  std::vector<size_t> offsets = indexXyzFrames(file.data(), file.size(), natoms);
+
+  std::vector<Molecule> frames(offsets.size());
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = (unsigned)std::min<size_t>(threads, frames.size());
+
+  std::vector<std::exception_ptr> errors(threads);
+  auto work = [&](unsigned t) {
+    size_t begin = frames.size() * t / threads;
+    size_t end = frames.size() * (t + 1) / threads;
+    try {
+      for (size_t f = begin; f < end; f++) {
+        parseXyzFrame(file.data(), file.size(), offsets[f], natoms, frames[f]);
+      }
+    } catch (...) {
+      errors[t] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++) {
+    pool.emplace_back(work, t);
+  }
+  work(0);
+  for (std::thread& th : pool) {
+    th.join();
+  }
+
+  for (const std::exception_ptr& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+  return frames;
+}
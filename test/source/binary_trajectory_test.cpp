@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+
+#include "binary_trajectory.hpp"
+#include "check.hpp"
+#include "trajectory.hpp"
+
+// Three frames of four atoms, with coordinates that need all of float's
+// digits so the plain format has to round-trip them exactly.
+static std::string threeFrames() {
+  std::ostringstream xyz;
+  xyz.precision(9);
+  for (int f = 0; f < 3; f++) {
+    xyz << "4\nframe " << f << "\n";
+    const char* symbols[4] = {"O", "H", "H", "C"};
+    for (int i = 0; i < 4; i++) {
+      xyz << symbols[i] << " " << (1.0f / 3.0f + (float)i * 1.7f - (float)f * 0.25f) << " "
+          << (-2.0f / 7.0f * (float)(i + 1) + (float)f) << " "
+          << (10.0f + (float)(i * f) * 0.123456f) << "\n";
+    }
+  }
+  return xyz.str();
+}
+
+static void roundTrip(const ScratchDir& dir) {
+  const std::string xyzPath = dir.write("frames.xyz", threeFrames());
+  XyzTrajectory xyz(xyzPath);
+
+  const std::string plainPath = dir.path("plain.ckt");
+  const std::string quantizedPath = dir.path("quantized.ckt");
+  convertXyzToBinary(xyzPath, plainPath, false);
+  convertXyzToBinary(xyzPath, quantizedPath, true);
+  check(isBinaryTrajectory(plainPath) && isBinaryTrajectory(quantizedPath), "magic written");
+  check(!isBinaryTrajectory(xyzPath), "XYZ is not binary");
+
+  BinaryTrajectory plain(plainPath);
+  BinaryTrajectory quantized(quantizedPath);
+  check(plain.frameCount() == 3 && plain.atomCount() == 4, "plain counts");
+  check(!plain.quantized() && quantized.quantized(), "quantized flag");
+
+  Molecule expected;
+  std::vector<Instance> decoded;
+  for (size_t f = 0; f < 3; f++) {
+    xyz.readMolecule(f, expected);
+
+    Molecule mol = plain.molecule(f);
+    check(mol.atomicNumbers == expected.atomicNumbers, "elements kept");
+    check(std::memcmp(mol.x.data(), expected.x.data(), 4 * sizeof(float)) == 0 &&
+          std::memcmp(mol.y.data(), expected.y.data(), 4 * sizeof(float)) == 0 &&
+          std::memcmp(mol.z.data(), expected.z.data(), 4 * sizeof(float)) == 0,
+          "plain frames are bit-exact");
+
+    // Each axis is quantized to 16 bits over the frame's bounding box, so the
+    // error is at most half a step of extent / 65535 (plus float rounding).
+    quantized.readFrame(f, decoded);
+    const AlignedVector<float>* axes[3] = {&expected.x, &expected.y, &expected.z};
+    for (int a = 0; a < 3; a++) {
+      const auto [lo, hi] = std::minmax_element(axes[a]->begin(), axes[a]->end());
+      const double bound = 0.5 * (*hi - *lo) / 65535.0 + 1e-5 * std::max(1.0f, std::fabs(*hi));
+      for (size_t i = 0; i < 4; i++) {
+        const float v = a == 0 ? decoded[i].x : a == 1 ? decoded[i].y : decoded[i].z;
+        checkNear(v, (*axes[a])[i], bound, "quantization error within half a step");
+      }
+    }
+  }
+}
+
+// Headers whose table offsets would wrap around when added to their lengths.
+static void craftedHeaders(const ScratchDir& dir) {
+  const std::string good = dir.path("good.ckt");
+  convertXyzToBinary(dir.write("one.xyz", "1\n\nH 0 0 0\n"), good, false);
+  std::ifstream in(good, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  auto withHeader = [&](const char* name, auto edit) {
+    BinaryTrajectoryHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    edit(header);
+    std::string crafted = bytes;
+    std::memcpy(crafted.data(), &header, sizeof(header));
+    return dir.write(name, crafted);
+  };
+
+  const std::string atoms = withHeader("atoms.ckt", [](BinaryTrajectoryHeader& h) {
+    h.atomTableOffset = UINT64_MAX;
+  });
+  checkThrows([&] { BinaryTrajectory t(atoms); }, "Truncated binary trajectory");
+
+  const std::string frames = withHeader("frames.ckt", [](BinaryTrajectoryHeader& h) {
+    h.frameTableOffset = UINT64_MAX - 7;
+  });
+  checkThrows([&] { BinaryTrajectory t(frames); }, "Truncated binary trajectory");
+
+  const std::string count = withHeader("count.ckt", [](BinaryTrajectoryHeader& h) {
+    h.nframes = UINT64_MAX / 8 + 2;
+  });
+  checkThrows([&] { BinaryTrajectory t(count); }, "Truncated binary trajectory");
+}
+
+auto main() -> int {
+  ScratchDir dir("chemiskit_binary_trajectory_test");
+  roundTrip(dir);
+  craftedHeaders(dir);
+  return failures() != 0 ? 1 : 0;
+}
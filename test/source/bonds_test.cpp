@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bonds.hpp"
+#include "check.hpp"
+#include "elements.hpp"
+
+using Pair = std::pair<uint32_t, uint32_t>;
+
+static std::vector<Pair> sorted(const std::vector<Bond>& bonds) {
+  std::vector<Pair> out;
+  for (const Bond& b : bonds) {
+    out.emplace_back(std::min(b.a, b.b), std::max(b.a, b.b));
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+static float minimumImage(float d, float length) {
+  return length > 0.0f ? d - length * std::round(d / length) : d;
+}
+
+// Every pair tested directly, with the perception's criteria.
+static std::vector<Pair> bruteForce(const Molecule& mol, float tolerance, const float box[3]) {
+  std::vector<Pair> out;
+  for (uint32_t i = 0; i < mol.size(); i++) {
+    for (uint32_t j = i + 1; j < mol.size(); j++) {
+      float dx = minimumImage(mol.x[j] - mol.x[i], box[0]);
+      float dy = minimumImage(mol.y[j] - mol.y[i], box[1]);
+      float dz = minimumImage(mol.z[j] - mol.z[i], box[2]);
+      float cutoff = (float)(kElements[mol.atomicNumbers[i]].covalentRadius +
+                             kElements[mol.atomicNumbers[j]].covalentRadius) / 100.0f + tolerance;
+      float d2 = dx * dx + dy * dy + dz * dz;
+      if (d2 < cutoff * cutoff && d2 > 0.01f) {
+        out.emplace_back(i, j);
+      }
+    }
+  }
+  return out;
+}
+
+// Waters on a jittered grid, the hydrogens along scattered directions.
+static Molecule waterBox(int side, float spacing) {
+  Molecule mol;
+  uint32_t state = 2024;
+  auto next = [&] {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24);
+  };
+  for (int i = 0; i < side; i++) {
+    for (int j = 0; j < side; j++) {
+      for (int k = 0; k < side; k++) {
+        float o[3] = {(float)i * spacing + 0.3f * next(), (float)j * spacing + 0.3f * next(),
+                      (float)k * spacing + 0.3f * next()};
+        mol.addAtom(8, o[0], o[1], o[2]);
+        for (int h = 0; h < 2; h++) {
+          float theta = 6.2831853f * next(), phi = 3.1415926f * next();
+          mol.addAtom(1, o[0] + 0.96f * std::sin(phi) * std::cos(theta),
+                      o[1] + 0.96f * std::sin(phi) * std::sin(theta),
+                      o[2] + 0.96f * std::cos(phi));
+        }
+      }
+    }
+  }
+  return mol;
+}
+
+// The cell list finds exactly the bonds of an all-pairs search, on the first
+// frame and on later ones that only re-perceive the cells around moved atoms.
+static void matchesBruteForce() {
+  for (bool periodic : {false, true}) {
+    const int side = 6;
+    const float spacing = 3.0f;
+    Molecule mol = waterBox(side, spacing);
+    const float length = periodic ? side * spacing : 0.0f;
+    const float box[3] = {length, length, length};
+    BondPerception perception;
+    perception.setBox(box[0], box[1], box[2]);
+
+    std::vector<Pair> found = sorted(perception.update(mol));
+    check(found == bruteForce(mol, perception.tolerance, box), "first frame matches all pairs");
+    check(found.size() >= (size_t)(2 * side * side * side), "every water has its O-H bonds");
+    check(perception.cellsRecomputed() == perception.cellCount(), "first frame perceives all");
+
+    perception.update(mol);
+    check(perception.cellsRecomputed() == 0, "an unchanged frame perceives nothing");
+    check(sorted(perception.bonds()) == found, "and keeps its bonds");
+
+    // a few hydrogens pulled off, one of them across the box face
+    for (uint32_t i : {1u, 100u, 301u}) {
+      mol.x[i] -= 1.5f;
+    }
+    found = sorted(perception.update(mol));
+    check(found == bruteForce(mol, perception.tolerance, box), "moved atoms match all pairs");
+    check(perception.cellsRecomputed() > 0 &&
+          perception.cellsRecomputed() < perception.cellCount(),
+          "only cells around moved atoms are perceived again");
+
+    // every atom drifts a little, so every cell is dirty
+    for (size_t i = 0; i < mol.size(); i++) {
+      mol.y[i] += 0.05f * std::cos((float)i);
+    }
+    check(sorted(perception.update(mol)) == bruteForce(mol, perception.tolerance, box),
+          "drifted frame matches all pairs");
+  }
+}
+
+static void periodicBoundary() {
+  // an O-H bond across the x face of a 10 A box
+  Molecule mol;
+  mol.addAtom(8, 9.7f, 5.0f, 5.0f);
+  mol.addAtom(1, 0.3f, 5.0f, 5.0f);
+  mol.addAtom(8, 5.0f, 5.0f, 5.0f);
+  mol.addAtom(1, 5.0f, 5.96f, 5.0f);
+  const float box[3] = {10.0f, 10.0f, 10.0f};
+
+  BondPerception open;
+  check(sorted(open.update(mol)) == std::vector<Pair>{{2, 3}}, "no bond across without the box");
+
+  BondPerception perception;
+  perception.setBox(box[0], box[1], box[2]);
+  const std::vector<Bond>& bonds = perception.update(mol);
+  check(sorted(bonds) == (std::vector<Pair>{{0, 1}, {2, 3}}), "bond across the boundary");
+
+  // the wrapped bond becomes two stubs, each from its atom towards the
+  // other's nearest image; the other bond stays one cylinder
+  std::vector<BondInstance> instances;
+  buildBondInstances(mol, bonds, box, instances);
+  check(instances.size() == 3, "split into two stubs");
+  size_t stubs = 0;
+  for (const BondInstance& b : instances) {
+    float dx = b.bx - b.ax, dy = b.by - b.ay, dz = b.bz - b.az;
+    float len = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if (std::abs(dy) < 1e-4f) {
+      stubs++;
+      checkNear(len, 0.6, 1e-4, "stub spans the minimum image distance");
+      check(std::abs(b.ax - 9.7f) < 1e-4f ? b.bx > 10.0f : b.bx < 0.0f,
+            "stub points out of the box");
+    } else {
+      checkNear(len, 0.96, 1e-4, "unwrapped bond kept whole");
+    }
+  }
+  check(stubs == 2, "one stub per atom");
+
+  // without a box buildBondInstances never splits
+  const float none[3] = {0.0f, 0.0f, 0.0f};
+  buildBondInstances(mol, bonds, none, instances);
+  check(instances.size() == 2, "no split without a box");
+}
+
+// Changing the box or resetting rebuilds the grid from scratch.
+static void rebuilds() {
+  Molecule mol = waterBox(3, 3.0f);
+  BondPerception perception;
+  perception.update(mol);
+  perception.update(mol);
+  check(perception.cellsRecomputed() == 0, "steady frame");
+  perception.reset();
+  perception.update(mol);
+  check(perception.cellsRecomputed() == perception.cellCount(), "reset perceives all");
+  perception.setBox(9.0f, 9.0f, 9.0f);
+  perception.update(mol);
+  check(perception.cellsRecomputed() == perception.cellCount(), "new box perceives all");
+
+  mol.addAtom(1, 20.0f, 20.0f, 20.0f);
+  const float box[3] = {9.0f, 9.0f, 9.0f};
+  check(sorted(perception.update(mol)) == bruteForce(mol, perception.tolerance, box),
+        "a new atom count rebuilds");
+}
+
+auto main() -> int {
+  matchesBruteForce();
+  periodicBoundary();
+  rebuilds();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "atom_picker.hpp"
+#include "bvh.hpp"
+#include "check.hpp"
+
+static uint32_t state = 99;
+
+static float next() {
+  state = state * 1664525u + 1013904223u;
+  return (float)(state >> 8) / (float)(1u << 24);
+}
+
+// Atoms scattered over a cube of side `extent` around the origin.
+static std::vector<Instance> cloud(size_t count, float extent) {
+  std::vector<Instance> atoms;
+  for (size_t i = 0; i < count; i++) {
+    atoms.push_back({(next() - 0.5f) * extent, (next() - 0.5f) * extent,
+                     (next() - 0.5f) * extent, 0.3f + next(), 1.0f, 1.0f, 1.0f});
+  }
+  return atoms;
+}
+
+// Nearest sphere along the ray, testing every sphere.
+static uint32_t bruteForcePick(const std::vector<Instance>& atoms, const glm::vec3& origin,
+                               const glm::vec3& dir, float& best) {
+  uint32_t hit = SphereBvh::kNone;
+  best = std::numeric_limits<float>::max();
+  const float a = glm::dot(dir, dir);
+  for (uint32_t i = 0; i < atoms.size(); i++) {
+    glm::vec3 oc = origin - glm::vec3(atoms[i].x, atoms[i].y, atoms[i].z);
+    float b = glm::dot(oc, dir);
+    float disc = b * b - a * (glm::dot(oc, oc) - atoms[i].radius * atoms[i].radius);
+    if (disc < 0.0f) {
+      continue;
+    }
+    float t = (-b - std::sqrt(disc)) / a;
+    if (t < 0.0f) {
+      t = (-b + std::sqrt(disc)) / a;
+    }
+    if (t >= 0.0f && t < best) {
+      best = t;
+      hit = i;
+    }
+  }
+  return hit;
+}
+
+// Rays from outside the cloud towards random points inside it, so most hit
+// and some miss.
+static void checkPicks(const SphereBvh& bvh, const std::vector<Instance>& atoms, float extent,
+                       const char* what) {
+  int mismatches = 0, hits = 0, misses = 0;
+  for (int r = 0; r < 500; r++) {
+    glm::vec3 origin((next() - 0.5f) * 3.0f * extent, (next() - 0.5f) * 3.0f * extent,
+                     1.5f * extent);
+    glm::vec3 toward((next() - 0.5f) * 1.2f * extent, (next() - 0.5f) * 1.2f * extent,
+                     (next() - 0.5f) * extent);
+    glm::vec3 dir = toward - origin;
+    float expectedT = 0.0f, t = -1.0f;
+    uint32_t expected = bruteForcePick(atoms, origin, dir, expectedT);
+    uint32_t hit = bvh.pick(origin, dir, &t);
+    if (expected == SphereBvh::kNone) {
+      misses++;
+      mismatches += hit != SphereBvh::kNone;
+      continue;
+    }
+    hits++;
+    // two spheres entered at the same depth may be picked either way
+    mismatches += hit == SphereBvh::kNone || std::abs(t - expectedT) > 1e-5f;
+  }
+  check(mismatches == 0, what);
+  check(hits > 0 && misses > 0, "rays both hit and miss");
+}
+
+static void picksNearest() {
+  const float extent = 40.0f;
+  std::vector<Instance> atoms = cloud(3000, extent);
+  SphereBvh bvh;
+  bvh.build(atoms);
+  check(bvh.size() == atoms.size() && bvh.nodeCount() > 1, "built over every atom");
+  checkPicks(bvh, atoms, extent, "picks match all spheres");
+
+  // from inside a sphere the ray hits its far side
+  glm::vec3 center(atoms[5].x, atoms[5].y, atoms[5].z);
+  float t = -1.0f;
+  uint32_t hit = bvh.pick(center, glm::vec3(0.0f, 0.0f, 0.001f), &t);
+  check(hit != SphereBvh::kNone && t >= 0.0f, "a ray from inside a sphere hits");
+
+  SphereBvh empty;
+  empty.build({});
+  check(empty.pick(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)) == SphereBvh::kNone,
+        "an empty tree hits nothing");
+}
+
+// Refit moves the bounds with the atoms; the answers stay those of a fresh
+// build.
+static void refitMatchesBuild() {
+  const float extent = 40.0f;
+  std::vector<Instance> atoms = cloud(3000, extent);
+  SphereBvh bvh;
+  bvh.build(atoms);
+  const size_t nodes = bvh.nodeCount();
+  for (int frame = 0; frame < 3; frame++) {
+    for (Instance& a : atoms) {
+      a.x += (next() - 0.5f) * 4.0f;
+      a.y += (next() - 0.5f) * 4.0f;
+      a.z += (next() - 0.5f) * 4.0f;
+    }
+    bvh.refit(atoms);
+    check(bvh.nodeCount() == nodes, "refit keeps the topology");
+    checkPicks(bvh, atoms, extent, "refit picks match all spheres");
+  }
+
+  atoms.resize(1000);
+  bvh.refit(atoms);
+  check(bvh.size() == 1000 && bvh.nodeCount() < nodes, "a new atom count rebuilds");
+  checkPicks(bvh, atoms, extent, "rebuilt picks match all spheres");
+}
+
+static void gathersWithinRadius() {
+  std::vector<Instance> atoms = cloud(3000, 40.0f);
+  SphereBvh bvh;
+  bvh.build(atoms);
+  for (int q = 0; q < 50; q++) {
+    glm::vec3 center((next() - 0.5f) * 40.0f, (next() - 0.5f) * 40.0f, (next() - 0.5f) * 40.0f);
+    float radius = 1.0f + 6.0f * next();
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < atoms.size(); i++) {
+      if (glm::length(glm::vec3(atoms[i].x, atoms[i].y, atoms[i].z) - center) <= radius) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<uint32_t> found = {12345};
+    bvh.gather(center, radius, found);
+    check(found.front() == 12345, "gather appends");
+    found.erase(found.begin());
+    std::sort(found.begin(), found.end());
+    check(found == expected, "gather matches all atoms");
+  }
+}
+
+// The picker refits lazily: a stale tree is brought up to date by the next
+// query, through the camera's inverse.
+static void pickerFollowsFrames() {
+  std::vector<Instance> atoms = {
+    {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+    {3.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+    {3.0f, 0.0f, -5.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+    {0.0f, 1.5f, 0.0f, 0.5f, 1.0f, 1.0f, 1.0f},
+  };
+  SphereBvh bvh;
+  bvh.build(atoms);
+  AtomPicker picker;
+  picker.hovered = 2;
+  picker.selected = 2;
+  picker.reset(std::move(bvh));
+  check(picker.hovered == AtomPicker::kNone && picker.selected == AtomPicker::kNone,
+        "reset clears hover and selection");
+
+  glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) *
+                       glm::lookAt(glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(0.0f),
+                                   glm::vec3(0.0f, 1.0f, 0.0f));
+  auto ndc = [&](const Instance& a) {
+    glm::vec4 clip = viewProj * glm::vec4(a.x, a.y, a.z, 1.0f);
+    return glm::vec2(clip.x / clip.w, clip.y / clip.w);
+  };
+  glm::vec2 p = ndc(atoms[1]);
+  check(picker.pick(atoms, viewProj, p.x, p.y) == 1, "the nearer of two atoms in line");
+  p = ndc(atoms[3]);
+  check(picker.pick(atoms, viewProj, p.x, p.y) == 3, "a small atom above another");
+  check(picker.pick(atoms, viewProj, 0.9f, 0.9f) == AtomPicker::kNone, "empty space");
+
+  // atom 1 moves up, uncovering atom 2 behind where it was
+  atoms[1].y = 10.0f;
+  p = ndc(atoms[1]);
+  picker.moved();
+  check(picker.pick(atoms, viewProj, p.x, p.y) == 1, "picked where it moved to");
+  p = ndc({3.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f});
+  check(picker.pick(atoms, viewProj, p.x, p.y) == 2, "the one behind is uncovered");
+
+  std::vector<uint32_t> out = {7};
+  picker.neighbors(atoms, 0, 6.0f, out);
+  check(out == std::vector<uint32_t>{3, 2}, "neighbors nearest first, without the atom");
+  picker.neighbors(atoms, 99, 6.0f, out);
+  check(out.empty(), "no neighbors for a missing atom");
+}
+
+auto main() -> int {
+  picksNearest();
+  refitMatchesBuild();
+  gathersWithinRadius();
+  pickerFollowsFrames();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <source_location>
+#include <string>
+#include <string_view>
+
+// Shared by the test executables: each one runs its checks from main() and
+// returns failures() != 0, which is what CTest looks at.
+
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline void check(bool ok, std::string_view what,
+                  std::source_location where = std::source_location::current()) {
+  if (!ok) {
+    std::fprintf(stderr, "%s:%u: check failed: %.*s\n", where.file_name(),
+                 (unsigned)where.line(), (int)what.size(), what.data());
+    failures()++;
+  }
+}
+
+inline void checkNear(double value, double expected, double tolerance, std::string_view what,
+                      std::source_location where = std::source_location::current()) {
+  if (!(std::fabs(value - expected) <= tolerance)) {
+    std::fprintf(stderr, "%s:%u: check failed: %.*s: %.9g, expected %.9g +- %.3g\n",
+                 where.file_name(), (unsigned)where.line(), (int)what.size(), what.data(), value,
+                 expected, tolerance);
+    failures()++;
+  }
+}
+
+// Runs `body` and checks that it throws a std::exception whose message
+// contains `message`.
+template <class F>
+void checkThrows(F&& body, std::string_view message,
+                 std::source_location where = std::source_location::current()) {
+  try {
+    body();
+  } catch (const std::exception& e) {
+    check(std::string_view(e.what()).find(message) != std::string_view::npos,
+          std::string("message \"") + e.what() + "\" mentions \"" + std::string(message) + "\"",
+          where);
+    return;
+  }
+  check(false, std::string("throws \"") + std::string(message) + "\"", where);
+}
+
+// A private directory under the system temp directory, removed on exit.
+class ScratchDir {
+public:
+  explicit ScratchDir(const std::string& name)
+    : dir(std::filesystem::temp_directory_path() / name) {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+  }
+  ~ScratchDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  }
+
+  ScratchDir(const ScratchDir&) = delete;
+  ScratchDir& operator=(const ScratchDir&) = delete;
+
+  std::string path(const std::string& file) const { return (dir / file).string(); }
+
+  std::string write(const std::string& file, std::string_view contents) const {
+    std::string p = path(file);
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), (std::streamsize)contents.size());
+    return p;
+  }
+
+private:
+  std::filesystem::path dir;
+};
@@ -0,0 +1,111 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "check.hpp"
+#include "culling.hpp"
+
+// Spheres scattered over a cube of side `extent` around the origin; `r` holds
+// each sphere's index so the kept order can be checked.
+static std::vector<Instance> cloud(size_t count, float extent) {
+  std::vector<Instance> spheres;
+  uint32_t state = 777;
+  auto next = [&] {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24);
+  };
+  for (size_t i = 0; i < count; i++) {
+    float x = (next() - 0.5f) * extent;
+    float y = (next() - 0.5f) * extent;
+    float z = (next() - 0.5f) * extent;
+    spheres.push_back({x, y, z, 0.2f + 2.0f * next(), (float)i, 0.0f, 0.0f});
+  }
+  return spheres;
+}
+
+static void planesNormalized() {
+  glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f) *
+                       glm::lookAt(glm::vec3(3.0f, 4.0f, 20.0f), glm::vec3(0.0f),
+                                   glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum f = frustumFromMatrix(viewProj);
+  for (int p = 0; p < 6; p++) {
+    checkNear(f.a[p] * f.a[p] + f.b[p] * f.b[p] + f.c[p] * f.c[p], 1.0, 1e-5,
+              "plane normals have unit length");
+  }
+}
+
+// With an orthographic camera at the origin looking down -z the frustum is a
+// box, so which spheres touch it can be worked out per axis.
+static void compactsInOrder() {
+  const float half = 10.0f, nearPlane = 0.1f, farPlane = 100.0f;
+  Frustum f = frustumFromMatrix(glm::ortho(-half, half, -half, half, nearPlane, farPlane));
+  std::vector<Instance> spheres = cloud(5000, 60.0f);
+  for (Instance& s : spheres) {
+    s.z -= 30.0f;
+  }
+
+  std::vector<float> expected;
+  for (const Instance& s : spheres) {
+    bool inside = std::abs(s.x) < half + s.radius && std::abs(s.y) < half + s.radius &&
+                  s.z < -nearPlane + s.radius && s.z > -farPlane - s.radius;
+    if (inside) {
+      expected.push_back(s.r);
+    }
+  }
+
+  std::vector<Instance> out = {{1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f}};
+  size_t kept = cullSpheres(spheres, f, out);
+  check(kept == out.size(), "out holds exactly the kept spheres");
+  check(kept > 0 && kept < spheres.size(), "some spheres kept, some culled");
+  std::vector<float> order;
+  for (const Instance& s : out) {
+    order.push_back(s.r);
+  }
+  check(order == expected, "kept spheres are the visible ones, in input order");
+}
+
+static void touchingSpheres() {
+  Frustum f = frustumFromMatrix(glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f));
+  std::vector<Instance> spheres = {
+    {0.0f, 0.0f, -50.0f, 1.0f, 0.0f, 0.0f, 0.0f},   // centred
+    {10.5f, 0.0f, -50.0f, 1.0f, 1.0f, 0.0f, 0.0f},  // centre outside, sphere overlaps
+    {12.0f, 0.0f, -50.0f, 1.0f, 2.0f, 0.0f, 0.0f},  // beyond the right plane
+    {0.0f, 0.0f, 5.0f, 1.0f, 3.0f, 0.0f, 0.0f},     // behind the camera
+    {0.0f, 0.0f, -100.5f, 1.0f, 4.0f, 0.0f, 0.0f},  // straddles the far plane
+    {0.0f, -30.0f, -150.0f, 1.0f, 5.0f, 0.0f, 0.0f} // past the far plane
+  };
+  std::vector<Instance> out;
+  check(cullSpheres(spheres, f, out) == 3, "three spheres touch the box");
+  check(out.size() == 3 && out[0].r < 0.5f && std::abs(out[1].r - 1.0f) < 0.5f &&
+        std::abs(out[2].r - 4.0f) < 0.5f, "the touching ones are kept");
+
+  check(cullSpheres({}, f, out) == 0 && out.empty(), "nothing in, nothing out");
+}
+
+static void perspectiveView() {
+  glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) *
+                       glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f),
+                                   glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum f = frustumFromMatrix(viewProj);
+  std::vector<Instance> spheres = {
+    {0.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f, 0.0f},    // at the target
+    {0.0f, 0.0f, 20.0f, 0.5f, 1.0f, 0.0f, 0.0f},   // behind the eye
+    {20.0f, 0.0f, 0.0f, 0.5f, 2.0f, 0.0f, 0.0f},   // outside the 22.5 degree half angle
+    {30.0f, 0.0f, -80.0f, 0.5f, 3.0f, 0.0f, 0.0f}, // far but within the cone
+  };
+  std::vector<Instance> out;
+  check(cullSpheres(spheres, f, out) == 2, "two spheres in the cone");
+  check(out.size() == 2 && out[0].r < 0.5f && std::abs(out[1].r - 3.0f) < 0.5f,
+        "the target and the far sphere");
+}
+
+auto main() -> int {
+  planesNormalized();
+  compactsInOrder();
+  touchingSpheres();
+  perspectiveView();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#include "check.hpp"
+#include "elements.hpp"
+#include "molecule.hpp"
+
+static void symbols() {
+  check(elementFromSymbol("H") == 1, "H");
+  check(elementFromSymbol("h") == 1, "h");
+  check(elementFromSymbol("He") == 2 && elementFromSymbol("HE") == 2 &&
+        elementFromSymbol("he") == 2, "He in any case");
+  check(elementFromSymbol("C") == 6 && elementFromSymbol("Ca") == 20, "C and Ca differ");
+  check(elementFromSymbol("Og") == 118, "last element");
+  check(elementFromSymbol("X") == 0, "placeholder is not a symbol");
+  check(elementFromSymbol("Xx") == 0 && elementFromSymbol("Zz") == 0, "unknown pairs");
+  check(elementFromSymbol("") == 0 && elementFromSymbol("Fe2") == 0, "wrong lengths");
+  check(elementFromSymbol("1") == 0 && elementFromSymbol("C1") == 0 &&
+        elementFromSymbol(" C") == 0, "non-letters");
+
+  for (int z = 1; z <= kMaxAtomicNumber; z++) {
+    check(elementFromSymbol(elementSymbol(z)) == z, "symbol round-trips");
+  }
+  check(std::string_view(elementSymbol(-1)) == "X" &&
+        std::string_view(elementSymbol(kMaxAtomicNumber + 1)) == "X", "out of range is X");
+
+  check(atomicNumber("Cl") == 17, "atomicNumber by symbol");
+  check(atomicNumber("8") == 8, "atomicNumber by number");
+  checkThrows([] { atomicNumber("119"); }, "Unknown atom: 119");
+  checkThrows([] { atomicNumber("Qq"); }, "Unknown atom: Qq");
+}
+
+static void styles() {
+  // radius is the empirical radius scaled so hydrogen's 25 pm is 0.2 * 25/53
+  checkNear(kElementStyles[1].radius, 0.2 * 25.0 / 53.0, 1e-6, "H radius");
+  checkNear(kElementStyles[0].radius, 0.2, 1e-6, "placeholder radius");
+  check(kElementStyles[55].radius > kElementStyles[6].radius, "Cs larger than C");
+
+  // colors are the 0xRRGGBB of the table in [0, 1]
+  checkNear(kElementStyles[8].r, 1.0, 0.0, "O red");
+  checkNear(kElementStyles[8].g, 0.0, 0.0, "O green");
+  checkNear(kElementStyles[7].b, 0xF8 / 255.0, 1e-6, "N blue");
+  for (const ElementStyle& s : kElementStyles) {
+    check(s.radius > 0.0f && s.r >= 0.0f && s.r <= 1.0f && s.g >= 0.0f && s.g <= 1.0f &&
+          s.b >= 0.0f && s.b <= 1.0f, "style in range");
+  }
+
+  Molecule mol;
+  mol.addAtom(6, 1.0f, 2.0f, 3.0f);
+  mol.addAtom(1, -1.0f, 0.0f, 0.5f);
+  std::vector<Instance> out(2);
+  toDraw(mol, out);
+  checkNear(out[0].x, 1.0, 0.0, "toDraw position");
+  checkNear(out[1].z, 0.5, 0.0, "toDraw position");
+  checkNear(out[0].radius, kElementStyles[6].radius, 0.0, "toDraw radius");
+  checkNear(out[1].g, kElementStyles[1].g, 0.0, "toDraw color");
+}
+
+auto main() -> int {
+  symbols();
+  styles();
+  return failures() != 0 ? 1 : 0;
+}
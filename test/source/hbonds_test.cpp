@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "check.hpp"
+#include "hbonds.hpp"
+
+using Triple = std::tuple<uint32_t, uint32_t, uint32_t>;
+
+static std::vector<Triple> sorted(const std::vector<HBond>& bonds) {
+  std::vector<Triple> out;
+  for (const HBond& b : bonds) {
+    out.emplace_back(b.donor, b.hydrogen, b.acceptor);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+static float minimumImage(float d, float length) {
+  return length > 0.0f ? d - length * std::round(d / length) : d;
+}
+
+// Every pair tested directly, with the detector's criteria.
+static std::vector<Triple> bruteForce(const Molecule& mol, const HBondDetector& detector,
+                                      const float box[3]) {
+  auto delta = [&](uint32_t from, uint32_t to, float d[3]) {
+    d[0] = minimumImage(mol.x[to] - mol.x[from], box[0]);
+    d[1] = minimumImage(mol.y[to] - mol.y[from], box[1]);
+    d[2] = minimumImage(mol.z[to] - mol.z[from], box[2]);
+    return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  };
+  auto heavy = [&](uint32_t i) {
+    return mol.atomicNumbers[i] == 7 || mol.atomicNumbers[i] == 8 || mol.atomicNumbers[i] == 9;
+  };
+  const float cosMax = std::cos(detector.maxAngle * 3.14159265f / 180.0f);
+  std::vector<Triple> out;
+  for (uint32_t h = 0; h < mol.size(); h++) {
+    if (mol.atomicNumbers[h] != 1) {
+      continue;
+    }
+    uint32_t donor = UINT32_MAX;
+    float best = 1.25f;
+    float d[3];
+    for (uint32_t i = 0; i < mol.size(); i++) {
+      if (heavy(i) && delta(i, h, d) < best) {
+        best = delta(i, h, d);
+        donor = i;
+      }
+    }
+    if (donor == UINT32_MAX) {
+      continue;
+    }
+    float dh[3];
+    const float rdh = delta(donor, h, dh);
+    for (uint32_t a = 0; a < mol.size(); a++) {
+      float da[3];
+      if (a == donor || !heavy(a)) {
+        continue;
+      }
+      const float rda = delta(donor, a, da);
+      if (rda < detector.maxDistance &&
+          dh[0] * da[0] + dh[1] * da[1] + dh[2] * da[2] >= cosMax * rdh * rda) {
+        out.emplace_back(donor, h, a);
+      }
+    }
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+// Waters on a jittered grid with scattered orientations.
+static Molecule waterBox(int side, float spacing) {
+  Molecule mol;
+  uint32_t state = 12345;
+  auto next = [&] {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24);
+  };
+  for (int i = 0; i < side; i++) {
+    for (int j = 0; j < side; j++) {
+      for (int k = 0; k < side; k++) {
+        float o[3] = {(float)i * spacing + 0.3f * next(), (float)j * spacing + 0.3f * next(),
+                      (float)k * spacing + 0.3f * next()};
+        float theta = 6.2831853f * next(), phi = 3.1415926f * next();
+        float u[3] = {std::sin(phi) * std::cos(theta), std::sin(phi) * std::sin(theta),
+                      std::cos(phi)};
+        // second hydrogen roughly 105 degrees from the first
+        float v[3] = {-u[1], u[0], 0.0f};
+        float vl = std::max(std::hypot(v[0], v[1]), 1e-3f);
+        mol.addAtom(8, o[0], o[1], o[2]);
+        mol.addAtom(1, o[0] + 0.96f * u[0], o[1] + 0.96f * u[1], o[2] + 0.96f * u[2]);
+        mol.addAtom(1, o[0] + 0.96f * (-0.26f * u[0] + 0.97f * v[0] / vl),
+                    o[1] + 0.96f * (-0.26f * u[1] + 0.97f * v[1] / vl),
+                    o[2] + 0.96f * (-0.26f * u[2]));
+      }
+    }
+  }
+  return mol;
+}
+
+// The Verlet list finds exactly the bonds of an all-pairs search, frame after
+// frame, while only being rebuilt when atoms have moved far enough.
+static void matchesBruteForce() {
+  for (bool periodic : {false, true}) {
+    const int side = 6;
+    const float spacing = 2.9f;
+    Molecule mol = waterBox(side, spacing);
+    const float box[3] = {periodic ? side * spacing : 0.0f, periodic ? side * spacing : 0.0f,
+                          periodic ? side * spacing : 0.0f};
+    HBondDetector detector;
+    detector.setBox(box[0], box[1], box[2]);
+
+    size_t total = 0;
+    for (size_t frame = 0; frame < 12; frame++) {
+      // a slow drift: every atom moves 0.04 A a frame
+      for (size_t i = 0; i < mol.size(); i++) {
+        float t = (float)(frame + i);
+        mol.x[i] += 0.04f * std::cos(t);
+        mol.y[i] += 0.04f * std::sin(t);
+      }
+      std::vector<Triple> found = sorted(detector.update(mol, frame));
+      check(found == bruteForce(mol, detector, box), "list matches all pairs");
+      total += found.size();
+    }
+    check(total > 0, "the box has hydrogen bonds");
+    check(detector.acceptorCount() == (size_t)(side * side * side), "one acceptor per water");
+    check(detector.listRebuilds() >= 1 && detector.listRebuilds() < 12,
+          "the list is reused between rebuilds");
+  }
+}
+
+// One donor water and one acceptor oxygen whose distance is set per frame.
+static Molecule dimer(float distance) {
+  Molecule mol;
+  mol.addAtom(8, 0.0f, 0.0f, 0.0f);
+  mol.addAtom(1, 0.96f, 0.0f, 0.0f);
+  mol.addAtom(8, distance, 0.0f, 0.0f);
+  return mol;
+}
+
+static void periodicBoundary() {
+  // donor near x = 0, its hydrogen and the acceptor across the face
+  Molecule mol;
+  mol.addAtom(8, 0.5f, 5.0f, 5.0f);
+  mol.addAtom(1, -0.46f, 5.0f, 5.0f);
+  mol.addAtom(8, 7.6f, 5.0f, 5.0f);
+  HBondDetector detector;
+  detector.setBox(10.0f, 10.0f, 10.0f);
+  check(detector.update(mol, 0).size() == 1, "bond across the periodic boundary");
+
+  HBondDetector open;
+  check(open.update(mol, 0).empty(), "no bond without the box");
+}
+
+static void lifetimes() {
+  HBondDetector detector;
+  // bonded in frames 0-4, broken in 5
+  for (size_t f = 0; f < 5; f++) {
+    check(detector.update(dimer(2.9f), f).size() == 1, "dimer bonded");
+  }
+  detector.update(dimer(4.5f), 5);
+  check(detector.broken() == 1, "bond broke");
+  check(detector.lifetimesRecorded() == 1, "one lifetime");
+  checkNear(detector.meanLifetime(), 5.0, 1e-12, "lived five frames");
+
+  // re-formed in 6 and sampled every third frame while playback skips
+  detector.update(dimer(2.9f), 6);
+  check(detector.formed() == 1, "bond formed");
+  detector.update(dimer(2.9f), 9);
+  detector.update(dimer(2.9f), 12);
+  detector.update(dimer(4.5f), 15);
+  check(detector.lifetimesRecorded() == 2, "tracked across skipped frames");
+  checkNear(detector.meanLifetime(), (5.0 + 9.0) / 2.0, 1e-12, "lifetime counted in frames");
+  check(detector.lifetimeResolution() == 3, "resolution is the step");
+  check(detector.trackingRestarts() == 0, "no restarts yet");
+
+  // seeking backwards or far ahead restarts without recording anything
+  detector.update(dimer(2.9f), 16);
+  detector.update(dimer(2.9f), 2);
+  detector.update(dimer(2.9f), 2 + detector.maxGap + 1);
+  check(detector.trackingRestarts() == 2, "seeks restart the tracking");
+  check(detector.formed() == 0 && detector.broken() == 0, "a restart forms and breaks nothing");
+  check(detector.lifetimesRecorded() == 2, "a restart ends no lifetime");
+
+  // the same frame again is not a step
+  size_t processed = detector.framesProcessed();
+  detector.update(dimer(4.5f), 2 + detector.maxGap + 1);
+  check(detector.framesProcessed() == processed + 1, "frame processed");
+  check(detector.lifetimesRecorded() == 2, "repeating a frame is not tracked");
+
+  detector.reset();
+  check(detector.lifetimesRecorded() == 0 && detector.trackingRestarts() == 0, "reset");
+}
+
+auto main() -> int {
+  matchesBruteForce();
+  periodicBoundary();
+  lifetimes();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "check.hpp"
+#include "image_io.hpp"
+
+// ---------- A small inflate, independent of the encoder ----------
+
+class BitReader {
+public:
+  BitReader(const uint8_t* data, size_t size) : p(data), end(data + size) {}
+
+  // Deflate packs values LSB first.
+  uint32_t bits(int count) {
+    uint32_t v = 0;
+    for (int i = 0; i < count; i++) {
+      if (p == end) {
+        throw std::runtime_error("inflate: out of data");
+      }
+      v |= (uint32_t)((*p >> bit) & 1) << i;
+      if (++bit == 8) {
+        bit = 0;
+        p++;
+      }
+    }
+    return v;
+  }
+  // Huffman codes are MSB first.
+  uint32_t code(int count) {
+    uint32_t v = 0;
+    for (int i = 0; i < count; i++) {
+      v = v << 1 | bits(1);
+    }
+    return v;
+  }
+  void align() {
+    if (bit != 0) {
+      bit = 0;
+      p++;
+    }
+  }
+  const uint8_t* position() const { return p; }
+  void skip(size_t n) { p += n; }
+
+private:
+  const uint8_t* p;
+  const uint8_t* end;
+  int bit = 0;
+};
+
+// Fixed Huffman literal/length symbol (RFC 1951, 3.2.6).
+static int fixedSymbol(BitReader& in) {
+  uint32_t c = in.code(7);
+  if (c <= 0x17) {
+    return 256 + (int)c;
+  }
+  c = c << 1 | in.bits(1);
+  if (c >= 0x30 && c <= 0xBF) {
+    return (int)c - 0x30;
+  }
+  if (c >= 0xC0 && c <= 0xC7) {
+    return 280 + (int)c - 0xC0;
+  }
+  c = c << 1 | in.bits(1);
+  return 144 + (int)c - 0x190;
+}
+
+static std::vector<uint8_t> zlibInflate(const std::vector<uint8_t>& z) {
+  static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195,
+                                          227, 258};
+  static const uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                        6145, 8193, 12289, 16385, 24577};
+  if (z.size() < 6 || (z[0] & 0x0F) != 8 || ((z[0] << 8) | z[1]) % 31 != 0) {
+    throw std::runtime_error("inflate: bad zlib header");
+  }
+  std::vector<uint8_t> out;
+  BitReader in(z.data() + 2, z.size() - 6);
+  bool last = false;
+  while (!last) {
+    last = in.bits(1) == 1;
+    uint32_t type = in.bits(2);
+    if (type == 0) {
+      in.align();
+      const uint8_t* p = in.position();
+      size_t len = p[0] | p[1] << 8;
+      out.insert(out.end(), p + 4, p + 4 + len);
+      in.skip(4 + len);
+    } else if (type == 1) {
+      for (int sym = fixedSymbol(in); sym != 256; sym = fixedSymbol(in)) {
+        if (sym < 256) {
+          out.push_back((uint8_t)sym);
+          continue;
+        }
+        int l = sym - 257;
+        size_t length = lengthBase[l] + (l >= 8 && l < 28 ? in.bits((l - 4) / 4) : 0);
+        int d = (int)in.code(5);
+        size_t distance = distBase[d] + (d >= 4 ? in.bits((d - 2) / 2) : 0);
+        if (distance > out.size()) {
+          throw std::runtime_error("inflate: distance too far back");
+        }
+        for (size_t k = 0; k < length; k++) {
+          out.push_back(out[out.size() - distance]);
+        }
+      }
+    } else {
+      throw std::runtime_error("inflate: unexpected block type");
+    }
+  }
+
+  uint32_t a = 1, b = 0;
+  for (uint8_t v : out) {
+    a = (a + v) % 65521;
+    b = (b + a) % 65521;
+  }
+  const uint8_t* t = z.data() + z.size() - 4;
+  uint32_t stored = (uint32_t)t[0] << 24 | t[1] << 16 | t[2] << 8 | t[3];
+  check(stored == (b << 16 | a), "Adler-32 matches");
+  return out;
+}
+
+// ---------- PNG ----------
+
+static uint32_t loadBE(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t crc32(const uint8_t* p, size_t n) {
+  uint32_t c = 0xFFFFFFFFu;
+  for (size_t i = 0; i < n; i++) {
+    c ^= p[i];
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+  }
+  return c ^ 0xFFFFFFFFu;
+}
+
+// Decodes an 8-bit RGB PNG into top-down RGB rows.
+static std::vector<uint8_t> readPng(const std::string& path, int& width, int& height) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> png((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  check(png.size() > 8 && std::equal(signature, signature + 8, png.begin()), "PNG signature");
+
+  std::vector<uint8_t> idat;
+  bool ended = false;
+  for (size_t pos = 8; pos + 12 <= png.size() && !ended;) {
+    uint32_t length = loadBE(&png[pos]);
+    std::string type(png.begin() + (long)pos + 4, png.begin() + (long)pos + 8);
+    const uint8_t* data = &png[pos + 8];
+    check(crc32(&png[pos + 4], length + 4) == loadBE(data + length), "chunk CRC for " + type);
+    if (type == "IHDR") {
+      width = (int)loadBE(data);
+      height = (int)loadBE(data + 4);
+      check(data[8] == 8 && data[9] == 2, "8-bit RGB");
+    } else if (type == "IDAT") {
+      idat.insert(idat.end(), data, data + length);
+    } else if (type == "IEND") {
+      ended = true;
+    }
+    pos += 12 + length;
+  }
+  check(ended, "IEND present");
+
+  std::vector<uint8_t> raw = zlibInflate(idat);
+  const size_t stride = (size_t)width * 3;
+  check(raw.size() == (stride + 1) * (size_t)height, "one filtered row per scanline");
+  std::vector<uint8_t> rgb(stride * (size_t)height);
+  for (size_t y = 0; y < (size_t)height; y++) {
+    const uint8_t filter = raw[y * (stride + 1)];
+    const uint8_t* src = &raw[y * (stride + 1) + 1];
+    uint8_t* row = &rgb[y * stride];
+    const uint8_t* up = y > 0 ? row - stride : nullptr;
+    for (size_t x = 0; x < stride; x++) {
+      int a = x >= 3 ? row[x - 3] : 0;
+      int b = up != nullptr ? up[x] : 0;
+      int c = x >= 3 && up != nullptr ? up[x - 3] : 0;
+      int predicted = 0;
+      switch (filter) {
+        case 1: predicted = a; break;
+        case 2: predicted = b; break;
+        case 3: predicted = (a + b) / 2; break;
+        case 4: {
+          int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+          predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+          break;
+        }
+        default: break;
+      }
+      row[x] = (uint8_t)(src[x] + predicted);
+    }
+  }
+  return rgb;
+}
+
+// Bottom-up RGBA, as glReadPixels returns it: a gradient with noise, so both
+// literals and matches occur.
+static std::vector<uint8_t> testImage(int width, int height) {
+  std::vector<uint8_t> rgba((size_t)width * height * 4);
+  uint32_t seed = 12345;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      seed = seed * 1664525u + 1013904223u;
+      uint8_t* p = &rgba[((size_t)y * width + x) * 4];
+      p[0] = (uint8_t)(x * 3);
+      p[1] = (uint8_t)(y * 5 + (x > width / 2 ? (int)(seed >> 28) : 0));
+      p[2] = (uint8_t)((x / 8 + y / 8) % 2 * 200);
+      p[3] = 255;
+    }
+  }
+  return rgba;
+}
+
+auto main() -> int {
+  ScratchDir dir("chemiskit_image_io_test");
+  const int width = 97, height = 61;
+  std::vector<uint8_t> rgba = testImage(width, height);
+
+  writePng(dir.path("image.png"), rgba.data(), width, height);
+  int w = 0, h = 0;
+  std::vector<uint8_t> rgb = readPng(dir.path("image.png"), w, h);
+  check(w == width && h == height, "PNG size");
+  bool same = rgb.size() == (size_t)width * height * 3;
+  for (int y = 0; same && y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const uint8_t* src = &rgba[((size_t)(height - 1 - y) * width + x) * 4];
+      const uint8_t* dst = &rgb[((size_t)y * width + x) * 3];
+      same &= src[0] == dst[0] && src[1] == dst[1] && src[2] == dst[2];
+    }
+  }
+  check(same, "PNG pixels round-trip, top row first");
+
+  // long runs exercise maximum-length matches
+  std::vector<uint8_t> runs(100000, 7);
+  for (size_t i = 0; i < runs.size(); i += 997) {
+    runs[i] = (uint8_t)i;
+  }
+  std::vector<uint8_t> z = zlibCompress(runs.data(), runs.size());
+  check(z.size() < runs.size() / 20, "runs compress");
+  check(zlibInflate(z) == runs, "zlib round-trip");
+  check(zlibInflate(zlibCompress(nullptr, 0)).empty(), "empty input");
+
+  writePpm(dir.path("image.ppm"), rgba.data(), width, height);
+  std::ifstream ppm(dir.path("image.ppm"), std::ios::binary);
+  std::string magic;
+  int pw = 0, ph = 0, maxval = 0;
+  ppm >> magic >> pw >> ph >> maxval;
+  ppm.get();
+  std::vector<uint8_t> pixels((size_t)width * height * 3);
+  ppm.read(reinterpret_cast<char*>(pixels.data()), (std::streamsize)pixels.size());
+  check(magic == "P6" && pw == width && ph == height && maxval == 255, "PPM header");
+  check(pixels == rgb, "PPM pixels match the PNG");
+
+  checkThrows([&] { writePng(dir.path("missing/x.png"), rgba.data(), width, height); },
+              "Failed to open file");
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "check.hpp"
+#include "culling.hpp"
+#include "octree.hpp"
+
+// Atoms scattered over a cube of side `extent` around the origin; `r` holds
+// each atom's index so selections can be traced back.
+static std::vector<Instance> cloud(size_t count, float extent) {
+  std::vector<Instance> atoms;
+  uint32_t state = 4242;
+  auto next = [&] {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24);
+  };
+  for (size_t i = 0; i < count; i++) {
+    atoms.push_back({(next() - 0.5f) * extent, (next() - 0.5f) * extent,
+                     (next() - 0.5f) * extent, 0.5f + next(), (float)i, 0.5f, 0.5f});
+  }
+  return atoms;
+}
+
+static std::vector<uint32_t> indices(const std::vector<Instance>& spheres) {
+  std::vector<uint32_t> out;
+  for (const Instance& s : spheres) {
+    out.push_back((uint32_t)s.r);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+// A query that never aggregates and never culls.
+static OctreeQuery everything(float spherePixels) {
+  OctreeQuery query;
+  query.cull = false;
+  query.eye = glm::vec3(0.0f, 0.0f, 100.0f);
+  query.pixelScale = 500.0f;
+  query.aggregatePixels = 0.0f;
+  query.spherePixels = spherePixels;
+  return query;
+}
+
+// Every atom is selected exactly once, as a sphere or in a point range.
+static void coversEveryAtom() {
+  const size_t n = 5000;
+  std::vector<Instance> atoms = cloud(n, 60.0f);
+  AtomOctree octree;
+  octree.build(atoms);
+  check(octree.atomCount() == n && octree.packed().size() == n, "all atoms packed");
+  check(octree.nodeCount() > n / AtomOctree::kLeafSize, "split into leaves");
+
+  OctreeSelection sel;
+  octree.select(atoms, everything(0.0f), sel);
+  std::vector<uint32_t> all(n);
+  for (uint32_t i = 0; i < n; i++) {
+    all[i] = i;
+  }
+  check(indices(sel.spheres) == all, "near leaves return every atom once as a sphere");
+  check(sel.points == 0 && sel.aggregates.empty(), "nothing else");
+
+  // leaves are Morton-ordered, so all points merge into one range
+  octree.select(atoms, everything(1e9f), sel);
+  check(sel.spheres.empty() && sel.points == n, "far leaves return every atom as a point");
+  check(sel.pointFirst == std::vector<int32_t>{0} && sel.pointCount == std::vector<int32_t>{(int32_t)n},
+        "adjacent ranges merge");
+
+  // in between, the two together still cover every atom once
+  octree.select(atoms, everything(8.0f), sel);
+  check(!sel.spheres.empty() && sel.points > 0, "a mix of spheres and points");
+  check(sel.spheres.size() + sel.points == n, "spheres and points partition the atoms");
+}
+
+static void aggregatesDistantNodes() {
+  std::vector<Instance> atoms = cloud(5000, 60.0f);
+  AtomOctree octree;
+  octree.build(atoms);
+
+  OctreeQuery query = everything(4.0f);
+  query.eye = glm::vec3(0.0f, 0.0f, 10000.0f);
+  query.pixelScale = 1.0f;
+  query.aggregatePixels = 2.0f;
+  OctreeSelection sel;
+  octree.select(atoms, query, sel);
+  check(sel.nodesVisited == 1 && sel.aggregates.size() == 1, "a far tree is one sprite");
+  check(sel.points == 0 && sel.spheres.empty(), "with nothing else");
+
+  // the sprite sits at the centre of the atoms, in their mean color
+  const PackedInstance& a = sel.aggregates[0];
+  const float* origin = octree.origin();
+  const float* extent = octree.extent();
+  const float center[3] = {origin[0] + a.x / 65535.0f * extent[0],
+                           origin[1] + a.y / 65535.0f * extent[1],
+                           origin[2] + a.z / 65535.0f * extent[2]};
+  for (int k = 0; k < 3; k++) {
+    check(std::abs(center[k]) < 3.0f, "sprite near the middle of the cloud");
+  }
+  check(a.g == 128 && a.b == 128, "sprite in the mean color");
+
+  // nearer, the far half of the tree aggregates and the near half does not
+  query.eye = glm::vec3(0.0f, 0.0f, 60.0f);
+  query.pixelScale = 200.0f;
+  query.aggregatePixels = 40.0f;
+  octree.select(atoms, query, sel);
+  check(!sel.aggregates.empty() && sel.points + sel.spheres.size() > 0,
+        "distance picks between sprites and atoms");
+}
+
+// Culling keeps every atom that touches the frustum and drops whole nodes
+// that don't.
+static void cullsNodes() {
+  const size_t n = 5000;
+  std::vector<Instance> atoms = cloud(n, 60.0f);
+  AtomOctree octree;
+  octree.build(atoms);
+
+  glm::mat4 viewProj = glm::perspective(glm::radians(30.0f), 1.0f, 0.1f, 200.0f) *
+                       glm::lookAt(glm::vec3(20.0f, 0.0f, 60.0f), glm::vec3(20.0f, 0.0f, 0.0f),
+                                   glm::vec3(0.0f, 1.0f, 0.0f));
+  OctreeQuery query = everything(0.0f);
+  query.cull = true;
+  query.frustum = frustumFromMatrix(viewProj);
+  query.eye = glm::vec3(20.0f, 0.0f, 60.0f);
+  OctreeSelection sel;
+  octree.select(atoms, query, sel);
+
+  std::vector<Instance> visible;
+  cullSpheres(atoms, query.frustum, visible);
+  std::vector<uint32_t> selected = indices(sel.spheres), expected = indices(visible);
+  check(std::includes(selected.begin(), selected.end(), expected.begin(), expected.end()),
+        "every visible atom is selected");
+  check(sel.spheres.size() < n, "nodes outside the frustum are skipped");
+
+  OctreeSelection unculled;
+  query.cull = false;
+  octree.select(atoms, query, unculled);
+  check(sel.nodesVisited < unculled.nodesVisited, "culled subtrees are not visited");
+}
+
+static void refitsAndRebuilds() {
+  std::vector<Instance> atoms = cloud(2000, 40.0f);
+  AtomOctree octree;
+  octree.build(atoms);
+  check(octree.rebuildCount() == 1, "built once");
+  const size_t nodes = octree.nodeCount();
+
+  // small drift stays inside the quantization margin: refit only
+  for (size_t i = 0; i < atoms.size(); i++) {
+    atoms[i].x += 0.3f * std::sin((float)i);
+  }
+  octree.refit(atoms);
+  check(octree.rebuildCount() == 1 && octree.nodeCount() == nodes, "drift refits");
+
+  // every packed position decodes to one of the atoms' new positions
+  OctreeSelection sel;
+  octree.select(atoms, everything(0.0f), sel);
+  const float* origin = octree.origin();
+  const float* extent = octree.extent();
+  size_t matched = 0;
+  for (size_t k = 0; k < sel.spheres.size(); k++) {
+    const Instance& atom = sel.spheres[k];
+    const PackedInstance& p = octree.packed()[k];
+    float x = origin[0] + p.x / 65535.0f * extent[0];
+    float y = origin[1] + p.y / 65535.0f * extent[1];
+    float z = origin[2] + p.z / 65535.0f * extent[2];
+    matched += std::abs(x - atom.x) < 0.01f && std::abs(y - atom.y) < 0.01f &&
+               std::abs(z - atom.z) < 0.01f;
+  }
+  check(matched == atoms.size(), "packed positions follow the refit");
+
+  // an atom far outside the bounds, or a new atom count, rebuilds
+  atoms[7].x += 500.0f;
+  octree.refit(atoms);
+  check(octree.rebuildCount() == 2, "an escaped atom rebuilds");
+  atoms.pop_back();
+  octree.refit(atoms);
+  check(octree.rebuildCount() == 3 && octree.atomCount() == atoms.size(),
+        "a new atom count rebuilds");
+
+  AtomOctree empty;
+  empty.build({});
+  empty.select({}, everything(0.0f), sel);
+  check(sel.nodesVisited == 0 && sel.spheres.empty(), "an empty tree selects nothing");
+}
+
+auto main() -> int {
+  coversEveryAtom();
+  aggregatesDistantNodes();
+  cullsNodes();
+  refitsAndRebuilds();
+  return failures() != 0 ? 1 : 0;
+}
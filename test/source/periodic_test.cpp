@@ -0,0 +1,170 @@
+#include <cmath>
+#include <cstring>
+
+#include "check.hpp"
+#include "periodic.hpp"
+
+static constexpr float kBox[3] = {20.0f, 16.0f, 12.0f};
+static constexpr float kCenter[3] = {0.0f, 0.0f, 0.0f};
+
+// A four-atom chain lying across the x = 10 face (two atoms on each side as
+// a simulation wraps them), a water near the middle, and an ion outside the
+// box on the low-z side.
+static Molecule splitSystem() {
+  Molecule mol;
+  mol.addAtom(6, 9.0f, 1.0f, 2.0f);
+  mol.addAtom(6, 9.8f, 1.5f, 2.0f);
+  mol.addAtom(6, -9.4f, 1.0f, 2.5f);  // 10.6 unwrapped
+  mol.addAtom(6, -8.6f, 1.5f, 2.5f);  // 11.4 unwrapped
+  mol.addAtom(8, 1.0f, -2.0f, 0.0f);
+  mol.addAtom(1, 1.8f, -2.0f, 0.5f);
+  mol.addAtom(1, 0.2f, -2.0f, 0.5f);
+  mol.addAtom(11, 3.0f, 3.0f, -15.0f);
+  return mol;
+}
+
+static const std::vector<Bond> kBonds = {{0, 1}, {1, 2}, {2, 3}, {4, 5}, {4, 6}};
+
+static float distance(const Molecule& mol, uint32_t a, uint32_t b) {
+  return std::hypot(mol.x[a] - mol.x[b], mol.y[a] - mol.y[b], mol.z[a] - mol.z[b]);
+}
+
+static void wrapAndUnwrap() {
+  Molecule mol = splitSystem();
+  PeriodicImager imager(1);
+  imager.setBox(kBox);
+  imager.setCenter(kCenter);
+  imager.setMolecules(mol.size(), kBonds);
+  check(imager.periodic(), "box enabled");
+  check(imager.moleculeCount() == 3, "chain, water and ion");
+
+  std::vector<Instance> out(mol.size());
+  imager.apply(mol, out);
+
+  // the chain is whole: its bonds are short again, and it sits where its
+  // first atom already was
+  for (const Bond& b : kBonds) {
+    check(distance(mol, b.a, b.b) < 1.2f, "bonds are whole");
+  }
+  checkNear(mol.x[0], 9.0, 1e-5, "first atom stays in the box");
+  checkNear(mol.x[2], 10.6, 1e-5, "chain continues across the face");
+  checkNear(mol.x[3], 11.4, 1e-5, "chain continues across the face");
+  checkNear(mol.y[3], 1.5, 1e-5, "other axes untouched");
+
+  // the ion is wrapped into [-L/2, L/2) around the centre
+  checkNear(mol.z[7], -3.0, 1e-5, "ion wrapped by one box length");
+  checkNear(mol.x[4], 1.0, 0.0, "water untouched");
+
+  for (size_t i = 0; i < mol.size(); i++) {
+    checkNear(out[i].x, mol.x[i], 0.0, "instances get the imaged x");
+    checkNear(out[i].y, mol.y[i], 0.0, "instances get the imaged y");
+    checkNear(out[i].z, mol.z[i], 0.0, "instances get the imaged z");
+  }
+
+  // imaging an imaged frame changes nothing
+  Molecule again = mol;
+  imager.apply(again, {});
+  for (size_t i = 0; i < mol.size(); i++) {
+    checkNear(again.x[i], mol.x[i], 1e-5, "idempotent");
+  }
+}
+
+static void recenter() {
+  Molecule mol = splitSystem();
+  PeriodicImager imager(1);
+  imager.setBox(kBox);
+  imager.setCenter(kCenter);
+  imager.setMolecules(mol.size(), kBonds);
+  imager.recenterOn(2);
+  imager.apply(mol, {});
+
+  // the chain's centroid (10.2, 1.25, 2.25 unwrapped) moves to the centre
+  // and the rest of the frame shifts with it
+  float c[3] = {0.0f, 0.0f, 0.0f};
+  for (uint32_t i = 0; i < 4; i++) {
+    c[0] += mol.x[i] / 4.0f;
+    c[1] += mol.y[i] / 4.0f;
+    c[2] += mol.z[i] / 4.0f;
+  }
+  checkNear(c[0], 0.0, 1e-5, "chain centred in x");
+  checkNear(c[1], 0.0, 1e-5, "chain centred in y");
+  checkNear(c[2], 0.0, 1e-5, "chain centred in z");
+  for (const Bond& b : kBonds) {
+    check(distance(mol, b.a, b.b) < 1.2f, "bonds stay whole");
+  }
+  // water: 1.0 - 10.2 = -9.2 is inside the box, so only shifted
+  checkNear(mol.x[4], -9.2, 1e-5, "water shifted with the frame");
+  // water's hydrogen at 1.8 - 10.2 = -8.4 stays with its oxygen
+  checkNear(mol.x[5], -8.4, 1e-5, "water stays whole");
+  for (size_t i = 0; i < mol.size(); i++) {
+    check(mol.x[i] < 10.0f + 1.0f && mol.x[i] >= -10.0f - 1.0f, "near the box");
+  }
+
+  imager.recenterOn(PeriodicImager::kNone);
+  Molecule plain = splitSystem();
+  imager.apply(plain, {});
+  checkNear(plain.x[0], 9.0, 1e-5, "recentering stops");
+}
+
+static void noBox() {
+  Molecule mol = splitSystem();
+  PeriodicImager imager(1);
+  const float none[3] = {0.0f, 0.0f, 0.0f};
+  imager.setBox(none);
+  imager.setMolecules(mol.size(), kBonds);
+  imager.apply(mol, {});
+  check(!imager.periodic(), "no box");
+  checkNear(mol.x[2], -9.4, 1e-6, "nothing moves without a box");
+
+  float center[3];
+  boundsCenter(mol, center);
+  checkNear(center[0], 0.2, 1e-6, "bounds centre x");
+  checkNear(center[2], -6.25, 1e-6, "bounds centre z");
+}
+
+// Above the threading threshold, threads must give the same frame as one.
+static void threads() {
+  Molecule mol;
+  std::vector<Bond> bonds;
+  for (uint32_t i = 0; i < 300000; i++) {
+    float t = (float)i;
+    // three-atom molecules scattered over several box lengths
+    mol.addAtom(1, std::fmod(t * 0.731f, 57.0f) - 30.0f, std::fmod(t * 0.377f, 41.0f) - 20.0f,
+                std::fmod(t * 0.193f, 33.0f) - 15.0f);
+    if (i % 3 != 0) {
+      bonds.push_back({i - 1, i});
+    }
+  }
+  Molecule serial = mol;
+  Molecule parallel = mol;
+  PeriodicImager one(1), four(4);
+  for (PeriodicImager* imager : {&one, &four}) {
+    imager->setBox(kBox);
+    imager->setCenter(kCenter);
+    imager->setMolecules(mol.size(), bonds);
+    imager->recenterOn(5);
+  }
+  one.apply(serial, {});
+  four.apply(parallel, {});
+  bool same = true;
+  for (size_t i = 0; i < mol.size(); i++) {
+    same &= std::memcmp(&serial.x[i], &parallel.x[i], sizeof(float)) == 0 &&
+            std::memcmp(&serial.y[i], &parallel.y[i], sizeof(float)) == 0 &&
+            std::memcmp(&serial.z[i], &parallel.z[i], sizeof(float)) == 0;
+  }
+  check(same, "1 and 4 threads agree");
+
+  // the pool's threads are reused for the next frame
+  Molecule again = mol;
+  four.apply(again, {});
+  check(std::memcmp(again.x.data(), parallel.x.data(), mol.size() * sizeof(float)) == 0,
+        "a second frame on the same pool");
+}
+
+auto main() -> int {
+  wrapAndUnwrap();
+  recenter();
+  noBox();
+  threads();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstring>
+
+#include "check.hpp"
+#include "random_walk.hpp"
+
+static bool sameBits(const Molecule& a, const Molecule& b) {
+  const size_t bytes = a.size() * sizeof(float);
+  return a.size() == b.size() && std::memcmp(a.x.data(), b.x.data(), bytes) == 0 &&
+         std::memcmp(a.y.data(), b.y.data(), bytes) == 0 &&
+         std::memcmp(a.z.data(), b.z.data(), bytes) == 0;
+}
+
+auto main() -> int {
+  // Enough atoms times steps that four threads really split the work, and an
+  // atom count that is not a multiple of the block size.
+  Molecule start;
+  for (int i = 0; i < 20001; i++) {
+    start.addAtom(1 + i % 8, (float)(i % 37), (float)(i % 101) * 0.5f, (float)i * 0.01f);
+  }
+  const uint64_t seed = 42;
+
+  RandomWalkGenerator one(start, seed, 0.05f, 1);
+  RandomWalkGenerator four(start, seed, 0.05f, 4);
+  check(sameBits(one.seek(25), four.seek(25)), "seek: 1 and 4 threads agree");
+
+  std::vector<Molecule> serial = one.generate(3, 10);
+  std::vector<Molecule> parallel = four.generate(3, 10);
+  check(serial.size() == 10 && parallel.size() == 10, "ten frames generated");
+  for (size_t f = 0; f < serial.size() && f < parallel.size(); f++) {
+    check(sameBits(serial[f], parallel[f]), "generate: 1 and 4 threads agree");
+  }
+
+  // generate() and stepwise seeks walk the same path, and seeking backwards
+  // replays it
+  RandomWalkGenerator stepwise(start, seed, 0.05f, 3);
+  for (size_t f = 0; f < serial.size(); f++) {
+    check(sameBits(stepwise.seek(3 + f), serial[f]), "generate matches seek");
+  }
+  check(sameBits(stepwise.seek(0), start), "frame 0 is the start");
+  check(sameBits(stepwise.seek(7), serial[4]), "seeking back replays");
+
+  // every step stays within stepSize per axis
+  const Molecule& a = one.seek(11);
+  Molecule before = a;
+  const Molecule& b = one.seek(12);
+  float largest = 0.0f;
+  for (size_t i = 0; i < start.size(); i++) {
+    largest = std::max({largest, std::fabs(b.x[i] - before.x[i]),
+                        std::fabs(b.y[i] - before.y[i]), std::fabs(b.z[i] - before.z[i])});
+  }
+  check(largest <= 0.05f * 1.0001f && largest > 0.04f, "steps span [-stepSize, stepSize)");
+
+  // Seeking backwards resumes from a checkpoint rather than frame 0, and
+  // still lands on the same positions after the budget forces the interval
+  // to grow and older checkpoints to be dropped.
+  Molecule small;
+  for (int i = 0; i < 64; i++) {
+    small.addAtom(6, (float)i, 0.0f, 0.0f);
+  }
+  const size_t bytes = small.size() * 3 * sizeof(float);
+  RandomWalkGenerator reference(small, seed, 0.05f, 1, 0);
+  std::vector<Molecule> path = reference.generate(0, 600);
+  check(reference.checkpointCount() == 0, "a zero budget keeps no checkpoints");
+
+  RandomWalkGenerator thinned(small, seed, 0.05f, 2, 8 * bytes);
+  thinned.seek(599);
+  check(thinned.checkpointCount() <= 8, "checkpoints stay within the budget");
+  check(thinned.checkpointInterval() > 16, "the interval grew");
+  const size_t walked = thinned.stepsComputed();
+  check(sameBits(thinned.seek(450), path[450]), "seek back after thinning");
+  check(thinned.stepsComputed() - walked < thinned.checkpointInterval(),
+        "seeking back replays less than one interval");
+  for (size_t f : {0u, 1u, 17u, 64u, 333u, 598u, 5u}) {
+    check(sameBits(thinned.seek(f), path[f]), "random seeks match the sequential walk");
+  }
+
+  RandomWalkGenerator otherSeed(start, seed + 1, 0.05f, 1);
+  check(!sameBits(otherSeed.seek(1), four.seek(1)), "the seed changes the walk");
+  return failures() != 0 ? 1 : 0;
+}
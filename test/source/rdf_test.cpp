@@ -0,0 +1,67 @@
+#include <random>
+
+#include "check.hpp"
+#include "rdf.hpp"
+
+// Uncorrelated atoms in a periodic box: g(r) of every pair is 1 at all r.
+static void idealGas(unsigned threads) {
+  const float side = 24.0f;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> coord(0.0f, side);
+
+  RdfAccumulator rdf(8.0f, 16, threads);
+  rdf.setBox(side, side, side);
+  Molecule mol;
+  for (int frame = 0; frame < 8; frame++) {
+    mol = Molecule();
+    // argon twice as abundant as neon, so both like and unlike pairs occur
+    for (int i = 0; i < 3000; i++) {
+      mol.addAtom(i % 3 == 0 ? 10 : 18, coord(rng), coord(rng), coord(rng));
+    }
+    rdf.accumulate(mol);
+  }
+  check(rdf.frames() == 8, "eight frames accumulated");
+  check(rdf.pairs().size() == 3, "Ar-Ar, Ar-Ne and Ne-Ne");
+  check(!rdf.pairs().empty() && rdf.pairs()[0] == std::pair<int, int>(18, 18),
+        "most abundant kind first");
+
+  for (size_t p = 0; p < rdf.pairs().size(); p++) {
+    std::vector<float> g = rdf.g(p);
+    check(g.size() == 16, "one value per bin");
+    double mean = 0.0;
+    int used = 0;
+    // the innermost shells hold too few pairs to be meaningful
+    for (size_t b = 4; b < g.size(); b++) {
+      checkNear(g[b], 1.0, 0.12, "ideal gas g(r) per bin");
+      mean += g[b];
+      used++;
+    }
+    checkNear(mean / used, 1.0, 0.03, "ideal gas g(r) on average");
+  }
+}
+
+// A pair at a fixed distance across the boundary only counts with the box.
+static void minimumImage() {
+  Molecule mol;
+  mol.addAtom(18, 0.5f, 5.0f, 5.0f);
+  mol.addAtom(18, 9.5f, 5.0f, 5.0f);
+
+  RdfAccumulator rdf(4.0f, 4, 1);
+  rdf.setBox(10.0f, 10.0f, 10.0f);
+  rdf.accumulate(mol);
+  std::vector<float> g = rdf.g(0);
+  check(g[1] > 0.0f && g[0] <= 0.0f && g[2] <= 0.0f && g[3] <= 0.0f,
+        "the 1 A image pair lands in the 1-2 A bin");
+
+  RdfAccumulator open(4.0f, 4, 1);
+  open.accumulate(mol);
+  std::vector<float> none = open.g(0);
+  check(none[1] <= 0.0f, "no image pair without a box");
+}
+
+auto main() -> int {
+  idealGas(1);
+  idealGas(4);
+  minimumImage();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "dcd_trajectory.hpp"
+#include "pdb_reader.hpp"
+#include "xtc_trajectory.hpp"
+
+// The fixtures are built byte by byte here, so each test shows exactly what
+// the file holds.
+
+struct Fixture {
+  std::string bytes;
+  bool bigEndian = false;
+
+  void u32(uint32_t v) {
+    for (int k = 0; k < 4; k++) {
+      int shift = bigEndian ? 24 - 8 * k : 8 * k;
+      bytes.push_back((char)(v >> shift));
+    }
+  }
+  void f32(float v) { u32(std::bit_cast<uint32_t>(v)); }
+  void f64(double v) {
+    uint64_t bits = std::bit_cast<uint64_t>(v);
+    if (bigEndian) {
+      u32((uint32_t)(bits >> 32));
+      u32((uint32_t)bits);
+    } else {
+      u32((uint32_t)bits);
+      u32((uint32_t)(bits >> 32));
+    }
+  }
+};
+
+static Molecule topology(size_t atoms) {
+  Molecule mol;
+  for (size_t i = 0; i < atoms; i++) {
+    mol.addAtom(i % 3 == 0 ? 8 : 1, 0.0f, 0.0f, 0.0f);
+  }
+  return mol;
+}
+
+// Atom i of frame f, in Angstrom.
+static float dcdCoord(size_t f, size_t i, int axis) {
+  return (float)f * 10.0f + (float)i + 0.25f * (float)axis;
+}
+
+// ---------- DCD ----------
+
+// A 30 Angstrom cube as CHARMM writes it: A, gamma, B, beta, alpha, C.
+static constexpr double kCubeCell[6] = {30.0, 90.0, 30.0, 90.0, 90.0, 30.0};
+
+// CHARMM layout with a unit cell record, in either byte order.
+static std::string dcdFile(size_t atoms, size_t frames, bool bigEndian,
+                           const double (&unitCell)[6] = kCubeCell) {
+  Fixture out;
+  out.bigEndian = bigEndian;
+  out.u32(84);
+  out.bytes += "CORD";
+  uint32_t control[20] = {};
+  control[0] = (uint32_t)frames;
+  control[10] = 1;  // unit cell
+  control[19] = 24; // CHARMM version
+  for (uint32_t c : control) {
+    out.u32(c);
+  }
+  out.u32(84);
+
+  out.u32(84);
+  out.u32(1);
+  out.bytes += std::string(80, ' ').replace(0, 13, "Test fixture.");
+  out.u32(84);
+
+  out.u32(4);
+  out.u32((uint32_t)atoms);
+  out.u32(4);
+
+  for (size_t f = 0; f < frames; f++) {
+    out.u32(48);
+    for (double cell : unitCell) {
+      out.f64(cell);
+    }
+    out.u32(48);
+    for (int axis = 0; axis < 3; axis++) {
+      out.u32((uint32_t)(4 * atoms));
+      for (size_t i = 0; i < atoms; i++) {
+        out.f32(dcdCoord(f, i, axis));
+      }
+      out.u32((uint32_t)(4 * atoms));
+    }
+  }
+  return out.bytes;
+}
+
+static void dcd(const ScratchDir& dir) {
+  for (bool bigEndian : {false, true}) {
+    std::string file = dcdFile(4, 3, bigEndian);
+    // half a frame from an interrupted write
+    file += file.substr(file.size() - 40);
+    const std::string path = dir.write(bigEndian ? "be.dcd" : "le.dcd", file);
+    check(isDcdFile(path), "DCD magic");
+
+    DcdTrajectory dcd(path, topology(4));
+    check(dcd.frameCount() == 3 && dcd.atomCount() == 4, "DCD counts");
+    check(dcd.hasUnitCell(), "DCD unit cell");
+    float box[3] = {};
+    check(dcd.periodicBox(box), "DCD cube");
+    checkNear(box[0], 30.0, 1e-5, "DCD box x");
+    checkNear(box[2], 30.0, 1e-5, "DCD box z");
+    std::vector<Instance> out;
+    for (size_t f = 0; f < 3; f++) {
+      dcd.readFrame(f, out);
+      for (size_t i = 0; i < 4; i++) {
+        checkNear(out[i].x, dcdCoord(f, i, 0), 0.0, "DCD x");
+        checkNear(out[i].y, dcdCoord(f, i, 1), 0.0, "DCD y");
+        checkNear(out[i].z, dcdCoord(f, i, 2), 0.0, "DCD z");
+      }
+    }
+    checkThrows([&] { DcdTrajectory t(path, topology(5)); }, "Topology has 5 atoms");
+  }
+
+  // angles stored as cosines: gamma = 60 degrees
+  const double hexagonal[6] = {20.0, 0.5, 20.0, 0.0, 0.0, 25.0};
+  DcdTrajectory tilted(dir.write("tilted.dcd", dcdFile(4, 1, false, hexagonal)), topology(4));
+  float cell[9];
+  float box[3];
+  check(tilted.unitCell(cell), "DCD triclinic cell");
+  checkNear(cell[0], 20.0, 1e-5, "a along x");
+  checkNear(cell[3], 10.0, 1e-4, "b x");
+  checkNear(cell[4], 17.3205081, 1e-4, "b y");
+  checkNear(cell[8], 25.0, 1e-4, "c along z");
+  check(!tilted.periodicBox(box), "triclinic cell is not imaged");
+}
+
+// ---------- XTC ----------
+
+// Most-significant-bit-first, as the XTC reader expects.
+struct BitWriter {
+  std::vector<uint8_t> bytes;
+  uint64_t buffer = 0;
+  int count = 0;
+
+  void put(uint32_t value, int bits) {
+    for (int b = bits - 1; b >= 0; b--) {
+      buffer = buffer << 1 | ((value >> b) & 1u);
+      if (++count == 8) {
+        bytes.push_back((uint8_t)buffer);
+        buffer = 0;
+        count = 0;
+      }
+    }
+  }
+  void flush() {
+    if (count > 0) {
+      put(0, 8 - count);
+    }
+  }
+  // Three values as one mixed-radix number, least significant byte first.
+  void putInts(int bits, const uint32_t sizes[3], const uint32_t v[3]) {
+    uint64_t n = ((uint64_t)v[0] * sizes[1] + v[1]) * sizes[2] + v[2];
+    for (; bits > 8; bits -= 8) {
+      put((uint32_t)(n & 0xff), 8);
+      n >>= 8;
+    }
+    if (bits > 0) {
+      put((uint32_t)n, bits);
+    }
+  }
+};
+
+// Atom i of frame f, in nm at the XTC precision of 1000.
+static int32_t xtcInt(size_t f, size_t i, int axis) {
+  return (int32_t)(1000 * f + 150 * i + 7 * axis) - 900;
+}
+
+static void xtcHeader(Fixture& out, size_t atoms, size_t f) {
+  out.u32(1995);
+  out.u32((uint32_t)atoms);
+  out.u32((uint32_t)(f * 100));
+  out.f32((float)f);
+  for (int k = 0; k < 9; k++) {
+    out.f32(k % 4 == 0 ? 3.0f : 0.0f);
+  }
+  out.u32((uint32_t)atoms);
+}
+
+// Up to nine atoms, the coordinates are plain floats.
+static std::string xtcSmall(size_t atoms, size_t frames) {
+  Fixture out;
+  out.bigEndian = true;
+  for (size_t f = 0; f < frames; f++) {
+    xtcHeader(out, atoms, f);
+    for (size_t i = 0; i < atoms; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        out.f32((float)xtcInt(f, i, axis) / 1000.0f);
+      }
+    }
+  }
+  return out.bytes;
+}
+
+// Compressed frames: atoms 0-9 at full range; atom 10 as a small difference
+// from atom 11, which the stream stores first (the water swap); atom 12 at
+// full range again after the run ends.
+static constexpr size_t kRunAtom = 10;
+
+static int32_t xtcCompressedInt(size_t f, size_t i, int axis) {
+  return i == kRunAtom ? xtcInt(f, i + 1, axis) - 3 + 2 * axis : xtcInt(f, i, axis);
+}
+
+static std::string xtcCompressed(size_t atoms, size_t frames) {
+  const int smallidx = 12; // differences in [-8, 8) as 12 bits per atom
+  const uint32_t smallSize = 16;
+  const int32_t smallnum = 8;
+
+  Fixture out;
+  out.bigEndian = true;
+  for (size_t f = 0; f < frames; f++) {
+    int32_t minint[3], maxint[3];
+    for (int axis = 0; axis < 3; axis++) {
+      minint[axis] = maxint[axis] = xtcCompressedInt(f, 0, axis);
+      for (size_t i = 0; i < atoms; i++) {
+        minint[axis] = std::min(minint[axis], xtcCompressedInt(f, i, axis));
+        maxint[axis] = std::max(maxint[axis], xtcCompressedInt(f, i, axis));
+      }
+    }
+    uint32_t sizeint[3];
+    uint64_t product = 1;
+    for (int axis = 0; axis < 3; axis++) {
+      sizeint[axis] = (uint32_t)(maxint[axis] - minint[axis] + 1);
+      product *= sizeint[axis];
+    }
+    const int bitsize = std::bit_width(product);
+
+    BitWriter bits;
+    auto full = [&](size_t i) {
+      uint32_t v[3];
+      for (int axis = 0; axis < 3; axis++) {
+        v[axis] = (uint32_t)(xtcCompressedInt(f, i, axis) - minint[axis]);
+      }
+      bits.putInts(bitsize, sizeint, v);
+    };
+    const uint32_t sizesmall[3] = {smallSize, smallSize, smallSize};
+    for (size_t i = 0; i < atoms; i++) {
+      if (i == kRunAtom) {
+        full(i + 1);
+        bits.put(1, 1);
+        bits.put(3 + 1, 5); // run of 3 values (one atom), same smallidx
+        uint32_t v[3];
+        for (int axis = 0; axis < 3; axis++) {
+          v[axis] = (uint32_t)(xtcCompressedInt(f, i, axis) -
+                               xtcCompressedInt(f, i + 1, axis) + smallnum);
+        }
+        bits.putInts(smallidx, sizesmall, v);
+        i++;
+      } else if (i == kRunAtom + 2) {
+        full(i);
+        bits.put(1, 1);
+        bits.put(0 + 1, 5); // the run ends
+      } else {
+        full(i);
+        bits.put(0, 1);
+      }
+    }
+    bits.flush();
+
+    xtcHeader(out, atoms, f);
+    out.f32(1000.0f);
+    for (int32_t v : minint) {
+      out.u32((uint32_t)v);
+    }
+    for (int32_t v : maxint) {
+      out.u32((uint32_t)v);
+    }
+    out.u32(smallidx);
+    out.u32((uint32_t)bits.bytes.size());
+    out.bytes.append(bits.bytes.begin(), bits.bytes.end());
+    out.bytes.append((4 - bits.bytes.size() % 4) % 4, '\0');
+  }
+  return out.bytes;
+}
+
+static void checkXtc(const std::string& path, size_t atoms, size_t frames,
+                     int32_t (*expected)(size_t, size_t, int)) {
+  check(isXtcFile(path), "XTC magic");
+  for (bool cached : {false, true}) {
+    XtcTrajectory xtc(path, topology(atoms));
+    check(xtc.indexCached() == cached, "index cached from the second open");
+    check(xtc.frameCount() == frames && xtc.atomCount() == atoms, "XTC counts");
+    float box[3] = {};
+    check(xtc.periodicBox(box), "XTC box");
+    checkNear(box[1], 30.0, 1e-5, "XTC box in Angstrom");
+    std::vector<Instance> out;
+    for (size_t f = 0; f < xtc.frameCount(); f++) {
+      xtc.readFrame(f, out);
+      for (size_t i = 0; i < atoms; i++) {
+        // nm to Angstrom
+        checkNear(out[i].x, expected(f, i, 0) / 100.0, 1e-4, "XTC x");
+        checkNear(out[i].y, expected(f, i, 1) / 100.0, 1e-4, "XTC y");
+        checkNear(out[i].z, expected(f, i, 2) / 100.0, 1e-4, "XTC z");
+      }
+    }
+  }
+}
+
+static void xtc(const ScratchDir& dir) {
+  checkXtc(dir.write("small.xtc", xtcSmall(3, 2)), 3, 2, xtcInt);
+
+  // a partial last frame is dropped
+  std::string compressed = xtcCompressed(13, 3);
+  compressed.resize(compressed.size() - 8);
+  checkXtc(dir.write("compressed.xtc", compressed), 13, 2, xtcCompressedInt);
+
+  checkThrows([&] { XtcTrajectory t(dir.path("small.xtc"), topology(4)); },
+              "Topology has 4 atoms");
+}
+
+// ---------- PDB ----------
+
+static std::string pdbAtom(const char* record, int serial, const char* name, double x,
+                           double y, double z, const char* element) {
+  char line[96];
+  std::snprintf(line, sizeof(line), "%-6s%5d %-4s %3s A%4d    %8.3f%8.3f%8.3f%6.2f%6.2f          %2s\n",
+                record, serial, name, "ALA", 1, x, y, z, 1.0, 0.0, element);
+  return line;
+}
+
+static void pdb(const ScratchDir& dir) {
+  check(isPdbFile("a/b.pdb") && isPdbFile("B.ENT") && !isPdbFile("b.xyz"), "PDB extensions");
+
+  std::string file = "HEADER    TEST\nMODEL        1\n";
+  file += pdbAtom("ATOM", 1, " N  ", 1.0, -2.5, 3.125, " N");
+  file += pdbAtom("ATOM", 2, " CA ", 10.5, 0.0, -7.0, "");   // alpha carbon
+  file += pdbAtom("HETATM", 3, "CA  ", 0.0, 0.0, 0.0, "");   // calcium
+  file += pdbAtom("ATOM", 4, "1HB ", 1.0, 1.0, 1.0, "");     // hydrogen
+  file += pdbAtom("HETATM", 5, "CL1 ", 2.0, 2.0, 2.0, "CL");
+  file += "ENDMDL\nMODEL        2\n";
+  file += pdbAtom("ATOM", 1, " N  ", 9.0, 9.0, 9.0, " N");
+  file += "ENDMDL\nEND\n";
+
+  Molecule mol = read_pdb(dir.write("model.pdb", file));
+  check(mol.size() == 5, "first model only");
+  const int elements[5] = {7, 6, 20, 1, 17};
+  for (size_t i = 0; i < 5 && i < mol.size(); i++) {
+    check(mol.atomicNumbers[i] == elements[i], "PDB element");
+  }
+  checkNear(mol.x[1], 10.5, 0.0, "PDB x");
+  checkNear(mol.y[0], -2.5, 0.0, "PDB y");
+  checkNear(mol.z[0], 3.125, 0.0, "PDB z");
+
+  // Without element columns, four-character hydrogen names start in column
+  // 13 like two-letter elements do; only a shorter name there is mercury.
+  std::string hydrogens;
+  hydrogens += pdbAtom("ATOM", 1, "HG21", 0.0, 0.0, 0.0, "");
+  hydrogens += pdbAtom("ATOM", 2, "HD11", 0.0, 0.0, 0.0, "");
+  hydrogens += pdbAtom("ATOM", 3, "HE22", 0.0, 0.0, 0.0, "");
+  hydrogens += pdbAtom("HETATM", 4, "HG  ", 0.0, 0.0, 0.0, "");
+  hydrogens += pdbAtom("ATOM", 5, " HA ", 0.0, 0.0, 0.0, "");
+  Molecule named = read_pdb(dir.write("hydrogens.pdb", hydrogens));
+  const int namedElements[5] = {1, 1, 1, 80, 1};
+  check(named.size() == 5, "five named atoms");
+  for (size_t i = 0; i < 5 && i < named.size(); i++) {
+    check(named.atomicNumbers[i] == namedElements[i], "element from the atom name");
+  }
+
+  std::string bad = pdbAtom("ATOM", 1, " N  ", 1.0, 2.0, 3.0, " N");
+  bad.replace(38, 8, "   x.000");
+  checkThrows([&] { read_pdb(dir.write("bad.pdb", "REMARK\n" + bad)); },
+              "Bad coordinates on line 2");
+  checkThrows([&] { read_pdb(dir.write("empty.pdb", "HEADER\nEND\n")); }, "No atoms");
+}
+
+auto main() -> int {
+  ScratchDir dir("chemiskit_trajectory_formats_test");
+  dcd(dir);
+  xtc(dir);
+  pdb(dir);
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "trajectory.hpp"
+
+using namespace std::chrono_literals;
+
+using ReadCounts = std::vector<std::atomic<int>>;
+
+// Frame f holds kAtoms atoms at x = f; counts how often each frame is read and
+// fails on `failAt` if set.
+class CountingSource : public FrameSource {
+public:
+  static constexpr size_t kAtoms = 4;
+
+  CountingSource(size_t frames, std::shared_ptr<ReadCounts> reads, size_t failAt = SIZE_MAX)
+    : frames(frames), reads(std::move(reads)), failAt(failAt) {}
+
+  size_t frameCount() const override { return frames; }
+  size_t atomCount() const override { return kAtoms; }
+  void readFrame(size_t index, std::vector<Instance>& out) override {
+    (*reads)[index]++;
+    if (index == failAt) {
+      throw std::runtime_error("bad frame\n");
+    }
+    out.assign(kAtoms, Instance{(float)index, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f});
+  }
+
+private:
+  size_t frames;
+  std::shared_ptr<ReadCounts> reads;
+  size_t failAt;
+};
+
+static constexpr size_t kFrameBytes = CountingSource::kAtoms * sizeof(Instance);
+
+static bool holds(const std::vector<Instance>* instances, size_t frame) {
+  return instances != nullptr && instances->size() == CountingSource::kAtoms &&
+         (size_t)(*instances)[0].x == frame;
+}
+
+// Waits for the decoder to read a frame, without moving the playhead.
+static bool waitForRead(const std::atomic<int>& reads) {
+  for (int i = 0; i < 1000 && reads == 0; i++) {
+    std::this_thread::sleep_for(1ms);
+  }
+  return reads != 0;
+}
+
+// The decoder fills the `capacity` frames from the playhead on and no further.
+static void aheadWindow() {
+  const size_t frames = 100;
+  auto reads = std::make_shared<ReadCounts>(frames);
+  TrajectoryStreamer streamer(std::make_unique<CountingSource>(frames, reads), 4, 0);
+  check(holds(streamer.acquire(10, 1s), 10), "frame 10 decoded");
+  check(waitForRead((*reads)[13]), "the window reaches playhead + 3");
+  std::this_thread::sleep_for(20ms);
+  check((*reads)[14] == 0, "nothing past the window is decoded");
+  check(holds(streamer.acquire(12), 12), "frames ahead are ready without waiting");
+
+  // the window wraps around the end for looping
+  check(holds(streamer.acquire(98, 1s), 98), "frame 98 decoded");
+  check(waitForRead((*reads)[1]), "the window wraps to frame 1");
+}
+
+// Frames behind the playhead are kept in the LRU cache until it is full, and
+// the least recently used ones are the ones re-decoded.
+static void lruReuse() {
+  const size_t frames = 100;
+  auto reads = std::make_shared<ReadCounts>(frames);
+  // 4 ahead + 8 cached
+  TrajectoryStreamer streamer(std::make_unique<CountingSource>(frames, reads), 4, 8 * kFrameBytes);
+  for (size_t f = 0; f <= 11; f++) {
+    check(holds(streamer.acquire(f, 1s), f), "playing forwards");
+  }
+  check(waitForRead((*reads)[14]), "window filled");
+
+  // frames 3..14 are resident; 0..2 were the least recently used
+  check(holds(streamer.acquire(8), 8), "scrubbing back hits the cache");
+  check(holds(streamer.acquire(3), 3), "oldest cached frame still there");
+  check((*reads)[8] == 1 && (*reads)[3] == 1, "cached frames are not decoded twice");
+  check(streamer.acquire(0) == nullptr, "evicted frame is not ready");
+  check(holds(streamer.acquire(0, 1s), 0), "evicted frame decoded again");
+  check((*reads)[0] == 2, "evicted frame read twice");
+
+  // a huge cache budget on a tiny molecule is capped
+  auto many = std::make_shared<ReadCounts>(1000000);
+  TrajectoryStreamer capped(std::make_unique<CountingSource>(1000000, many), 8, size_t(1) << 40);
+  check(holds(capped.acquire(500000, 1s), 500000), "far seek on a capped streamer");
+}
+
+// Other readers get any frame without moving the playhead: cached frames are
+// copied, others read from the shared source.
+static void keyedFetch() {
+  const size_t frames = 100;
+  auto reads = std::make_shared<ReadCounts>(frames);
+  TrajectoryStreamer streamer(std::make_unique<CountingSource>(frames, reads), 4, 8 * kFrameBytes);
+  check(holds(streamer.acquire(10, 1s), 10), "frame 10 decoded");
+  check(waitForRead((*reads)[13]), "window filled");
+
+  std::vector<Instance> out;
+  streamer.fetch(12, out);
+  check(holds(&out, 12), "a resident frame is copied");
+  check((*reads)[12] == 1, "without reading it again");
+
+  streamer.fetch(60, out);
+  check(holds(&out, 60), "another frame is read from the source");
+  std::this_thread::sleep_for(20ms);
+  check((*reads)[60] == 1 && (*reads)[61] == 0 && (*reads)[14] == 0,
+        "the playhead stays where the player left it");
+  check(holds(streamer.acquire(11), 11), "the player's window is untouched");
+  streamer.fetch(160, out);
+  check(holds(&out, 60), "frames wrap around like acquire()");
+
+  auto failing = std::make_shared<ReadCounts>(frames);
+  TrajectoryStreamer broken(std::make_unique<CountingSource>(frames, failing, 50), 4, 0);
+  checkThrows([&] { broken.fetch(50, out); }, "bad frame");
+  check(holds(broken.acquire(0, 1s), 0), "and leaves the decoder running");
+}
+
+static void decodeError() {
+  const size_t frames = 10;
+  auto reads = std::make_shared<ReadCounts>(frames);
+  TrajectoryStreamer streamer(std::make_unique<CountingSource>(frames, reads, 2), 4, 0);
+  check(streamer.acquire(2, 1s) == nullptr, "the bad frame is never ready");
+  check(streamer.acquire(5, 50ms) == nullptr, "the decoder stops after a failure");
+  check(streamer.error().find("bad frame") != std::string::npos, "the error is reported");
+
+  checkThrows([] { TrajectoryStreamer(std::make_unique<CountingSource>(0, nullptr), 4); },
+              "no frames");
+}
+
+auto main() -> int {
+  aheadWindow();
+  lruReuse();
+  keyedFetch();
+  decodeError();
+  return failures() != 0 ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#include <string_view>
+
+#include "check.hpp"
+#include "periodic.hpp"
+#include "xyz_parser.hpp"
+
+static void frames() {
+  // blank lines between frames, CRLF endings, tabs, a '+' sign and an atomic
+  // number instead of a symbol
+  const std::string_view xyz =
+    "3\r\nwater\r\nO 0.0 0.0 0.117\r\nH\t0.0 0.757 -0.467\r\n1 +0.0 -0.757 -0.467\r\n"
+    "\n"
+    "3\nsecond\ncl 1 2 3\nH 4 5 6\nH 7 8 9\n";
+  size_t natoms = 0;
+  std::vector<size_t> offsets = indexXyzFrames(xyz.data(), xyz.size(), natoms);
+  check(natoms == 3 && offsets.size() == 2, "two frames of three atoms");
+  check(offsets.size() == 2 && offsets[0] == 0, "first frame at the start");
+
+  Molecule mol;
+  parseXyzFrame(xyz.data(), xyz.size(), offsets[0], natoms, mol);
+  check(mol.size() == 3, "three atoms parsed");
+  check(mol.atomicNumbers[0] == 8 && mol.atomicNumbers[1] == 1 && mol.atomicNumbers[2] == 1,
+        "symbols and atomic numbers");
+  checkNear(mol.z[0], 0.117, 1e-7, "O z");
+  checkNear(mol.y[1], 0.757, 1e-7, "H y after a tab");
+  checkNear(mol.y[2], -0.757, 1e-7, "H y");
+
+  parseXyzFrame(xyz.data(), xyz.size(), offsets[1], natoms, mol);
+  check(mol.atomicNumbers[0] == 17, "lower-case symbol");
+  checkNear(mol.x[2], 7.0, 0.0, "second frame x");
+
+  std::vector<size_t> first = indexXyzFrames(xyz.data(), xyz.size(), natoms, 1);
+  check(first.size() == 1, "maxFrames stops the scan");
+}
+
+static void lattice() {
+  float cell[9];
+  float box[3] = {-1.0f, -1.0f, -1.0f};
+  const std::string_view orthorhombic =
+    "1\nlattice=\"10.0 0.0 0.0 0.0 12.5 0.0 0.0 0.0 8.25\" Properties=species:S:1:pos:R:3\n"
+    "H 0 0 0\n";
+  check(parseXyzLattice(orthorhombic.data(), orthorhombic.size(), 0, cell), "lattice found");
+  check(orthorhombicLengths(cell, box), "orthorhombic");
+  checkNear(box[0], 10.0, 0.0, "box x");
+  checkNear(box[1], 12.5, 0.0, "box y");
+  checkNear(box[2], 8.25, 0.0, "box z");
+
+  // the box vectors are kept; only the imager needs them orthorhombic
+  const std::string_view triclinic =
+    "1\nLattice=\"10 0 0 5 10 0 0 0 10\"\nH 0 0 0\n";
+  check(parseXyzLattice(triclinic.data(), triclinic.size(), 0, cell), "triclinic cell read");
+  checkNear(cell[3], 5.0, 0.0, "b x");
+  checkNear(cell[4], 10.0, 0.0, "b y");
+  check(!orthorhombicLengths(cell, box), "triclinic cell is not orthorhombic");
+  checkNear(box[0], 10.0, 0.0, "box left untouched");
+
+  float untouched[9] = {1.0f};
+  const std::string_view none = "1\nplain comment\nH 0 0 0\n";
+  check(!parseXyzLattice(none.data(), none.size(), 0, untouched), "no lattice");
+  const std::string_view shortLattice = "1\nLattice=\"10 0 0 0 10\"\nH 0 0 0\n";
+  check(!parseXyzLattice(shortLattice.data(), shortLattice.size(), 0, untouched),
+        "incomplete lattice");
+  checkNear(untouched[0], 1.0, 0.0, "cell left untouched");
+}
+
+static void errors() {
+  auto index = [](std::string_view xyz) {
+    size_t natoms = 0;
+    indexXyzFrames(xyz.data(), xyz.size(), natoms);
+  };
+  auto parse = [](std::string_view xyz) {
+    size_t natoms = 0;
+    std::vector<size_t> offsets = indexXyzFrames(xyz.data(), xyz.size(), natoms);
+    Molecule mol;
+    parseXyzFrame(xyz.data(), xyz.size(), offsets[0], natoms, mol);
+  };
+
+  checkThrows([&] { index(""); }, "Failed to read atom count.");
+  checkThrows([&] { index("three\ncomment\n"); }, "Failed to read atom count.");
+  checkThrows([&] { index("3\ncomment\nH 0 0 0\n"); },
+              "Number of atoms not equal to mol.atoms: 3 : 1");
+  checkThrows([&] { index("1\n\nH 0 0 0\n2\n\nH 0 0 0\nH 1 1 1\n"); },
+              "Frame 1 atom count differs from first frame: 2 : 1");
+  checkThrows([&] { parse("2\n\nH 0 0 0\nH 1 1\n"); },
+              "Number of atoms not equal to mol.atoms: 2 : 1");
+  checkThrows([&] { parse("1\n\nQq 0 0 0\n"); }, "Unknown atom: Qq");
+}
+
+auto main() -> int {
+  frames();
+  lattice();
+  errors();
+  return failures() != 0 ? 1 : 0;
+}